@@ -11,18 +11,18 @@
 
 namespace base {
 /**
- * Simple ascending sort.
+ * Simple ascending sort. Returns the number of swaps.
+ *
+ * O(n^2): for real-time code use the algorithms in base/sort.h.
  */
-template <typename T>
-int bubble_sort(std::vector<T> &v) {
-  bool swapped;
+template <typename RandomIt>
+int bubble_sort(RandomIt first, RandomIt last) {
   int result = 0;
-  for (int i = 1; i < v.size(); i++) {
-    swapped = false;
-    for (int j = 0; j < v.size() - 1; j++) {
-      // ascending<=, descending=>
-      if (v[j + 1] <= v[j]) {
-        std::swap(v[j], v[j + 1]);
+  for (auto n = last - first; n > 1; --n) {
+    bool swapped = false;
+    for (RandomIt j = first; j + 1 != first + n; ++j) {
+      if (*(j + 1) < *j) {
+        std::iter_swap(j, j + 1);
         swapped = true;
         result++;
       }
@@ -33,23 +33,13 @@ int bubble_sort(std::vector<T> &v) {
   return result;
 }
 
+template <typename T>
+int bubble_sort(std::vector<T> &v) {
+  return bubble_sort(v.begin(), v.end());
+}
+
 template <typename T, std::size_t N>
 int bubble_sort(std::array<T, N> &v) {
-  bool swapped;
-  int result = 0;
-  for (int i = 1; i < N; i++) {
-    swapped = false;
-    for (int j = 0; j < N - 1; j++) {
-      // ascending<=, descending=>
-      if (v[j + 1] <= v[j]) {
-        std::swap(v[j], v[j + 1]);
-        swapped = true;
-        result++;
-      }
-    }
-    if (not swapped)
-      break;
-  }
-  return result;
+  return bubble_sort(v.begin(), v.end());
 }
 } /* base */
@@ -9,8 +9,13 @@
 #include <base/idioms.h>
 #include <base/numeric.h>
 #include <base/posix.h>
+#include <base/random.h>
+#include <base/rcu.h>
+#include <base/seqlock.h>
 #include <base/threading.h>
+#include <base/sort.h>
 #include <base/string.h>
 #include <base/trace.h>
+#include <base/triple_buffer.h>
 #include <base/utility.h>
 
@@ -1,8 +1,11 @@
 // -*-coding: raw-text-unix;-*-
 #pragma once
 
+#include <cerrno>
 #include <chrono>
 
+#include <time.h>
+
 #include <base/numeric.h>
 
 namespace base {
@@ -32,6 +35,12 @@ double nsec_to_sec( nsec_t);
 double nsec_to_msec(nsec_t);
 double nsec_to_usec(nsec_t);
 
+/** Current CLOCK_MONOTONIC time in nanoseconds. */
+nsec_t monotonic_now();
+
+/** Sleep until an absolute CLOCK_MONOTONIC time, also across signals. */
+void sleep_until(nsec_t monotonic_ns);
+
 /**
  * Test if a time condition was met.
  *
@@ -255,6 +264,22 @@ nsec_to_timespec(nsec_t ns) {
   return ts;
 }
 
+inline
+nsec_t
+monotonic_now() {
+  timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return nsec_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+inline
+void
+sleep_until(nsec_t monotonic_ns) {
+  timespec const ts = nsec_to_timespec(monotonic_ns);
+  while (::clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+  }
+}
+
 inline
 void
 benchmark::reset() {
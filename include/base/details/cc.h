@@ -85,3 +85,6 @@
 /* only GCC and Clang */
 #define ALWAYS_INLINE __attribute__((always_inline))
 #define NORETURN      __attribute__((noreturn))
+
+/* x86-64 and most ARMv8 cores; used with alignas() to prevent false sharing */
+#define CACHELINE_SIZE 64
@@ -6,6 +6,7 @@
 
 #include <mutex>
 
+#include <base/rcu.h>
 #include <base/utility.h>     // BASE_STD_GUARD
 
 namespace base {
@@ -70,15 +71,29 @@ public:
 
 /**
  * Dependency Injection (DI) design pattern.
+ *
+ * The parameters are published through a @ref rcu_cell: get_parameters() and
+ * with_parameters() never block, not even while another thread calls
+ * set_parameters(), and do not write cache lines shared with other readers.
+ * Real-time tasks can therefore pick up a reconfiguration at a bounded cost.
+ * Replaced parameter sets are freed by set_parameters(), i.e. on the thread
+ * that reconfigures.
  */
 template <typename Params>
 class depends_on {
 public:
   void   set_parameters(Params const&);
   Params get_parameters() const;
+
+  /**
+   * Call f with a reference to the current parameters without copying them.
+   * The reference is only valid during the call.
+   */
+  template <typename F>
+  auto with_parameters(F&& f) const -> decltype(f(std::declval<Params const&>()));
+
 private:
-  Params params_;
-  std::mutex lock_;
+  rcu_cell<Params> params_;
 };
 
 /***********************************************************************
@@ -87,15 +102,20 @@ private:
 template <typename Params>
 void
 depends_on<Params>::set_parameters(Params const& par) {
-  BASE_STD_GUARD(lock_);
-  params_ = par;
+  params_.store(par);
 }
 
 template <typename Params>
 Params
 depends_on<Params>::get_parameters() const {
-  BASE_STD_GUARD(lock_);
-  Params result {params_};
-  return result;             // use deferred temporary materialization (C++17)
+  return params_.load();
+}
+
+template <typename Params>
+template <typename F>
+auto
+depends_on<Params>::with_parameters(F&& f) const
+    -> decltype(f(std::declval<Params const&>())) {
+  return params_.read(std::forward<F>(f));
 }
 } /* base */
@@ -39,7 +39,9 @@
 #endif /* __linux__, __unix__, __VXWORKS__ */
 
 //#include <map>
+#include <string>
 #include <utility>
+#include <vector>
 //#include <limits>
 
 namespace base {
@@ -147,6 +149,44 @@ kernel_has_PREEMPT_RT();
 bool
 kernel_is_realtime_kernel();
 
+/**
+ * @brief Read a small text file like the ones under /proc or /sys
+ *
+ * @return True on success, false otherwise (errno describes the error).
+ */
+bool
+read_text_file(std::string const& path, std::string& contents);
+
+/**
+ * @brief Overwrite a small text file like the ones under /proc or /sys
+ *
+ * The contents is written with a single write() call. Kernel interfaces
+ * report invalid values through errno (e.g. EIO for an interrupt that can not
+ * be moved).
+ *
+ * @return True on success, false otherwise (errno describes the error).
+ */
+bool
+write_text_file(std::string const& path, std::string const& contents);
+
+/**
+ * @brief Parse a CPU list like "0-3,8,10-11"
+ *
+ * This is the format of /proc/irq/N/smp_affinity_list and
+ * /sys/devices/system/cpu/online. The result is sorted and contains no
+ * duplicates.
+ *
+ * @return False if the string is malformed.
+ */
+bool
+parse_cpu_list(std::string const& list, std::vector<int>& cpus);
+
+/**
+ * Inverse of @ref parse_cpu_list, e.g. {0, 1, 2, 3, 8} => "0-3,8".
+ */
+std::string
+format_cpu_list(std::vector<int> cpus);
+
 /**
  * Trigger a thread context switch.
  */
@@ -0,0 +1,292 @@
+/* -*-coding:raw-text-unix-*-
+ *
+ * base/random.h -- lock-free random numbers and reproducible workloads
+ */
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <utility>
+#include <vector>
+
+namespace base {
+/**
+ * @brief SplitMix64
+ *
+ * Weak but fast generator, used to expand one 64-bit seed into the state of
+ * the other generators.
+ */
+class splitmix64 {
+public:
+  using result_type = std::uint64_t;
+
+  explicit splitmix64(std::uint64_t seed = 0) : state_ {seed} { }
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return UINT64_MAX; }
+  result_type operator () ();
+
+private:
+  std::uint64_t state_;
+};
+
+/**
+ * @brief xoshiro256** by Blackman and Vigna
+ *
+ * 256 bits of state, period 2^256 - 1, a handful of shifts, rotations and
+ * additions per number. Satisfies UniformRandomBitGenerator, so it works
+ * with the <random> distributions. Unlike rand() it takes no lock and
+ * unlike std::mt19937 its state fits into half a cache line.
+ */
+class xoshiro256ss {
+public:
+  using result_type = std::uint64_t;
+
+  explicit xoshiro256ss(std::uint64_t seed = 0);
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return UINT64_MAX; }
+  result_type operator () ();
+
+  /** Advance by 2^128 numbers: gives non-overlapping parallel streams. */
+  void jump();
+
+private:
+  friend class xoshiro256ss_x4;
+  std::uint64_t s_[4];
+};
+
+/**
+ * @brief Four xoshiro256** generators for bulk fills
+ *
+ * Lane k starts where xoshiro256ss {seed} would be after k jumps. The lanes
+ * run side by side in SSE2 registers; the output interleaves them: lane 0,
+ * 1, 2, 3, lane 0, ...
+ */
+class xoshiro256ss_x4 {
+public:
+  explicit xoshiro256ss_x4(std::uint64_t seed = 0);
+
+  /**
+   * Write n numbers. Always advances all lanes together: if n is not a
+   * multiple of four, the rest of the last group is discarded.
+   */
+  void fill(std::uint64_t* out, std::size_t n);
+
+private:
+  alignas(16) std::uint64_t s_[4][4];     // [word][lane]
+};
+
+/**
+ * @brief PCG32 (XSH RR) by O'Neill
+ *
+ * 64 bits of state, 32-bit output; each stream number selects an independent
+ * sequence.
+ */
+class pcg32 {
+public:
+  using result_type = std::uint32_t;
+
+  explicit pcg32(std::uint64_t seed = 0, std::uint64_t stream = 0);
+
+  static constexpr result_type min() { return 0; }
+  static constexpr result_type max() { return UINT32_MAX; }
+  result_type operator () ();
+
+private:
+  std::uint64_t state_;
+  std::uint64_t inc_;
+};
+
+/**
+ * Generator of the calling thread. Seeded from @ref seed_thread_rng() if
+ * called before the first use on that thread, else from the thread's
+ * creation order, so single-threaded programs get the same numbers on every
+ * run.
+ */
+xoshiro256ss& thread_rng();
+
+/** Reseed the generator of the calling thread. */
+void seed_thread_rng(std::uint64_t seed);
+
+/** Uniform integer in [0, bound) without modulo bias (Lemire's method). */
+template <typename Rng>
+std::uint32_t uniform(Rng& rng, std::uint32_t bound);
+
+/** Uniform double in [0, 1). */
+template <typename Rng>
+double uniform_real(Rng& rng);
+
+/**
+ * Input patterns for sorting benchmarks.
+ *
+ * few_unique draws from four values, sawtooth repeats ascending runs of
+ * sqrt(n) elements.
+ */
+enum class workload {
+  random, sorted, reverse, organ_pipe, sawtooth, few_unique, all_equal
+};
+
+/** Name of a workload for reports. */
+char const* to_string(workload);
+
+/**
+ * Fill [first, last) with a pattern. The same seed gives the same values on
+ * every run and every thread.
+ */
+template <typename ForwardIt>
+void generate_workload(ForwardIt first, ForwardIt last, workload, std::uint64_t seed = 0);
+
+/**
+ * Generate n ints that drive a comparison sort into its worst case. Runs
+ * McIlroy's adversary ("A Killer Adversary for Quicksort", 1999) against the
+ * given sort: values are fixed lazily while the sort compares them so that
+ * each pivot ends up as bad as possible.
+ *
+ * @param sort: Called as sort(first, last, comp) on a vector<int> iterator
+ *        range with a comparator.
+ *
+ * Example:
+ *
+ *     auto killer = base::adversarial_workload(1000, [](auto f, auto l, auto c) {
+ *       std::sort(f, l, c);
+ *     });
+ */
+template <typename Sort>
+std::vector<int> adversarial_workload(std::size_t n, Sort sort);
+
+/***********************************************************************
+ * inlined implementation
+ */
+namespace details {
+constexpr std::uint64_t
+rotl(std::uint64_t x, int k) {
+  return (x << k) | (x >> (64 - k));
+}
+} // details
+
+inline
+splitmix64::result_type
+splitmix64::operator () () {
+  std::uint64_t z = (state_ += 0x9e3779b97f4a7c15);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+  return z ^ (z >> 31);
+}
+
+inline
+xoshiro256ss::xoshiro256ss(std::uint64_t seed) {
+  splitmix64 sm {seed};
+  for (auto& s : s_)
+    s = sm();
+}
+
+inline
+xoshiro256ss::result_type
+xoshiro256ss::operator () () {
+  std::uint64_t const result = details::rotl(s_[1] * 5, 7) * 9;
+  std::uint64_t const t = s_[1] << 17;
+  s_[2] ^= s_[0];
+  s_[3] ^= s_[1];
+  s_[1] ^= s_[2];
+  s_[0] ^= s_[3];
+  s_[2] ^= t;
+  s_[3] = details::rotl(s_[3], 45);
+  return result;
+}
+
+inline
+pcg32::pcg32(std::uint64_t seed, std::uint64_t stream)
+  : state_ {0}, inc_ {(stream << 1) | 1} {
+  (*this)();
+  state_ += seed;
+  (*this)();
+}
+
+inline
+pcg32::result_type
+pcg32::operator () () {
+  std::uint64_t const old = state_;
+  state_ = old * 6364136223846793005ull + inc_;
+  std::uint32_t const xorshifted = std::uint32_t(((old >> 18) ^ old) >> 27);
+  std::uint32_t const rot = std::uint32_t(old >> 59);
+  return (xorshifted >> rot) | (xorshifted << ((32 - rot) & 31));
+}
+
+template <typename Rng>
+std::uint32_t
+uniform(Rng& rng, std::uint32_t bound) {
+  std::uint64_t m = std::uint64_t(std::uint32_t(rng())) * bound;
+  std::uint32_t low = std::uint32_t(m);
+  if (low < bound) {
+    std::uint32_t const threshold = std::uint32_t(-bound) % bound;
+    while (low < threshold) {
+      m = std::uint64_t(std::uint32_t(rng())) * bound;
+      low = std::uint32_t(m);
+    }
+  }
+  return std::uint32_t(m >> 32);
+}
+
+template <typename Rng>
+double
+uniform_real(Rng& rng) {
+  /* 53 random bits of a 64-bit or two 32-bit outputs */
+  std::uint64_t bits = rng();
+  if (Rng::max() <= UINT32_MAX)
+    bits = (bits << 32) | std::uint64_t(rng());
+  return double(bits >> 11) * (1.0 / 9007199254740992.0);
+}
+
+template <typename ForwardIt>
+void
+generate_workload(ForwardIt first, ForwardIt last, workload w, std::uint64_t seed) {
+  using T = typename std::iterator_traits<ForwardIt>::value_type;
+  std::size_t const n = std::distance(first, last);
+  std::size_t run = 1;
+  while (run * run < n)
+    ++run;
+  xoshiro256ss rng {seed};
+  std::size_t i = 0;
+  for (ForwardIt it = first; it != last; ++it, ++i) {
+    switch (w) {
+    case workload::random:     *it = T(rng() >> 33); break;
+    case workload::sorted:     *it = T(i); break;
+    case workload::reverse:    *it = T(n - i); break;
+    case workload::organ_pipe: *it = T(i < n / 2 ? i : n - i); break;
+    case workload::sawtooth:   *it = T(i % run); break;
+    case workload::few_unique: *it = T(rng() >> 62); break;
+    case workload::all_equal:  *it = T(1); break;
+    }
+  }
+}
+
+template <typename Sort>
+std::vector<int>
+adversarial_workload(std::size_t n, Sort sort) {
+  int const gas = int(n);                       // larger than every solid value
+  std::vector<int> value(n, gas), index(n);
+  int solid = 0;
+  int candidate = 0;
+  for (std::size_t i = 0; i < n; ++i)
+    index[i] = int(i);
+  auto comp = [&](int x, int y) {
+    if (value[x] == gas && value[y] == gas) {
+      if (x == candidate)
+        value[x] = solid++;
+      else
+        value[y] = solid++;
+    }
+    if (value[x] == gas)
+      candidate = x;
+    else if (value[y] == gas)
+      candidate = y;
+    return value[x] < value[y];
+  };
+  sort(index.begin(), index.end(), comp);
+  return value;
+}
+} /* base */
@@ -0,0 +1,212 @@
+/* -*-coding:raw-text-unix-*-
+ *
+ * base/rcu.h -- read-copy-update cell with epoch-based reclamation
+ */
+#pragma once
+
+#include <base/details/cc.h>    // CACHELINE_SIZE
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace base {
+namespace details {
+/**
+ * Per-thread reader slot of the process-wide RCU domain. A reader only ever
+ * writes its own cache line: the epoch it entered a read-side section in, or
+ * zero while it is outside.
+ */
+struct alignas(CACHELINE_SIZE) rcu_reader {
+  std::atomic<std::uint64_t> epoch {0};
+  std::atomic<bool> used {false};
+};
+
+/** Number of threads that can use read-side sections at the same time. */
+constexpr int rcu_max_readers = 512;
+
+extern std::atomic<std::uint64_t> g_rcu_epoch;
+
+/**
+ * Allocate the slot of the calling thread. Called on the first read-side
+ * section of a thread; the slot is freed when the thread exits.
+ */
+rcu_reader* rcu_register_reader();
+
+/** Increment the epoch and return the new value. */
+std::uint64_t rcu_advance_epoch();
+
+/** Smallest epoch of all readers inside a read-side section, or UINT64_MAX. */
+std::uint64_t rcu_oldest_reader();
+
+inline
+rcu_reader*&
+rcu_this_reader() noexcept {
+  static thread_local rcu_reader* reader = nullptr;
+  return reader;
+}
+
+inline
+unsigned&
+rcu_depth() noexcept {
+  static thread_local unsigned depth = 0;
+  return depth;
+}
+} // details
+
+/**
+ * @brief RAII read-side critical section
+ *
+ * Versions of an @ref rcu_cell that were current while a read_guard exists on
+ * any thread are not freed until the guard is gone. Entering and leaving
+ * costs one store each into a cache line owned by the calling thread; read
+ * sections nest.
+ *
+ * The first read_guard on a thread registers a slot for it (one atomic
+ * operation on a shared array); real-time threads should do this once before
+ * entering their loop, e.g. by reading the cell.
+ */
+class read_guard {
+public:
+  read_guard() noexcept;
+  ~read_guard();
+  read_guard(read_guard const&) = delete;
+  read_guard& operator = (read_guard const&) = delete;
+};
+
+/**
+ * @brief Value published by copy-and-replace; readers never block
+ *
+ * Writers allocate a new version and swap the pointer atomically; readers
+ * load the pointer inside a @ref read_guard and never take a lock, never wait
+ * and never write a cache line shared with other threads. Replaced versions
+ * are freed by @ref reclaim() once no reader can reference them anymore.
+ * store() calls reclaim(), so versions are freed on the writer's thread, which
+ * should not be a real-time thread.
+ *
+ * Example:
+ *
+ *     base::rcu_cell<config> cfg;
+ *
+ *     // supervisor thread
+ *     cfg.store(load_config());
+ *
+ *     // real-time thread: bounded cost, never blocked by the writer
+ *     double gain = cfg.read([](config const& c) { return c.gain; });
+ */
+template <typename T>
+class rcu_cell {
+public:
+  explicit rcu_cell(T value = T {});
+  ~rcu_cell();
+
+  rcu_cell(rcu_cell const&) = delete;
+  rcu_cell& operator = (rcu_cell const&) = delete;
+
+  /** Copy the current version. */
+  T load() const;
+
+  /** Call f with a reference to the current version inside a read section. */
+  template <typename F>
+  auto read(F&& f) const -> decltype(f(std::declval<T const&>()));
+
+  /** Publish a new version. Serialized with other writers by a mutex. */
+  void store(T value);
+
+  /**
+   * Free replaced versions that no reader can see anymore.
+   *
+   * @return Number of versions still waiting for readers.
+   */
+  std::size_t reclaim();
+
+private:
+  std::size_t reclaim_locked();
+
+  std::atomic<T const*> current_;
+  std::mutex writer_;
+  std::vector<std::pair<std::uint64_t, T const*>> retired_;
+};
+
+/***********************************************************************
+ * inlined implementation
+ */
+inline
+read_guard::read_guard() noexcept {
+  using namespace details;
+  if (rcu_depth()++ == 0) {
+    rcu_reader* r = rcu_this_reader() ? rcu_this_reader() : rcu_register_reader();
+    /* seq_cst orders the store before the loads of the protected pointers */
+    r->epoch.store(g_rcu_epoch.load(std::memory_order_acquire), std::memory_order_seq_cst);
+  }
+}
+
+inline
+read_guard::~read_guard() {
+  using namespace details;
+  if (--rcu_depth() == 0)
+    rcu_this_reader()->epoch.store(0, std::memory_order_release);
+}
+
+template <typename T>
+rcu_cell<T>::rcu_cell(T value)
+  : current_ {new T(std::move(value))} { }
+
+template <typename T>
+rcu_cell<T>::~rcu_cell() {
+  for (auto& r : retired_)
+    delete r.second;
+  delete current_.load();
+}
+
+template <typename T>
+T
+rcu_cell<T>::load() const {
+  read_guard guard;
+  return *current_.load(std::memory_order_seq_cst);
+}
+
+template <typename T>
+template <typename F>
+auto
+rcu_cell<T>::read(F&& f) const -> decltype(f(std::declval<T const&>())) {
+  read_guard guard;
+  return f(*current_.load(std::memory_order_seq_cst));
+}
+
+template <typename T>
+void
+rcu_cell<T>::store(T value) {
+  T const* fresh = new T(std::move(value));
+  std::lock_guard<std::mutex> lock {writer_};
+  T const* old = current_.exchange(fresh, std::memory_order_seq_cst);
+  /* readers that can still see old entered before this epoch */
+  retired_.emplace_back(details::rcu_advance_epoch(), old);
+  reclaim_locked();
+}
+
+template <typename T>
+std::size_t
+rcu_cell<T>::reclaim() {
+  std::lock_guard<std::mutex> lock {writer_};
+  return reclaim_locked();
+}
+
+template <typename T>
+std::size_t
+rcu_cell<T>::reclaim_locked() {
+  auto const oldest = details::rcu_oldest_reader();
+  for (std::size_t i = 0; i < retired_.size(); ) {
+    if (retired_[i].first <= oldest) {
+      delete retired_[i].second;
+      retired_[i] = retired_.back();
+      retired_.pop_back();
+    } else {
+      ++i;
+    }
+  }
+  return retired_.size();
+}
+} /* base */
@@ -0,0 +1,121 @@
+/* -*-coding:raw-text-unix-*-
+ *
+ * base/seqlock.h -- publish the latest value to many readers, writer never waits
+ */
+#pragma once
+
+#include <base/details/cc.h>    // CACHELINE_SIZE
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>              // std::memcpy
+#include <type_traits>
+
+namespace base {
+/**
+ * @brief Sequence lock for a trivially copyable value
+ *
+ * A single writer publishes snapshots without ever waiting; any number of
+ * readers copy the latest snapshot and retry if the writer modified it during
+ * the copy. Readers never write to the shared cache line, so the cost of
+ * store() does not depend on the number of readers.
+ *
+ * The value is kept in relaxed atomic words, which makes concurrent reads
+ * free of data races while compiling to plain loads and stores.
+ *
+ * Example:
+ *
+ *     base::seqlock<pose> latest;
+ *
+ *     // real-time task (the only writer)
+ *     latest.store(estimate());
+ *
+ *     // any other thread
+ *     pose p = latest.load();
+ *
+ * Readers may be delayed by a writer that stores faster than one read takes,
+ * so the writer should be the thread with the tighter deadline.
+ */
+template <typename T>
+class alignas(CACHELINE_SIZE) seqlock {
+  static_assert(std::is_trivially_copyable<T>::value, "seqlock<T> requires a trivially copyable T");
+public:
+  using value_type = T;
+
+  seqlock() noexcept : seqlock {T {}} { }
+  explicit seqlock(T const& value) noexcept { store(value); }
+
+  seqlock(seqlock const&) = delete;
+  seqlock& operator = (seqlock const&) = delete;
+
+  /** Publish a new value. Must not be called by more than one thread at a time. */
+  void store(T const& value) noexcept;
+
+  /** Copy the latest value, retrying while the writer is active. */
+  T load() const noexcept;
+
+  /**
+   * Make one attempt to copy the latest value.
+   *
+   * @return False if the writer interfered, result is undefined in this case.
+   */
+  bool try_load(T& result) const noexcept;
+
+  /** Number of values published so far, including the initial one. */
+  std::uint64_t version() const noexcept;
+
+private:
+  static constexpr std::size_t words =
+      (sizeof(T) + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t);
+
+  std::atomic<std::uint64_t> seq_ {0};
+  std::atomic<std::uint64_t> data_[words];
+};
+
+/***********************************************************************
+ * inlined implementation
+ */
+template <typename T>
+void
+seqlock<T>::store(T const& value) noexcept {
+  std::uint64_t buf[words] {};
+  std::memcpy(buf, &value, sizeof(T));
+  auto const seq = seq_.load(std::memory_order_relaxed);
+  seq_.store(seq + 1, std::memory_order_relaxed); // odd: write in progress
+  std::atomic_thread_fence(std::memory_order_release);
+  for (std::size_t i = 0; i < words; ++i)
+    data_[i].store(buf[i], std::memory_order_relaxed);
+  seq_.store(seq + 2, std::memory_order_release);
+}
+
+template <typename T>
+bool
+seqlock<T>::try_load(T& result) const noexcept {
+  std::uint64_t buf[words];
+  auto const seq1 = seq_.load(std::memory_order_acquire);
+  if (seq1 & 1)
+    return false;
+  for (std::size_t i = 0; i < words; ++i)
+    buf[i] = data_[i].load(std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (seq_.load(std::memory_order_relaxed) != seq1)
+    return false;
+  std::memcpy(&result, buf, sizeof(T));
+  return true;
+}
+
+template <typename T>
+T
+seqlock<T>::load() const noexcept {
+  T result;
+  while (!try_load(result))
+    ;
+  return result;
+}
+
+template <typename T>
+std::uint64_t
+seqlock<T>::version() const noexcept {
+  return seq_.load(std::memory_order_acquire) / 2;
+}
+} /* base */
@@ -0,0 +1,344 @@
+/* -*-coding:raw-text-unix-*-
+ *
+ * base/sort.h -- sorting with bounded time and without allocation
+ */
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <utility>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace base {
+/**
+ * @brief Heapsort
+ *
+ * O(n log n) comparisons in the worst, best and average case, O(1) memory,
+ * not stable. The spread between fastest and slowest input is small, which
+ * makes it the choice for a worst-case execution time budget.
+ */
+template <typename RandomIt, typename Compare = std::less<>>
+void heap_sort(RandomIt first, RandomIt last, Compare comp = Compare {});
+
+/**
+ * @brief Introsort
+ *
+ * Quicksort with median-of-three pivots that switches to @ref heap_sort()
+ * when the recursion depth exceeds 2 log2 n, and to insertion sort for short
+ * partitions. O(n log n) in the worst case, no allocation, recursion depth at
+ * most log2 n. Faster than heap_sort() on average.
+ */
+template <typename RandomIt, typename Compare = std::less<>>
+void intro_sort(RandomIt first, RandomIt last, Compare comp = Compare {});
+
+/**
+ * @brief Insertion sort
+ *
+ * O(n^2), but the fastest algorithm for a few elements or nearly sorted
+ * input. Stable.
+ */
+template <typename RandomIt, typename Compare = std::less<>>
+void insertion_sort(RandomIt first, RandomIt last, Compare comp = Compare {});
+
+/**
+ * @brief Sorting network for a fixed number of elements
+ *
+ * Applies Batcher's odd-even merge network for N elements, generated at
+ * compile time. The sequence of compare-exchange operations does not depend
+ * on the data, and for arithmetic types each one compiles into min/max
+ * without branches, so the execution time is the same for every input.
+ *
+ * Example:
+ *
+ *     std::array<int, 8> v {5, 1, 4, 7, 3, 0, 2, 6};
+ *     base::sort_network(v);
+ */
+template <typename T, std::size_t N>
+void sort_network(std::array<T, N>& v);
+
+/**
+ * Sort four arrays of int or float at once with the network of @ref
+ * sort_network(), each array in one lane of an SSE2 register. Floats must not
+ * be NaN.
+ */
+template <typename T, std::size_t N>
+void sort_network4(std::array<std::array<T, N>, 4>& v);
+
+/** Number of compare-exchange operations of the network for n elements. */
+constexpr std::size_t network_size(std::size_t n);
+
+/***********************************************************************
+ * inlined implementation
+ */
+namespace details {
+template <typename RandomIt, typename Compare>
+void
+sift_down(RandomIt first, std::ptrdiff_t hole, std::ptrdiff_t n, Compare& comp) {
+  auto value = std::move(first[hole]);
+  for (;;) {
+    std::ptrdiff_t child = 2 * hole + 1;
+    if (child >= n)
+      break;
+    if (child + 1 < n && comp(first[child], first[child + 1]))
+      ++child;
+    if (!comp(value, first[child]))
+      break;
+    first[hole] = std::move(first[child]);
+    hole = child;
+  }
+  first[hole] = std::move(value);
+}
+
+/** Move the median of a, b and c to result. */
+template <typename RandomIt, typename Compare>
+void
+move_median_to_first(RandomIt result, RandomIt a, RandomIt b, RandomIt c, Compare& comp) {
+  if (comp(*a, *b)) {
+    if (comp(*b, *c))
+      std::iter_swap(result, b);
+    else if (comp(*a, *c))
+      std::iter_swap(result, c);
+    else
+      std::iter_swap(result, a);
+  } else if (comp(*a, *c)) {
+    std::iter_swap(result, a);
+  } else if (comp(*b, *c)) {
+    std::iter_swap(result, c);
+  } else {
+    std::iter_swap(result, b);
+  }
+}
+
+/**
+ * Partition around the median of three, which is moved to *first. The other
+ * two candidates stop both scans, so they need no bounds checks.
+ */
+template <typename RandomIt, typename Compare>
+RandomIt
+partition_pivot(RandomIt first, RandomIt last, Compare& comp) {
+  move_median_to_first(first, first + 1, first + (last - first) / 2, last - 1, comp);
+  RandomIt lo = first + 1, hi = last;
+  for (;;) {
+    while (comp(*lo, *first))
+      ++lo;
+    --hi;
+    while (comp(*first, *hi))
+      --hi;
+    if (!(lo < hi))
+      return lo;
+    std::iter_swap(lo, hi);
+    ++lo;
+  }
+}
+
+constexpr std::ptrdiff_t insertion_threshold = 16;
+
+/** Leaves partitions of up to insertion_threshold elements unsorted. */
+template <typename RandomIt, typename Compare>
+void
+intro_sort_loop(RandomIt first, RandomIt last, int depth, Compare& comp) {
+  while (last - first > insertion_threshold) {
+    if (depth-- == 0) {
+      heap_sort(first, last, comp);
+      return;
+    }
+    RandomIt cut = partition_pivot(first, last, comp);
+    /* recurse into the smaller part, iterate over the larger one */
+    if (cut - first < last - cut) {
+      intro_sort_loop(first, cut, depth, comp);
+      first = cut;
+    } else {
+      intro_sort_loop(cut, last, depth, comp);
+      last = cut;
+    }
+  }
+}
+
+constexpr int
+log2_floor(std::size_t n) {
+  int k = 0;
+  while (n >>= 1)
+    ++k;
+  return k;
+}
+
+/**
+ * Batcher's odd-even merge sort for arbitrary n. Calls f(i, j) for each
+ * comparator, i < j.
+ */
+template <typename F>
+constexpr void
+for_each_comparator(std::size_t n, F& f) {
+  for (std::size_t p = 1; p < n; p <<= 1)
+    for (std::size_t k = p; k >= 1; k >>= 1)
+      for (std::size_t j = k % p; j + k < n; j += 2 * k)
+        for (std::size_t i = 0; i < k && i + j + k < n; ++i)
+          if ((i + j) / (2 * p) == (i + j + k) / (2 * p))
+            f(i + j, i + j + k);
+}
+
+struct comparator_counter {
+  constexpr void operator () (std::size_t, std::size_t) { ++count; }
+  std::size_t count;
+};
+
+template <std::size_t N>
+struct network {
+  static constexpr std::size_t size = base::network_size(N);
+  std::uint16_t a[size ? size : 1];
+  std::uint16_t b[size ? size : 1];
+  std::size_t n;
+
+  constexpr void operator () (std::size_t i, std::size_t j) {
+    a[n] = std::uint16_t(i);
+    b[n] = std::uint16_t(j);
+    ++n;
+  }
+};
+
+template <std::size_t N>
+constexpr network<N>
+make_network() {
+  network<N> net {{}, {}, 0};
+  for_each_comparator(N, net);
+  return net;
+}
+
+template <std::size_t N>
+struct network_of {
+  static constexpr network<N> value = make_network<N>();
+};
+
+template <std::size_t N>
+constexpr network<N> network_of<N>::value;
+
+struct compare_exchange {
+  template <typename T>
+  void operator () (T& a, T& b) const {
+    T const x = a, y = b;
+    a = std::min(x, y);
+    b = std::max(x, y);
+  }
+};
+
+/** Fully unrolled, so that all indices are constants. */
+template <std::size_t N, typename V, typename CompareExchange, std::size_t... I>
+inline void
+apply_network(V& v, CompareExchange cx, std::index_sequence<I...>) {
+  using net = network_of<N>;
+  int const unused[] = {0, (cx(v[net::value.a[I]], v[net::value.b[I]]), 0)...};
+  (void)unused;
+}
+
+#ifdef __SSE2__
+template <typename T> struct simd4;
+
+template <>
+struct simd4<int> {
+  using type = __m128i;
+  static type set(int a, int b, int c, int d) { return _mm_setr_epi32(a, b, c, d); }
+  static void get(type v, int* out) { _mm_storeu_si128(reinterpret_cast<type*>(out), v); }
+  /* SSE2 has no _mm_min_epi32: select with a compare mask */
+  void operator () (type& a, type& b) const {
+    type const gt = _mm_cmpgt_epi32(a, b);
+    type const lo = _mm_or_si128(_mm_and_si128(gt, b), _mm_andnot_si128(gt, a));
+    type const hi = _mm_or_si128(_mm_and_si128(gt, a), _mm_andnot_si128(gt, b));
+    a = lo;
+    b = hi;
+  }
+};
+
+template <>
+struct simd4<float> {
+  using type = __m128;
+  static type set(float a, float b, float c, float d) { return _mm_setr_ps(a, b, c, d); }
+  static void get(type v, float* out) { _mm_storeu_ps(out, v); }
+  void operator () (type& a, type& b) const {
+    type const lo = _mm_min_ps(a, b);
+    b = _mm_max_ps(a, b);
+    a = lo;
+  }
+};
+#endif
+} // details
+
+constexpr std::size_t
+network_size(std::size_t n) {
+  details::comparator_counter c {0};
+  details::for_each_comparator(n, c);
+  return c.count;
+}
+
+template <typename RandomIt, typename Compare>
+void
+insertion_sort(RandomIt first, RandomIt last, Compare comp) {
+  if (first == last)
+    return;
+  for (RandomIt i = first + 1; i != last; ++i) {
+    auto value = std::move(*i);
+    RandomIt j = i;
+    for (; j != first && comp(value, *(j - 1)); --j)
+      *j = std::move(*(j - 1));
+    *j = std::move(value);
+  }
+}
+
+template <typename RandomIt, typename Compare>
+void
+heap_sort(RandomIt first, RandomIt last, Compare comp) {
+  std::ptrdiff_t const n = last - first;
+  for (std::ptrdiff_t i = n / 2 - 1; i >= 0; --i)
+    details::sift_down(first, i, n, comp);
+  for (std::ptrdiff_t end = n - 1; end > 0; --end) {
+    std::iter_swap(first, first + end);
+    details::sift_down(first, 0, end, comp);
+  }
+}
+
+template <typename RandomIt, typename Compare>
+void
+intro_sort(RandomIt first, RandomIt last, Compare comp) {
+  if (last - first < 2)
+    return;
+  details::intro_sort_loop(first, last, 2 * details::log2_floor(last - first), comp);
+  /* each element is at most insertion_threshold places off */
+  insertion_sort(first, last, comp);
+}
+
+template <typename T, std::size_t N>
+void
+sort_network(std::array<T, N>& v) {
+  static_assert(N <= 256, "sorting networks are meant for small arrays");
+  details::apply_network<N>(v, details::compare_exchange {},
+                            std::make_index_sequence<details::network<N>::size> {});
+}
+
+template <typename T, std::size_t N>
+void
+sort_network4(std::array<std::array<T, N>, 4>& v) {
+#ifdef __SSE2__
+  using simd = details::simd4<T>;
+  typename simd::type lanes[N ? N : 1];
+  for (std::size_t i = 0; i < N; ++i)
+    lanes[i] = simd::set(v[0][i], v[1][i], v[2][i], v[3][i]);
+  details::apply_network<N>(lanes, simd {},
+                            std::make_index_sequence<details::network<N>::size> {});
+  for (std::size_t i = 0; i < N; ++i) {
+    alignas(16) T out[4];
+    simd::get(lanes[i], out);
+    for (int k = 0; k < 4; ++k)
+      v[k][i] = out[k];
+  }
+#else
+  for (auto& a : v)
+    sort_network(a);
+#endif
+}
+} /* base */
@@ -4,13 +4,143 @@
  */
 #pragma once
 
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <iterator>
 #include <string>
+#include <utility>
 #include <vector>
-#include <cstdio>
+
+#if __cplusplus >= 201703L
+#include <string_view>
+#else
+#include <experimental/string_view>
+#endif
 
 #include <base/details/cc.h>
 
 namespace base {
+#if __cplusplus >= 201703L
+using std::string_view;
+#else
+using std::experimental::string_view;
+#endif
+
+/**
+ * @brief String with a fixed capacity and no heap allocation
+ *
+ * Holds up to N characters plus a terminating zero. Appending more
+ * characters than fit truncates the string and sets @ref truncated(), so it
+ * can be used on error paths of real-time threads.
+ *
+ * Example:
+ *
+ *     base::static_string<64> msg {"deadline missed: "};
+ *     base::format_to(msg, "%ldus", usec);
+ *     log(msg.c_str());
+ */
+template <std::size_t N>
+class static_string {
+public:
+  static_string() noexcept { data_[0] = '\0'; }
+  static_string(char const* s) noexcept : static_string {} { append(s); }
+  static_string(string_view s) noexcept : static_string {} { append(s); }
+
+  char const* c_str() const noexcept { return data_; }
+  char const* data() const noexcept { return data_; }
+  std::size_t size() const noexcept { return size_; }
+  bool empty() const noexcept { return size_ == 0; }
+  static constexpr std::size_t capacity() noexcept { return N; }
+
+  /** True if characters were dropped since construction or clear(). */
+  bool truncated() const noexcept { return truncated_; }
+
+  char const* begin() const noexcept { return data_; }
+  char const* end() const noexcept { return data_ + size_; }
+
+  void clear() noexcept;
+  static_string& append(char const* s, std::size_t n) noexcept;
+  static_string& append(string_view s) noexcept { return append(s.data(), s.size()); }
+  static_string& append(char const* s) noexcept { return append(s, std::strlen(s)); }
+  static_string& operator += (char c) noexcept { return append(&c, 1); }
+  static_string& operator += (string_view s) noexcept { return append(s); }
+  static_string& operator += (char const* s) noexcept { return append(s); }
+
+  operator string_view () const noexcept { return string_view {data_, size_}; }
+
+private:
+  template <std::size_t M, typename ...Args>
+  friend std::size_t format_to(static_string<M>&, char const*, Args&&...) noexcept;
+
+  std::size_t size_ = 0;
+  bool truncated_ = false;
+  char data_[N + 1];
+};
+
+/**
+ * snprintf() into a caller-provided buffer. Formats once, never allocates.
+ *
+ * @return Number of characters written without the terminating zero; less
+ *         than the formatted length if the buffer was too small.
+ */
+template <typename ...Args>
+std::size_t format_to(char* buffer, std::size_t size, char const* format, Args&&... args) noexcept;
+
+/** Append formatted text to a @ref static_string, truncating if necessary. */
+template <std::size_t N, typename ...Args>
+std::size_t format_to(static_string<N>&, char const* format, Args&&... args) noexcept;
+
+/**
+ * @brief Splits a string into views without allocating
+ *
+ * Skips empty tokens like @ref split(). The tokens refer to the input, which
+ * must outlive them.
+ *
+ * Example:
+ *
+ *     for (base::string_view field : base::tokenizer {"0-3,8,12-15", ','})
+ *       parse_range(field);
+ */
+class tokenizer {
+public:
+  class iterator;
+
+  tokenizer(string_view str, char sep = ' ') noexcept : rest_ {str}, sep_ {sep} { }
+
+  /** Store the next token in token. False if there is none left. */
+  bool next(string_view& token) noexcept;
+
+  iterator begin() noexcept;
+  iterator end() noexcept;
+
+private:
+  string_view rest_;
+  char sep_;
+};
+
+class tokenizer::iterator {
+public:
+  using iterator_category = std::input_iterator_tag;
+  using value_type = string_view;
+  using difference_type = std::ptrdiff_t;
+  using pointer = string_view const*;
+  using reference = string_view const&;
+
+  iterator() noexcept = default;
+  explicit iterator(tokenizer* t) noexcept : tokenizer_ {t} { ++*this; }
+
+  reference operator * () const noexcept { return token_; }
+  pointer operator -> () const noexcept { return &token_; }
+  iterator& operator ++ () noexcept;
+  bool operator == (iterator const& o) const noexcept { return tokenizer_ == o.tokenizer_; }
+  bool operator != (iterator const& o) const noexcept { return tokenizer_ != o.tokenizer_; }
+
+private:
+  tokenizer* tokenizer_ = nullptr;
+  string_view token_;
+};
+
 /**
  * Join std::strings at ' '.
  */
@@ -18,11 +148,15 @@ inline
 std::string
 join(std::vector<std::string> const &v, char sep = ' ') {
   using namespace std;
+  size_t size = v.empty() ? 0 : v.size() - 1;
+  for (auto const& s : v)
+    size += s.size();
   string R;
+  R.reserve(size);
   for (vector<string>::const_iterator i = v.begin(); i != v.end(); i++) {
-    R += *i;
-    if (i == v.end() - 1)
+    if (i != v.begin())
       R += sep;
+    R += *i;
   }
   return R;
 }
@@ -41,20 +175,28 @@ split(std::string const& str, char sep = ' ') {
       result.push_back(str.substr(pos, stop - pos));
     pos = stop + 1;
   }
-  if (stop != pos)
+  if (pos < str.size())
     result.push_back(str.substr(pos));
   return result;
 }
 
 /**
  * Sprintf for std::string.
+ *
+ * Allocates; on real-time paths use @ref format_to() instead.
  */
 template <typename ...Args>
 std::string
 sprintf(std::string format, Args && ...args) {
-  auto size = std::snprintf(nullptr, 0, format.c_str(), std::forward<Args>(args)...);
+  char local[256];              // format only once in the common case
+  int size = std::snprintf(local, sizeof local, format.c_str(), args...);
+  if (size < 0)
+    return std::string {};
+  if (std::size_t(size) < sizeof local)
+    return std::string(local, size);
   std::string buffer(size + 1, '\0');
-  std::sprintf(&buffer[0], format.c_str(), std::forward<Args>(args)...);
+  std::snprintf(&buffer[0], buffer.size(), format.c_str(), std::forward<Args>(args)...);
+  buffer.resize(size);
   return buffer;
 }
 
@@ -72,4 +214,92 @@ unquote(std::string str, char front = '"', char back = '"') {
   }
   return str;
 }
+
+/***********************************************************************
+ * inlined implementation
+ */
+template <std::size_t N>
+void
+static_string<N>::clear() noexcept {
+  size_ = 0;
+  truncated_ = false;
+  data_[0] = '\0';
+}
+
+template <std::size_t N>
+static_string<N>&
+static_string<N>::append(char const* s, std::size_t n) noexcept {
+  std::size_t const room = N - size_;
+  if (n > room) {
+    n = room;
+    truncated_ = true;
+  }
+  std::memcpy(data_ + size_, s, n);
+  size_ += n;
+  data_[size_] = '\0';
+  return *this;
+}
+
+template <typename ...Args>
+std::size_t
+format_to(char* buffer, std::size_t size, char const* format, Args&&... args) noexcept {
+  if (size == 0)
+    return 0;
+  int const n = std::snprintf(buffer, size, format, args...);
+  if (n < 0) {
+    buffer[0] = '\0';
+    return 0;
+  }
+  return std::min<std::size_t>(n, size - 1);
+}
+
+template <std::size_t N, typename ...Args>
+std::size_t
+format_to(static_string<N>& s, char const* format, Args&&... args) noexcept {
+  int const n = std::snprintf(s.data_ + s.size_, N + 1 - s.size_, format, args...);
+  if (n < 0) {
+    s.data_[s.size_] = '\0';
+    return 0;
+  }
+  std::size_t written = n;
+  if (written > N - s.size_) {
+    written = N - s.size_;
+    s.truncated_ = true;
+  }
+  s.size_ += written;
+  return written;
+}
+
+inline
+bool
+tokenizer::next(string_view& token) noexcept {
+  while (!rest_.empty() && rest_.front() == sep_)
+    rest_.remove_prefix(1);
+  if (rest_.empty())
+    return false;
+  std::size_t const stop = std::min(rest_.find(sep_), rest_.size());
+  token = rest_.substr(0, stop);
+  rest_.remove_prefix(stop);
+  return true;
+}
+
+inline
+tokenizer::iterator
+tokenizer::begin() noexcept {
+  return iterator {this};
+}
+
+inline
+tokenizer::iterator
+tokenizer::end() noexcept {
+  return iterator {};
+}
+
+inline
+tokenizer::iterator&
+tokenizer::iterator::operator ++ () noexcept {
+  if (tokenizer_ && !tokenizer_->next(token_))
+    tokenizer_ = nullptr;
+  return *this;
+}
 } /* base */
@@ -8,12 +8,61 @@
 #include <base/string.h>
 #include <base/verify.h>
 
+#include <cstddef>
+#include <cstdint>
+#include <cstring>              // std::strerror
 #include <stdexcept>
 #include <thread>
-#include <memory>
-#include <cstring>              // std::strerror
+#include <type_traits>
 
 namespace base {
+/**
+ * @brief Stack of a new thread
+ *
+ * Under mlockall(MCL_CURRENT | MCL_FUTURE) every thread stack is locked into
+ * RAM as a whole, and the default size is RLIMIT_STACK, usually 8MiB. Threads
+ * that need a few KiB should say so.
+ *
+ * The guard pages below the stack catch overflows with a segmentation fault.
+ * A stack at addr, like one on huge pages, has no guard pages and must outlive
+ * the thread. prefault, lock and watermark take effect in @ref prepare_stack(), which
+ * runs on the new thread itself.
+ */
+struct stack_options {
+  static constexpr std::size_t default_guard = SIZE_MAX;
+
+  std::size_t size = 0;                 // bytes, 0: default of the C library
+  std::size_t guard = default_guard;    // bytes, 0: no guard pages
+  void* addr = nullptr;                 // memory of size bytes owned by the caller
+  bool prefault = false;                // touch every page before running
+  bool lock = false;                    // mlock() the whole stack, implies prefault
+  bool watermark = false;               // fill with a pattern to measure the peak
+};
+
+/**
+ * Set stack size and guard size or the stack of thread attributes.
+ *
+ * @return 0 or the error number of pthread_attr_setstacksize(),
+ *         pthread_attr_setguardsize() or pthread_attr_setstack().
+ */
+int set_stack_attributes(::pthread_attr_t*, stack_options const&) noexcept;
+
+/**
+ * Prepare the stack of the calling thread as requested by the options: write
+ * every page below the current frame so that no page fault happens later,
+ * mlock() it into RAM (also under mlockall(), where that is redundant), and
+ * fill it with a pattern for @ref stack_high_water_mark(). Call it first thing
+ * in the thread function. Does nothing on the main thread, whose stack grows
+ * on demand.
+ */
+void prepare_stack(stack_options const&) noexcept;
+
+/**
+ * Peak number of bytes of its stack the calling thread has used so far, 0 if
+ * @ref prepare_stack() did not fill the stack with the pattern.
+ */
+std::size_t stack_high_water_mark() noexcept;
+
 /**
  * Lightweight, trivially copyable class that serves as a unique identifier of
  * schedulabe objects. Like std::thread is can be used as key in associative
@@ -21,27 +70,55 @@ namespace base {
  *
  * Instances of this class may also hold the special distinct value that does
  * not represent any thread.
+ *
+ * The thread attributes only exist on the stack while the thread is created.
+ * A failure is kept as the errno value and the failing call; @ref
+ * last_error() formats it only when asked, so a handle never allocates and
+ * is not much larger than a pthread_t.
  */
 struct thread {
   using handle = pthread_t;
 
   typedef void*(*function)(void*);
 
+  /** The pthread call that failed. */
+  enum class call : std::uint8_t {
+    none, attr_init, attr_setdetachstate, attr_setinheritsched, attr_setschedpolicy,
+    attr_setschedparam, attr_setstack, create, join
+  };
+
   thread();
   thread(function funp, void* argp = nullptr);
   thread(int policy, int priority, function funp, void* argp = nullptr);
 
+  /** Only size and guard are applied; the thread function calls @ref
+      prepare_stack() itself. */
+  thread(int policy, int priority, stack_options const&, function funp, void* argp = nullptr);
+
   void join();
 
   explicit operator bool() const noexcept { return joinable; }
 
-  std::shared_ptr<::pthread_attr_t> attrp {};
-  std::shared_ptr<::sched_param> schp {};
-  bool joinable = false;
-  std::string last_error;
+  /** Description of the last failure or an empty string. Allocates. */
+  std::string last_error() const;
+
   handle id {};
+  int errnum = 0;               // of the failed call
+  call failed = call::none;
+  bool joinable = false;
 };
 
+static_assert(std::is_trivially_copyable<thread>::value, "base::thread is a plain handle");
+static_assert(sizeof(thread) <= sizeof(pthread_t) + sizeof(void*), "base::thread is compact");
+
+/**
+ * Set scheduling policy and priority of a running thread.
+ *
+ * @return 0 or the error number of pthread_setschedparam(). ESRCH (the thread
+ *         has already exited) counts as success.
+ */
+int set_scheduling(pthread_t, int policy, int priority) noexcept;
+
 /**
  * Try to modify scheduling policy and priority of a running std::thread. Turns
  * the std::thread into a realtime thread.
@@ -107,17 +184,12 @@ thread::thread(function funp, void* argp)
   : thread {SCHED_OTHER, 0, funp, argp} { }
 
 inline
-thread::thread(int policy, int priority, function funp, void* argp) {
-  if (funp) {
-    /* initialize structures */
-    attrp.reset(new ::pthread_attr_t);
-    schp.reset(new ::sched_param);
-    if (int errnum = pthread_attr_init(attrp.get())) {
-      last_error = base::sprintf("pthread_attr_init() failed: '%s'", std::strerror(errnum));
-      return;
-    }
-    schp->sched_priority = priority;
+thread::thread(int policy, int priority, function funp, void* argp)
+  : thread {policy, priority, stack_options {}, funp, argp} { }
 
+inline
+thread::thread(int policy, int priority, stack_options const& stack, function funp, void* argp) {
+  if (funp) {
     switch (policy) {
     case SCHED_FIFO:
     case SCHED_RR:
@@ -126,74 +198,88 @@ thread::thread(int policy, int priority, function funp, void* argp) {
       break;
     }
 
-    if (int errnum = pthread_attr_setdetachstate(attrp.get(), PTHREAD_CREATE_JOINABLE)) {
-      last_error = base::sprintf("pthread_attr_setdetachstate(PTHREAD_CREATE_JOINABLE) failed: '%s'", std::strerror(errnum));
-      return;
-    }
-    if (int errnum = pthread_attr_setinheritsched(attrp.get(), PTHREAD_EXPLICIT_SCHED)) {
-      last_error = base::sprintf("pthread_attr_setinheritsched(PTHREAD_EXPLICIT_SCHED) failed: '%s'", std::strerror(errnum));
-      return;
-    }
-    if (int errnum = pthread_attr_setschedpolicy(attrp.get(), policy)) {
-      last_error = base::sprintf("FAILED: pthread_attr_setschedpolicy(%d): '%s'", policy, std::strerror(errnum));
-      return;
-    }
-    if (int errnum = pthread_attr_setschedparam(attrp.get(), schp.get())) {
-      last_error = base::sprintf("FAILED: pthread_attr_setschedparam(%d): '%s'", schp->sched_priority, std::strerror(errnum));
-      return;
-    }
-
-    /* create thread */
-    if (int errnum = pthread_create(&id, attrp.get(), funp, argp)) {
-      last_error = base::sprintf("thread() ctor failed: '%s'", std::strerror(errnum));
+    ::pthread_attr_t attr;
+    if ((errnum = pthread_attr_init(&attr))) {
+      failed = call::attr_init;
       return;
     }
-    joinable = true;
+    ::sched_param sch {};
+    sch.sched_priority = priority;
+    if ((errnum = pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_JOINABLE)))
+      failed = call::attr_setdetachstate;
+    else if ((errnum = pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED)))
+      failed = call::attr_setinheritsched;
+    else if ((errnum = pthread_attr_setschedpolicy(&attr, policy)))
+      failed = call::attr_setschedpolicy;
+    else if ((errnum = pthread_attr_setschedparam(&attr, &sch)))
+      failed = call::attr_setschedparam;
+    else if ((errnum = set_stack_attributes(&attr, stack)))
+      failed = call::attr_setstack;
+    else if ((errnum = pthread_create(&id, &attr, funp, argp)))   /* create thread */
+      failed = call::create;
+    else
+      joinable = true;
+    pthread_attr_destroy(&attr);
   }
 }
 
 inline
 void
 thread::join() {
-  if (int errnum = pthread_join(id, 0)) {
-    last_error = base::sprintf("thread::join() failed: '%s'", std::strerror(errnum));
+  if ((errnum = pthread_join(id, 0))) {
+    failed = call::join;
   } else {
     joinable = false;
-    last_error.clear();
+    failed = call::none;
   }
 }
 
 inline
-bool
-try_scheduling(std::thread& th, int new_policy, int new_priority, std::string* errorp) noexcept {
+std::string
+thread::last_error() const {
+  char const* what = "";
+  switch (failed) {
+  case call::none:                 return std::string {};
+  case call::attr_init:            what = "pthread_attr_init()"; break;
+  case call::attr_setdetachstate:  what = "pthread_attr_setdetachstate(PTHREAD_CREATE_JOINABLE)";
+                                   break;
+  case call::attr_setinheritsched: what = "pthread_attr_setinheritsched(PTHREAD_EXPLICIT_SCHED)";
+                                   break;
+  case call::attr_setschedpolicy:  what = "pthread_attr_setschedpolicy()"; break;
+  case call::attr_setschedparam:   what = "pthread_attr_setschedparam()"; break;
+  case call::attr_setstack:        what = "pthread_attr_setstacksize()"; break;
+  case call::create:               what = "thread() ctor"; break;
+  case call::join:                 what = "thread::join()"; break;
+  }
+  return base::sprintf("%s failed: '%s'", what, std::strerror(errnum));
+}
+
+inline
+int
+set_scheduling(pthread_t th, int new_policy, int new_priority) noexcept {
   switch (new_policy) {
   case SCHED_FIFO:
   case SCHED_RR:
     VERIFY(new_priority > 0);
     break;
   }
+  sched_param sch {};
+  sch.sched_priority = new_priority;
+  int const errnum = pthread_setschedparam(th, new_policy, &sch);
+  /* ESRCH ("No such process") means the thread has already exited. Note
+     that std::thread::joinable() returns true for exited threads. */
+  return errnum == ESRCH ? 0 : errnum;
+}
+
+inline
+bool
+try_scheduling(std::thread& th, int new_policy, int new_priority, std::string* errorp) noexcept {
   if (false == th.joinable())
     return true;
-  /* get current policy and priority */
-  sched_param sch;
-  int policy;
-  pthread_getschedparam(th.native_handle(), &policy, &sch);
-  /* set new policy and priority */
-  sch.sched_priority = new_priority;
-  if (int errnum = pthread_setschedparam(th.native_handle(), new_policy, &sch)) {
-    switch (errnum) {
-    case ESRCH:
-      /* The thread is not available ("No such process"). This means it has
-         already exited. Note that std::thread::joinable() returns true for
-         exited threads. */
-      return true;
-    case EINVAL:
-    case EPERM:
-    default:
-      if (errorp)
-        *errorp = base::sprintf("FAILED: pthread_setschedparam(): '%s'", std::strerror(errnum));
-      return false;
-    }
+  if (int errnum = set_scheduling(th.native_handle(), new_policy, new_priority)) {
+    if (errorp)
+      *errorp = base::sprintf("FAILED: pthread_setschedparam(): '%s'", std::strerror(errnum));
+    return false;
   }
   return true;
 }
@@ -205,7 +291,7 @@ change_scheduling(std::thread& th, int new_policy, int new_priority, std::string
   if (errorp == nullptr)
     errorp = &error;
   if (false == try_scheduling(th, new_policy, new_priority, errorp)) {
-    base::quick_exit(error.c_str());
+    base::quick_exit(errorp->c_str());
   }
 }
 } // preempt
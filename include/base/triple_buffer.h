@@ -0,0 +1,132 @@
+/* -*-coding:raw-text-unix-*-
+ *
+ * base/triple_buffer.h -- wait-free latest-value exchange between two threads
+ */
+#pragma once
+
+#include <base/details/cc.h>    // CACHELINE_SIZE
+
+#include <atomic>
+#include <cstdint>
+#include <utility>
+
+namespace base {
+/**
+ * @brief Triple buffer for one writer and one reader, both wait-free
+ *
+ * The writer owns the back buffer, the reader the front buffer, and the third
+ * buffer is exchanged between them with a single atomic exchange. Neither
+ * side ever waits or retries, and T need not be trivially copyable.
+ *
+ * After publish() the write buffer is whichever older buffer the exchange
+ * handed back, not the value just published, so the writer must overwrite
+ * it completely; updating a few members publishes a mix of old and new state.
+ *
+ * Example:
+ *
+ *     base::triple_buffer<state> shared;
+ *
+ *     // writer
+ *     shared.write_buffer() = compute();
+ *     shared.publish();
+ *
+ *     // reader
+ *     if (shared.update())
+ *       render(shared.read_buffer());
+ *
+ * Each buffer occupies its own cache lines.
+ */
+template <typename T>
+class triple_buffer {
+public:
+  using value_type = T;
+
+  triple_buffer() = default;
+  explicit triple_buffer(T const& value);
+
+  triple_buffer(triple_buffer const&) = delete;
+  triple_buffer& operator = (triple_buffer const&) = delete;
+
+  /** Writer: buffer to fill completely before calling publish(); it holds an older value. */
+  T& write_buffer() noexcept;
+
+  /** Writer: make the write buffer the latest value. */
+  void publish() noexcept;
+
+  /** Writer: copy value into the write buffer and publish it. */
+  void write(T const& value);
+
+  /**
+   * Reader: switch to the latest published value.
+   *
+   * @return True if a new value was published since the last call.
+   */
+  bool update() noexcept;
+
+  /** Reader: the value selected by the last update(). */
+  T const& read_buffer() const noexcept;
+
+  /** Reader: update() and return the latest value. */
+  T const& read() noexcept;
+
+private:
+  static constexpr std::uint8_t fresh = 4;
+
+  struct alignas(CACHELINE_SIZE) slot {
+    T value;
+  };
+
+  slot buffers_[3];
+  alignas(CACHELINE_SIZE) std::atomic<std::uint8_t> middle_ {1};
+  alignas(CACHELINE_SIZE) std::uint8_t back_ = 0;       // writer only
+  alignas(CACHELINE_SIZE) std::uint8_t front_ = 2;      // reader only
+};
+
+/***********************************************************************
+ * inlined implementation
+ */
+template <typename T>
+triple_buffer<T>::triple_buffer(T const& value)
+  : buffers_ {{value}, {value}, {value}} { }
+
+template <typename T>
+T&
+triple_buffer<T>::write_buffer() noexcept {
+  return buffers_[back_].value;
+}
+
+template <typename T>
+void
+triple_buffer<T>::publish() noexcept {
+  back_ = middle_.exchange(back_ | fresh, std::memory_order_acq_rel) & ~fresh;
+}
+
+template <typename T>
+void
+triple_buffer<T>::write(T const& value) {
+  write_buffer() = value;
+  publish();
+}
+
+template <typename T>
+bool
+triple_buffer<T>::update() noexcept {
+  if ((middle_.load(std::memory_order_relaxed) & fresh) == 0)
+    return false;
+  front_ = middle_.exchange(front_, std::memory_order_acq_rel) & ~fresh;
+  return true;
+}
+
+template <typename T>
+T const&
+triple_buffer<T>::read_buffer() const noexcept {
+  return buffers_[front_].value;
+}
+
+template <typename T>
+T const&
+triple_buffer<T>::read() noexcept {
+  update();
+  return read_buffer();
+}
+} /* base */
@@ -3,20 +3,24 @@
  * base/utility.h -- shared_ptr_less, ptr_cast, atomic_ref
  *
  * In general this header contains tools that are not available in a specific
- * C++ standard yet. For example, std::atomic_ref are is only available in C++20
+ * C++ standard yet. For example, std::atomic_ref is only available in C++20
  * and std::optional not before C++17.
  */
 #pragma once
 
 #include <base/details/cc.h>
 
+#include <atomic>               // std::memory_order
 #include <functional>
 #include <memory>               // std::shared_ptr
 #include <mutex>                // std::lock_guard
 #include <utility>
 #include <optional>
+#include <type_traits>
 
 #include <cassert>
+#include <cstddef>
+#include <cstdint>              // std::uintptr_t
 
 #ifndef NO_BASE_MACROS
 #define BASE_LINE_VAR(var)      var ## __LINE__
@@ -48,27 +52,207 @@ struct shared_ptr_less :
 };
 
 /**
- * Like std::atomic_ref
- */
-template<typename T>
-using atomic_ref = std::shared_ptr<std::atomic<T>>;
-
-/**
- * @example
+ * @brief Non-owning atomic view of an existing object (std::atomic_ref)
+ *
+ * Applies atomic operations to an object that is not a std::atomic, e.g. a
+ * member of a struct shared with C code, a slot of a plain array or memory in
+ * a shared mapping. Like std::atomic_ref (C++20) the reference is a single
+ * pointer, never allocates, and every operation compiles to the same
+ * instruction as the corresponding std::atomic<T> operation (implemented with
+ * the GCC/Clang __atomic builtins).
  *
- *     class X;
- *     base::atomic_ref<T> ref {make_atomic_ref(X{})};
- *     ...
- *     ref = make_atomic_ref(X{});
+ * Example:
  *
- * Thread-safety is only guaranteed for the context object within the
- * smart-pointer and not the hosted value.
+ *     long counters[16];                        // plain array
+ *     base::atomic_ref<long> c {counters[3]};
+ *     c.fetch_add(1, std::memory_order_relaxed);
+ *
+ * While any atomic_ref to an object exists, the object must only be accessed
+ * through atomic_ref instances. The object must be aligned to
+ * required_alignment. Types that are not lock-free (see is_always_lock_free)
+ * need -latomic. compare_exchange compares object representations, so T
+ * should have no padding bits.
+ *
+ * Under C++20 this is std::atomic_ref.
  */
-template<typename T>
-atomic_ref<T>
-make_atomic_ref(T const& value) {
-  return std::make_shared<std::atomic<T>>(value);
-}
+#if defined(__cpp_lib_atomic_ref)
+template <typename T>
+using atomic_ref = std::atomic_ref<T>;
+#else
+template <typename T>
+class atomic_ref {
+  static_assert(std::is_trivially_copyable<T>::value,
+                "atomic_ref<T> requires a trivially copyable T");
+
+  template <typename U>
+  using if_integral = typename std::enable_if<
+      std::is_integral<U>::value && !std::is_same<U, bool>::value>::type;
+  template <typename U>
+  using if_pointer = typename std::enable_if<std::is_pointer<U>::value>::type;
+  template <typename U>
+  using if_floating = typename std::enable_if<std::is_floating_point<U>::value>::type;
+  template <typename U>
+  using difference = typename std::conditional<std::is_pointer<U>::value, std::ptrdiff_t, U>::type;
+
+  static constexpr int
+  order(std::memory_order m) noexcept { return int(m); } // same values as __ATOMIC_*
+
+  static constexpr std::memory_order
+  failure_order(std::memory_order m) noexcept {
+    return m == std::memory_order_acq_rel ? std::memory_order_acquire
+         : m == std::memory_order_release ? std::memory_order_relaxed : m;
+  }
+
+public:
+  using value_type = T;
+  using difference_type = difference<T>;
+
+  static constexpr bool is_always_lock_free = __atomic_always_lock_free(sizeof(T), 0);
+
+  /** Sizes 1, 2, 4, 8 and 16 must be naturally aligned to be lock-free. */
+  static constexpr std::size_t required_alignment =
+      (sizeof(T) & (sizeof(T) - 1)) == 0 && sizeof(T) <= 16 && sizeof(T) > alignof(T)
+      ? sizeof(T) : alignof(T);
+
+  explicit atomic_ref(T& obj) noexcept : ptr_ {std::addressof(obj)} {
+    assert(reinterpret_cast<std::uintptr_t>(ptr_) % required_alignment == 0);
+  }
+
+  atomic_ref(atomic_ref const&) noexcept = default;
+  atomic_ref& operator = (atomic_ref const&) = delete;
+
+  T operator = (T desired) const noexcept {
+    store(desired);
+    return desired;
+  }
+
+  operator T() const noexcept { return load(); }
+
+  bool is_lock_free() const noexcept {
+    return __atomic_is_lock_free(sizeof(T), ptr_);
+  }
+
+  void store(T desired, std::memory_order m = std::memory_order_seq_cst) const noexcept {
+    __atomic_store(ptr_, std::addressof(desired), order(m));
+  }
+
+  T load(std::memory_order m = std::memory_order_seq_cst) const noexcept {
+    alignas(T) unsigned char buf[sizeof(T)];
+    T* result = reinterpret_cast<T*>(buf);
+    __atomic_load(ptr_, result, order(m));
+    return *result;
+  }
+
+  T exchange(T desired, std::memory_order m = std::memory_order_seq_cst) const noexcept {
+    alignas(T) unsigned char buf[sizeof(T)];
+    T* result = reinterpret_cast<T*>(buf);
+    __atomic_exchange(ptr_, std::addressof(desired), result, order(m));
+    return *result;
+  }
+
+  bool compare_exchange_weak(T& expected, T desired, std::memory_order success,
+                             std::memory_order failure) const noexcept {
+    return __atomic_compare_exchange(ptr_, std::addressof(expected), std::addressof(desired),
+                                     true, order(success), order(failure));
+  }
+
+  bool compare_exchange_weak(T& expected, T desired,
+                             std::memory_order m = std::memory_order_seq_cst) const noexcept {
+    return compare_exchange_weak(expected, desired, m, failure_order(m));
+  }
+
+  bool compare_exchange_strong(T& expected, T desired, std::memory_order success,
+                               std::memory_order failure) const noexcept {
+    return __atomic_compare_exchange(ptr_, std::addressof(expected), std::addressof(desired),
+                                     false, order(success), order(failure));
+  }
+
+  bool compare_exchange_strong(T& expected, T desired,
+                               std::memory_order m = std::memory_order_seq_cst) const noexcept {
+    return compare_exchange_strong(expected, desired, m, failure_order(m));
+  }
+
+  /* integral types */
+
+  template <typename U = T, typename = if_integral<U>>
+  T fetch_add(T arg, std::memory_order m = std::memory_order_seq_cst) const noexcept {
+    return __atomic_fetch_add(ptr_, arg, order(m));
+  }
+
+  template <typename U = T, typename = if_integral<U>>
+  T fetch_sub(T arg, std::memory_order m = std::memory_order_seq_cst) const noexcept {
+    return __atomic_fetch_sub(ptr_, arg, order(m));
+  }
+
+  template <typename U = T, typename = if_integral<U>>
+  T fetch_and(T arg, std::memory_order m = std::memory_order_seq_cst) const noexcept {
+    return __atomic_fetch_and(ptr_, arg, order(m));
+  }
+
+  template <typename U = T, typename = if_integral<U>>
+  T fetch_or(T arg, std::memory_order m = std::memory_order_seq_cst) const noexcept {
+    return __atomic_fetch_or(ptr_, arg, order(m));
+  }
+
+  template <typename U = T, typename = if_integral<U>>
+  T fetch_xor(T arg, std::memory_order m = std::memory_order_seq_cst) const noexcept {
+    return __atomic_fetch_xor(ptr_, arg, order(m));
+  }
+
+  template <typename U = T, typename = if_integral<U>>
+  T operator &= (T arg) const noexcept { return __atomic_and_fetch(ptr_, arg, __ATOMIC_SEQ_CST); }
+
+  template <typename U = T, typename = if_integral<U>>
+  T operator |= (T arg) const noexcept { return __atomic_or_fetch(ptr_, arg, __ATOMIC_SEQ_CST); }
+
+  template <typename U = T, typename = if_integral<U>>
+  T operator ^= (T arg) const noexcept { return __atomic_xor_fetch(ptr_, arg, __ATOMIC_SEQ_CST); }
+
+  /* pointers: the builtins count bytes, std::atomic_ref counts objects */
+
+  template <typename U = T, typename = if_pointer<U>, typename = void>
+  T fetch_add(std::ptrdiff_t arg, std::memory_order m = std::memory_order_seq_cst) const noexcept {
+    auto const size = std::ptrdiff_t(sizeof(typename std::remove_pointer<U>::type));
+    return __atomic_fetch_add(ptr_, arg * size, order(m));
+  }
+
+  template <typename U = T, typename = if_pointer<U>, typename = void>
+  T fetch_sub(std::ptrdiff_t arg, std::memory_order m = std::memory_order_seq_cst) const noexcept {
+    auto const size = std::ptrdiff_t(sizeof(typename std::remove_pointer<U>::type));
+    return __atomic_fetch_sub(ptr_, arg * size, order(m));
+  }
+
+  /* floating point: compare-exchange loop like libstdc++ */
+
+  template <typename U = T, typename = if_floating<U>, typename = void, typename = void>
+  T fetch_add(T arg, std::memory_order m = std::memory_order_seq_cst) const noexcept {
+    T old = load(std::memory_order_relaxed);
+    while (!compare_exchange_weak(old, old + arg, m, std::memory_order_relaxed))
+      ;
+    return old;
+  }
+
+  template <typename U = T, typename = if_floating<U>, typename = void, typename = void>
+  T fetch_sub(T arg, std::memory_order m = std::memory_order_seq_cst) const noexcept {
+    T old = load(std::memory_order_relaxed);
+    while (!compare_exchange_weak(old, old - arg, m, std::memory_order_relaxed))
+      ;
+    return old;
+  }
+
+  /* arithmetic operators for integral, pointer and floating point types */
+
+  T operator ++ () const noexcept { return fetch_add(1) + 1; }
+  T operator ++ (int) const noexcept { return fetch_add(1); }
+  T operator -- () const noexcept { return fetch_sub(1) - 1; }
+  T operator -- (int) const noexcept { return fetch_sub(1); }
+  T operator += (difference_type arg) const noexcept { return fetch_add(arg) + arg; }
+  T operator -= (difference_type arg) const noexcept { return fetch_sub(arg) - arg; }
+
+private:
+  T* ptr_;
+};
+#endif // __cpp_lib_atomic_ref
 
 /**
  * @example
@@ -6,7 +6,23 @@
  */
 #include <base/all.h>
 
+#include <preempt/perf.h>
 #include <preempt/process.h>
 #include <preempt/thread.h>
 #include <preempt/task.h>
+#include <preempt/irq.h>
+#include <preempt/hugepage.h>
+#include <preempt/numa.h>
+#include <preempt/shm_channel.h>
+#include <preempt/tracepoint.h>
+#include <preempt/schedulability.h>
+#include <preempt/edf.h>
+#include <preempt/cyclic.h>
+#include <preempt/budget.h>
+#include <preempt/watchdog.h>
+#include <preempt/coroutine.h>
+#include <preempt/deferred.h>
+#include <preempt/timing_wheel.h>
+#include <preempt/reactor.h>
+#include <preempt/mpsc_queue.h>
 //#include <preempt/scheduler.h>
@@ -0,0 +1,103 @@
+/* -*-coding:raw-text-unix-*-
+ *
+ * preempt/budget.h -- CPU-time budget of a real-time thread
+ */
+#pragma once
+
+#include <atomic>
+#include <ctime>
+#include <stdexcept>
+#include <string>
+
+#include <signal.h>
+
+namespace preempt {
+/**
+ * What happens when a thread exceeds its @ref cpu_budget.
+ */
+enum class overrun_action {
+  none,                         // no timer; critical_task checks after run()
+  flag,                         // only set cpu_budget::expired()
+  demote,                       // flag and switch the thread to SCHED_OTHER
+  cancel                        // demote and end the run at the next cancellation_point()
+};
+
+/**
+ * Thrown by @ref cpu_budget::cancellation_point() after the budget of an
+ * overrun_action::cancel budget expired.
+ */
+struct budget_exceeded : std::runtime_error {
+  budget_exceeded() : std::runtime_error {"CPU budget exceeded"} { }
+};
+
+/**
+ * @brief Timer on the CPU time of the calling thread
+ *
+ * A SCHED_FIFO thread in a runaway loop starves everything below its
+ * priority, including whatever would notice. arm() creates a POSIX timer on
+ * the thread's CPU-time clock whose signal (SIGEV_THREAD_ID) is delivered to
+ * that very thread, so the handler runs while the runaway loop has the CPU.
+ * The kernel samples CPU-time clocks on the scheduler tick: an overrun is
+ * detected at most one tick (1 to 10ms, see CONFIG_HZ) after the budget is
+ * used up.
+ *
+ * The signal handler only does async-signal-safe things: it sets the flag
+ * and, for demote and cancel, calls sched_setscheduler(SCHED_OTHER).
+ *
+ * Example:
+ *
+ *     preempt::cpu_budget budget;
+ *     budget.arm(500, preempt::overrun_action::cancel);
+ *     try {
+ *       for (;;) {
+ *         step();
+ *         preempt::cpu_budget::cancellation_point();
+ *       }
+ *     } catch (preempt::budget_exceeded const&) { }
+ *     budget.disarm();
+ */
+class cpu_budget {
+public:
+  cpu_budget() noexcept { }
+  ~cpu_budget() { disarm(); }
+
+  cpu_budget(cpu_budget const&) = delete;
+  cpu_budget& operator = (cpu_budget const&) = delete;
+
+  /**
+   * Start a budget of us microseconds of CPU time for the calling thread.
+   * Must be disarmed on the same thread.
+   */
+  bool arm(long us, overrun_action);
+
+  /** Delete the timer. Keeps expired() until the next arm(). */
+  void disarm() noexcept;
+
+  /** True once the budget is used up. */
+  bool expired() const noexcept { return expired_.load(std::memory_order_relaxed); }
+
+  overrun_action action() const noexcept { return action_; }
+
+  explicit operator bool() const noexcept { return error_.empty(); }
+
+  std::string last_error() const { return error_; }
+
+  /**
+   * Throw @ref budget_exceeded if the budget armed on the calling thread
+   * with overrun_action::cancel has expired. Cheap enough for inner loops.
+   */
+  static void cancellation_point();
+
+  /** Signal used for the timers, SIGRTMIN + 1. */
+  static int signal() noexcept;
+
+private:
+  static void on_expiry(int, siginfo_t*, void*);
+
+  timer_t timer_ {};
+  bool armed_ = false;
+  overrun_action action_ = overrun_action::none;
+  std::atomic<bool> expired_ {false};
+  std::string error_;
+};
+} // preempt
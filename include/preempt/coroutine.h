@@ -0,0 +1,335 @@
+/* -*-coding:raw-text-unix-*-
+ *
+ * preempt/coroutine.h -- many periodic coroutines on one real-time thread
+ *
+ * Needs C++20 coroutines; with older standards the header is empty and
+ * PREEMPT_HAS_COROUTINES is not defined.
+ */
+#pragma once
+
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#if __has_include(<coroutine>)
+#define PREEMPT_HAS_COROUTINES 1
+#endif
+#endif
+
+#ifdef PREEMPT_HAS_COROUTINES
+
+#include <preempt/task.h>
+
+#include <atomic>
+#include <chrono>
+#include <coroutine>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace preempt {
+class coroutine_scheduler;
+
+/**
+ * @brief Fixed-size blocks for coroutine frames
+ *
+ * All blocks are allocated by the constructor. allocate() and deallocate()
+ * only pop and push a free list.
+ */
+class frame_pool {
+public:
+  frame_pool(std::size_t block_size, std::size_t blocks);
+
+  frame_pool(frame_pool const&) = delete;
+  frame_pool& operator = (frame_pool const&) = delete;
+
+  /** A block or nullptr if size exceeds the block size or all are in use. */
+  void* allocate(std::size_t size) noexcept;
+  void deallocate(void*) noexcept;
+
+  std::size_t block_size() const noexcept { return block_size_; }
+  std::size_t capacity() const noexcept { return blocks_; }
+  std::size_t in_use() const noexcept { return in_use_; }
+
+  /** Largest size ever asked for: the frame size of the biggest coroutine. */
+  std::size_t largest_request() const noexcept { return largest_; }
+
+private:
+  struct node {
+    node* next;
+  };
+
+  std::size_t block_size_;
+  std::size_t blocks_;
+  std::unique_ptr<unsigned char[]> memory_;
+  node* free_ = nullptr;
+  std::size_t in_use_ = 0;
+  std::size_t largest_ = 0;
+};
+
+/**
+ * @brief Coroutine run by a @ref coroutine_scheduler
+ *
+ * A co_task is a coroutine whose first parameter is the scheduler; its frame
+ * comes from the scheduler's @ref frame_pool. If the pool is exhausted the
+ * co_task is empty and @ref coroutine_scheduler::spawn() returns false.
+ *
+ *     preempt::co_task blink(preempt::coroutine_scheduler&, int led) {
+ *       for (;;) {
+ *         toggle(led);
+ *         co_await preempt::next_tick();
+ *       }
+ *     }
+ */
+class co_task {
+public:
+  struct promise_type;
+  using handle_type = std::coroutine_handle<promise_type>;
+
+  struct promise_type {
+    template <class... Args>
+    explicit promise_type(coroutine_scheduler& s, Args&...) noexcept : scheduler {&s} { }
+
+    template <class... Args>
+    static void* operator new(std::size_t, coroutine_scheduler&, Args&...) noexcept;
+    static void operator delete(void*) noexcept;
+
+    static co_task get_return_object_on_allocation_failure() noexcept { return co_task {}; }
+    co_task get_return_object() noexcept { return co_task {handle_type::from_promise(*this)}; }
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    std::suspend_always final_suspend() noexcept { return {}; }
+    void return_void() noexcept { }
+    void unhandled_exception() noexcept { std::terminate(); }
+
+    coroutine_scheduler* scheduler;
+    std::size_t slot = 0;       // in the scheduler's task table
+  };
+
+  co_task() noexcept { }
+  co_task(co_task&& other) noexcept : handle_ {std::exchange(other.handle_, nullptr)} { }
+  co_task& operator = (co_task&& other) noexcept;
+  ~co_task();
+
+  explicit operator bool() const noexcept { return bool(handle_); }
+
+private:
+  friend class coroutine_scheduler;
+  explicit co_task(handle_type h) noexcept : handle_ {h} { }
+
+  handle_type handle_;
+};
+
+/**
+ * @brief Runs co_tasks on one thread
+ *
+ * A coroutine switch is a function call and a return, and a coroutine needs
+ * only its frame (typically a few hundred bytes) instead of a thread and a
+ * stack. The scheduler runs its ready coroutines in FIFO order, then sleeps
+ * with clock_nanosleep(TIMER_ABSTIME) until the next tick or timer. The
+ * queues are allocated up front; nothing is allocated while it runs.
+ *
+ * Coroutines must not block: they give up the CPU with co_await @ref
+ * next_tick(), @ref sleep_until() or a @ref co_channel read. The scheduler
+ * and its channels are not thread-safe; spawn() tasks before start() or from
+ * inside a coroutine.
+ *
+ * Example:
+ *
+ *     preempt::coroutine_scheduler s {1000};     // 1ms tick
+ *     for (int led = 0; led < 200; ++led)
+ *       s.spawn(blink(s, led));
+ *     s.start(50);                               // one SCHED_FIFO thread
+ */
+class coroutine_scheduler : public mono_task<> {
+public:
+  using clock = std::chrono::steady_clock;
+  using handle_type = co_task::handle_type;
+
+  /**
+   * @param max_tasks: Capacity of the frame pool and the queues.
+   *
+   * @param frame_size: Largest coroutine frame in bytes.
+   */
+  explicit coroutine_scheduler(long tick_us, std::size_t max_tasks = 256,
+                               std::size_t frame_size = 512);
+
+  ~coroutine_scheduler();
+
+  /** Take over a task; false if it is empty or the table is full. */
+  bool spawn(co_task&&);
+
+  /** Run the scheduler on a @ref preempt::thread; priority 0 is SCHED_OTHER. */
+  void start(int priority = 1, base::stack_options const& = {});
+
+  /** Let run() return after the current pass and join the thread. */
+  void stop();
+
+  /** Run on the calling thread until all tasks are finished or stop(). */
+  void run();
+
+  /** Number of unfinished tasks. */
+  std::size_t tasks() const noexcept { return live_; }
+
+  /** Number of ticks so far. */
+  long ticks() const noexcept { return ticks_; }
+
+  frame_pool& pool() noexcept { return pool_; }
+
+  /** Queue a coroutine to be resumed in this pass. */
+  void ready(handle_type) noexcept;
+
+  /** Resume a coroutine at the next tick. */
+  void wait_tick(handle_type) noexcept;
+
+  /** Resume a coroutine at a point in time. */
+  void wait_until(handle_type, clock::time_point) noexcept;
+
+private:
+  struct timer {
+    clock::time_point when;
+    handle_type handle;
+  };
+
+  void resume(handle_type);
+
+  frame_pool pool_;
+  clock::duration tick_;
+  std::vector<handle_type> tasks_;          // by slot, null: free
+  std::vector<handle_type> ready_;          // ring
+  std::size_t ready_head_ = 0, ready_size_ = 0;
+  std::vector<handle_type> tick_waiters_;
+  std::vector<timer> timers_;               // heap, earliest first
+  std::size_t live_ = 0;
+  long ticks_ = 0;
+  std::atomic<bool> stopping_ {false};
+};
+
+/**
+ * co_await next_tick() resumes the coroutine at the scheduler's next tick.
+ */
+struct tick_awaiter {
+  bool await_ready() const noexcept { return false; }
+  void await_suspend(co_task::handle_type h) noexcept { h.promise().scheduler->wait_tick(h); }
+  void await_resume() const noexcept { }
+};
+
+inline tick_awaiter next_tick() noexcept { return {}; }
+
+/**
+ * co_await sleep_until(t) resumes the coroutine at t.
+ */
+struct sleep_awaiter {
+  coroutine_scheduler::clock::time_point when;
+
+  bool await_ready() const noexcept { return when <= coroutine_scheduler::clock::now(); }
+  void await_suspend(co_task::handle_type h) noexcept {
+    h.promise().scheduler->wait_until(h, when);
+  }
+  void await_resume() const noexcept { }
+};
+
+inline sleep_awaiter sleep_until(coroutine_scheduler::clock::time_point t) noexcept {
+  return {t};
+}
+
+template <class Rep, class Period>
+sleep_awaiter
+sleep_for(std::chrono::duration<Rep, Period> d) noexcept {
+  return {coroutine_scheduler::clock::now()
+          + std::chrono::duration_cast<coroutine_scheduler::clock::duration>(d)};
+}
+
+/**
+ * @brief Bounded queue between coroutines of one scheduler
+ *
+ * T value = co_await channel; suspends while the channel is empty. At most
+ * one coroutine may wait on a channel at a time.
+ */
+template <class T, std::size_t N>
+class co_channel {
+public:
+  /** Append a value and wake the reader; false if the channel is full. */
+  bool write(T value);
+
+  bool empty() const noexcept { return size_ == 0; }
+  std::size_t size() const noexcept { return size_; }
+
+  struct awaiter {
+    co_channel& channel;
+
+    bool await_ready() const noexcept { return !channel.empty(); }
+    void await_suspend(co_task::handle_type h) noexcept { channel.reader_ = h; }
+    T await_resume() { return channel.pop(); }
+  };
+
+  awaiter operator co_await() noexcept { return awaiter {*this}; }
+
+private:
+  T pop();
+
+  T items_[N] {};
+  std::size_t head_ = 0, size_ = 0;
+  co_task::handle_type reader_;
+};
+
+/***********************************************************************
+ * inlined implementation
+ */
+template <class... Args>
+void*
+co_task::promise_type::operator new(std::size_t size, coroutine_scheduler& s, Args&...) noexcept {
+  /* the pool is remembered in front of the frame for operator delete */
+  constexpr std::size_t header = alignof(std::max_align_t);
+  void* block = s.pool().allocate(header + size);
+  if (block == nullptr)
+    return nullptr;
+  *static_cast<frame_pool**>(block) = &s.pool();
+  return static_cast<unsigned char*>(block) + header;
+}
+
+inline
+void
+co_task::promise_type::operator delete(void* p) noexcept {
+  constexpr std::size_t header = alignof(std::max_align_t);
+  void* block = static_cast<unsigned char*>(p) - header;
+  (*static_cast<frame_pool**>(block))->deallocate(block);
+}
+
+inline
+co_task&
+co_task::operator = (co_task&& other) noexcept {
+  co_task old {std::move(other)};
+  std::swap(old.handle_, handle_);
+  return *this;
+}
+
+inline
+co_task::~co_task() {
+  if (handle_)
+    handle_.destroy();
+}
+
+template <class T, std::size_t N>
+bool
+co_channel<T, N>::write(T value) {
+  if (size_ == N)
+    return false;
+  items_[(head_ + size_) % N] = std::move(value);
+  ++size_;
+  if (reader_) {
+    auto const h = std::exchange(reader_, nullptr);
+    h.promise().scheduler->ready(h);
+  }
+  return true;
+}
+
+template <class T, std::size_t N>
+T
+co_channel<T, N>::pop() {
+  T value = std::move(items_[head_]);
+  head_ = (head_ + 1) % N;
+  --size_;
+  return value;
+}
+} // preempt
+
+#endif // PREEMPT_HAS_COROUTINES
@@ -0,0 +1,300 @@
+/* -*-coding:raw-text-unix-*-
+ *
+ * preempt/cyclic.h -- time-triggered cyclic executive with compile-time frame tables
+ */
+#pragma once
+
+#include <preempt/task.h>
+
+#include <base/chrono.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iosfwd>
+
+namespace preempt {
+/**
+ * @brief Periodic function of a @ref cyclic_executive
+ *
+ * @param PeriodUs: Period in microseconds, a multiple of the minor frame.
+ *        The deadline is the period.
+ *
+ * @param WcetUs: Worst-case execution time in microseconds.
+ *
+ * @param Function: Called once per period.
+ */
+template <long PeriodUs, long WcetUs, void (*Function)()>
+struct cyclic_task {
+  static_assert(PeriodUs > 0 && WcetUs > 0, "cyclic_task: period and WCET must be positive");
+  static_assert(WcetUs <= PeriodUs, "cyclic_task: WCET exceeds the period");
+
+  static constexpr long period_us = PeriodUs;
+  static constexpr long wcet_us = WcetUs;
+  static void run() { Function(); }
+};
+
+namespace details {
+constexpr long
+gcd(long a, long b) {
+  return b == 0 ? a : gcd(b, a % b);
+}
+
+constexpr long
+lcm(long a, long b) {
+  return a / gcd(a, b) * b;
+}
+
+constexpr long
+max_of(long const* values, std::size_t n) {
+  long m = 0;
+  for (std::size_t i = 0; i < n; ++i)
+    if (values[i] > m)
+      m = values[i];
+  return m;
+}
+
+/**
+ * Frames of the major cycle and what runs in them. Built at compile time by
+ * @ref make_frame_table(); ok is false if some task does not fit.
+ */
+template <std::size_t Tasks, std::size_t Frames>
+struct frame_table {
+  std::uint64_t tasks[Frames] {};   // bit i: task i runs in the frame
+  long load_us[Frames] {};
+  long offset[Tasks] {};            // first frame of each task
+  bool ok = true;
+};
+
+/**
+ * Place every task, shortest period first, at the offset into its period
+ * that keeps the fullest of its frames emptiest. A frame whose load would
+ * exceed the minor frame is an overrun and makes the table invalid.
+ */
+template <std::size_t Tasks, std::size_t Frames>
+constexpr frame_table<Tasks, Frames>
+make_frame_table(long minor_us, long const (&period)[Tasks], long const (&wcet)[Tasks]) {
+  frame_table<Tasks, Frames> t {};
+  bool placed[Tasks] {};
+  for (std::size_t n = 0; n < Tasks; ++n) {
+    std::size_t next = Tasks;
+    for (std::size_t i = 0; i < Tasks; ++i)
+      if (!placed[i] && (next == Tasks || period[i] < period[next]))
+        next = i;
+    placed[next] = true;
+    long const stride = period[next] / minor_us;
+    long best = -1, best_load = 0;
+    for (long offset = 0; offset < stride; ++offset) {
+      long fullest = 0;
+      for (long f = offset; f < long(Frames); f += stride)
+        if (t.load_us[f] > fullest)
+          fullest = t.load_us[f];
+      if (best < 0 || fullest < best_load) {
+        best = offset;
+        best_load = fullest;
+      }
+    }
+    if (best_load + wcet[next] > minor_us)
+      t.ok = false;
+    t.offset[next] = best;
+    for (long f = best; f < long(Frames); f += stride) {
+      t.tasks[f] |= std::uint64_t(1) << next;
+      t.load_us[f] += wcet[next];
+    }
+  }
+  return t;
+}
+
+template <std::size_t N>
+constexpr bool
+harmonic(long const (&period)[N]) {
+  for (std::size_t i = 0; i < N; ++i)
+    for (std::size_t j = 0; j < N; ++j)
+      if (period[i] <= period[j] && period[j] % period[i] != 0)
+        return false;
+  return true;
+}
+
+template <std::size_t N>
+constexpr bool
+multiples_of(long minor_us, long const (&period)[N]) {
+  for (std::size_t i = 0; i < N; ++i)
+    if (period[i] % minor_us != 0)
+      return false;
+  return true;
+}
+
+template <std::size_t N>
+constexpr long
+major_frame(long const (&period)[N]) {
+  long m = 1;
+  for (std::size_t i = 0; i < N; ++i)
+    m = lcm(m, period[i]);
+  return m;
+}
+
+void report_frames(std::ostream&, std::size_t frames, std::uint64_t const* tasks,
+                   long const* load_us, long minor_us, base::nsec_t const* min_slack_ns,
+                   long const* overruns);
+} // details
+
+/**
+ * @brief Time-triggered cyclic executive
+ *
+ * The major cycle, the least common multiple of the task periods, is split
+ * into minor frames of MinorUs. At compile time every task is assigned to the
+ * frames it runs in and the result is checked with static_assert: the
+ * periods must be harmonic multiples of the minor frame and no frame may be
+ * loaded beyond its length with the declared WCETs.
+ *
+ * At run time a SCHED_FIFO @ref preempt::thread walks the table: it runs the
+ * tasks of a frame, records the slack left to the frame's end and sleeps with
+ * clock_nanosleep(TIMER_ABSTIME) until the next frame. There is no
+ * allocation, no virtual call and no lock on the way. A frame that overruns
+ * is counted and the next one starts late; the schedule does not slip.
+ *
+ * Example:
+ *
+ *     void sample();
+ *     void control();
+ *     void log();
+ *     using executive = preempt::cyclic_executive<1000,
+ *       preempt::cyclic_task<1000, 200, &sample>,
+ *       preempt::cyclic_task<2000, 300, &control>,
+ *       preempt::cyclic_task<8000, 400, &log>>;
+ *     executive ce;
+ *     ce.start(80);
+ *
+ * @param MinorUs: Minor frame in microseconds.
+ *
+ * @param Tasks: Up to 64 @ref cyclic_task, numbered in the order given.
+ */
+template <long MinorUs, class... Tasks>
+class cyclic_executive : public mono_task<> {
+  static constexpr long periods_[] = {Tasks::period_us...};
+  static constexpr long wcets_[] = {Tasks::wcet_us...};
+
+public:
+  static constexpr std::size_t task_count = sizeof...(Tasks);
+  static constexpr long minor_us = MinorUs;
+  static constexpr long major_us = details::major_frame(periods_);
+  static constexpr std::size_t frames = major_us / MinorUs;
+
+  static_assert(task_count > 0 && task_count <= 64, "cyclic_executive: 1 to 64 tasks");
+  static_assert(MinorUs > 0, "cyclic_executive: minor frame must be positive");
+  static_assert(details::multiples_of(MinorUs, periods_),
+                "cyclic_executive: periods must be multiples of the minor frame");
+  static_assert(details::harmonic(periods_), "cyclic_executive: periods are not harmonic");
+  static_assert(details::max_of(wcets_, task_count) <= MinorUs,
+                "cyclic_executive: a task is longer than the minor frame");
+  static_assert(frames <= 4096, "cyclic_executive: major cycle has too many frames");
+
+  using table_type = details::frame_table<task_count, frames>;
+  static constexpr table_type table =
+    details::make_frame_table<task_count, frames>(MinorUs, periods_, wcets_);
+
+  static_assert(table.ok, "cyclic_executive: frame overrun, the tasks do not fit the frames");
+
+  ~cyclic_executive() { stop(); }
+
+  /**
+   * Start the executive thread.
+   *
+   * @param cycles: Number of major cycles to run, 0 until stop().
+   */
+  void start(int priority = 1, long cycles = 0, base::stack_options const& stack = {});
+
+  /** Let the executive end after the current frame and join it. */
+  void stop();
+
+  /** Smallest slack of a frame so far, negative for an overrun. Read after join(). */
+  base::nsec_t min_slack_ns(std::size_t frame) const { return min_slack_[frame]; }
+
+  /** Number of overruns of a frame. Read after join(). */
+  long overruns(std::size_t frame) const { return overruns_[frame]; }
+
+  /** Number of completed major cycles. */
+  long cycles() const noexcept { return cycles_.load(std::memory_order_relaxed); }
+
+  /**
+   * One line per frame with its tasks, planned load and measured slack:
+   *
+   *     frame    1: tasks 0 2          load   800/1000us  min slack    919us  overruns 0
+   */
+  void report(std::ostream& os) const;
+
+private:
+  void execute(long cycles);
+
+  std::atomic<bool> stopping_ {false};
+  std::atomic<long> cycles_ {0};
+  base::nsec_t min_slack_[frames];
+  long overruns_[frames];
+};
+
+/***********************************************************************
+ * inlined implementation
+ */
+template <long MinorUs, class... Tasks>
+constexpr long cyclic_executive<MinorUs, Tasks...>::periods_[];
+
+template <long MinorUs, class... Tasks>
+constexpr long cyclic_executive<MinorUs, Tasks...>::wcets_[];
+
+template <long MinorUs, class... Tasks>
+constexpr typename cyclic_executive<MinorUs, Tasks...>::table_type
+cyclic_executive<MinorUs, Tasks...>::table;
+
+template <long MinorUs, class... Tasks>
+void
+cyclic_executive<MinorUs, Tasks...>::start(int priority, long cycles,
+                                           base::stack_options const& stack) {
+  join();
+  stopping_ = false;
+  cycles_ = 0;
+  for (std::size_t f = 0; f < frames; ++f) {
+    min_slack_[f] = base::nsec_t(MinorUs) * 1000;
+    overruns_[f] = 0;
+  }
+  spawn(SCHED_FIFO, priority, stack, &cyclic_executive::execute, this, cycles);
+}
+
+template <long MinorUs, class... Tasks>
+void
+cyclic_executive<MinorUs, Tasks...>::stop() {
+  stopping_ = true;
+  join();
+}
+
+template <long MinorUs, class... Tasks>
+void
+cyclic_executive<MinorUs, Tasks...>::report(std::ostream& os) const {
+  details::report_frames(os, frames, table.tasks, table.load_us, MinorUs, min_slack_,
+                         overruns_);
+}
+
+template <long MinorUs, class... Tasks>
+void
+cyclic_executive<MinorUs, Tasks...>::execute(long cycles) {
+  static void (* const functions[])() = {&Tasks::run...};
+  base::nsec_t const minor_ns = base::nsec_t(MinorUs) * 1000;
+  base::nsec_t next = base::monotonic_now();
+  for (long cycle = 0; cycles == 0 || cycle < cycles; ++cycle) {
+    for (std::size_t f = 0; f < frames; ++f) {
+      if (stopping_.load(std::memory_order_relaxed))
+        return;
+      for (std::uint64_t bits = table.tasks[f]; bits != 0; bits &= bits - 1)
+        functions[__builtin_ctzll(bits)]();
+      next += minor_ns;
+      base::nsec_t const slack = next - base::monotonic_now();
+      if (slack < min_slack_[f])
+        min_slack_[f] = slack;
+      if (slack < 0)
+        ++overruns_[f];
+      else
+        base::sleep_until(next);
+    }
+    cycles_.fetch_add(1, std::memory_order_relaxed);
+  }
+}
+} // preempt
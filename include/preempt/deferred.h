@@ -0,0 +1,187 @@
+/* -*-coding:raw-text-unix-*-
+ *
+ * preempt/deferred.h -- hand blocking work from real-time threads to workers
+ */
+#pragma once
+
+#include <preempt/task.h>
+
+#include <base/details/cc.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace preempt {
+/**
+ * Counters of a @ref deferred_executor.
+ */
+struct deferred_stats {
+  std::size_t depth = 0;        // queued now
+  std::size_t max_depth = 0;
+  long posted = 0;
+  long executed = 0;
+  long dropped = 0;             // queue was full
+  long max_post_ns = 0;         // worst-case duration of post()
+};
+
+namespace details {
+/**
+ * Queue cell with a closure of up to 48 bytes in place.
+ */
+struct alignas(CACHELINE_SIZE) deferred_cell {
+  static constexpr std::size_t capacity = 48;
+
+  std::atomic<std::size_t> sequence;
+  void (*call)(void*) = nullptr;          // runs and destroys the closure
+  alignas(std::max_align_t) unsigned char storage[capacity] {};
+};
+
+template <class F>
+void
+run_deferred(void* p) noexcept {
+  F& f = *static_cast<F*>(p);
+  f();
+  f.~F();
+}
+} // details
+
+/**
+ * @brief Executor for work a real-time thread must not do itself
+ *
+ * Writing a file, logging, or freeing a big buffer may block in the kernel
+ * or in the allocator. A real-time thread post()s such work as a closure
+ * instead, and SCHED_OTHER workers run it. post() never blocks and never
+ * allocates: the closure is constructed in a cell of a preallocated bounded
+ * queue (Vyukov's multi-producer multi-consumer ring), so it must fit in
+ * details::deferred_cell::capacity bytes. If the queue is full the closure is
+ * dropped and counted. A sleeping worker is woken with one FUTEX_WAKE.
+ *
+ * Example:
+ *
+ *     preempt::deferred_executor deferred {1024};
+ *     ...
+ *     // real-time thread
+ *     deferred.post([value] { std::clog << "value " << value << '\n'; });
+ *     deferred.release(std::move(buffer));   // freed by the worker
+ */
+class deferred_executor : public poly_task<> {
+public:
+  /**
+   * @param capacity: Queue length, rounded up to a power of 2.
+   *
+   * @param workers: Number of SCHED_OTHER worker threads. With 0 the owner
+   *        calls @ref run_pending() itself.
+   */
+  explicit deferred_executor(std::size_t capacity = 1024, int workers = 1);
+
+  /** Join the workers, then run what is still queued. */
+  ~deferred_executor();
+
+  deferred_executor(deferred_executor const&) = delete;
+  deferred_executor& operator = (deferred_executor const&) = delete;
+
+  /**
+   * Queue a closure in bounded time. It must not throw.
+   *
+   * @return False if the queue was full and the closure dropped.
+   */
+  template <class F>
+  bool post(F&& f) noexcept;
+
+  /**
+   * Delete an object on a worker.
+   *
+   * @return False if the queue was full; p still owns the object then.
+   */
+  template <class T, class D>
+  bool release(std::unique_ptr<T, D>&& p) noexcept;
+
+  /** Run the queued closures on the calling thread. @return Number run. */
+  std::size_t run_pending();
+
+  /** Wait until everything posted so far has run. */
+  void drain();
+
+  deferred_stats stats() const noexcept;
+
+private:
+  bool pop_and_run();
+  void work();
+  void posted(std::size_t position, std::chrono::steady_clock::time_point start) noexcept;
+  void dropped() noexcept;
+
+  std::size_t mask_;
+  details::deferred_cell* cells_ = nullptr;   // cache line aligned
+  alignas(CACHELINE_SIZE) std::atomic<std::size_t> enqueue_ {0};
+  alignas(CACHELINE_SIZE) std::atomic<std::size_t> dequeue_ {0};
+  alignas(CACHELINE_SIZE) std::atomic<std::uint32_t> futex_ {0};
+  std::atomic<int> sleepers_ {0};
+  std::atomic<bool> stopping_ {false};
+  alignas(CACHELINE_SIZE) std::atomic<long> posted_ {0};
+  std::atomic<long> executed_ {0};
+  std::atomic<long> dropped_ {0};
+  std::atomic<std::size_t> max_depth_ {0};
+  std::atomic<long> max_post_ns_ {0};
+};
+
+/***********************************************************************
+ * inlined implementation
+ */
+template <class F>
+bool
+deferred_executor::post(F&& f) noexcept {
+  using closure = typename std::decay<F>::type;
+  static_assert(sizeof(closure) <= details::deferred_cell::capacity,
+                "deferred_executor::post(): closure too big, capture less or a pointer");
+  static_assert(alignof(closure) <= alignof(std::max_align_t),
+                "deferred_executor::post(): closure over-aligned");
+  static_assert(std::is_nothrow_constructible<closure, F&&>::value,
+                "deferred_executor::post(): closure construction may throw");
+  auto const start = std::chrono::steady_clock::now();
+  std::size_t position = enqueue_.load(std::memory_order_relaxed);
+  details::deferred_cell* cell;
+  for (;;) {
+    cell = &cells_[position & mask_];
+    std::size_t const sequence = cell->sequence.load(std::memory_order_acquire);
+    auto const diff = static_cast<std::ptrdiff_t>(sequence - position);
+    if (diff == 0) {
+      if (enqueue_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+        break;
+    } else if (diff < 0) {
+      dropped();
+      return false;
+    } else {
+      position = enqueue_.load(std::memory_order_relaxed);
+    }
+  }
+  new (cell->storage) closure(std::forward<F>(f));
+  cell->call = &details::run_deferred<closure>;
+  cell->sequence.store(position + 1, std::memory_order_release);
+  posted(position, start);
+  return true;
+}
+
+template <class T, class D>
+bool
+deferred_executor::release(std::unique_ptr<T, D>&& p) noexcept {
+  static_assert(std::is_nothrow_copy_constructible<D>::value,
+                "deferred_executor::release(): deleter copy may throw");
+  struct deleter {
+    T* pointer;
+    D d;
+    void operator () () { d(pointer); }
+  };
+  if (!p)
+    return true;
+  if (!post(deleter {p.get(), p.get_deleter()}))
+    return false;
+  p.release();
+  return true;
+}
+} // preempt
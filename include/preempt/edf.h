@@ -0,0 +1,124 @@
+/* -*-coding:raw-text-unix-*-
+ *
+ * preempt/edf.h -- earliest deadline first in user space
+ */
+#pragma once
+
+#include <preempt/task.h>
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace preempt {
+/**
+ * Counters of one @ref edf_dispatcher worker.
+ */
+struct edf_stats {
+  long jobs = 0;                // finished
+  long late = 0;                // finished after their deadline
+  long max_lateness_ns = 0;     // finish - deadline of the latest job, <= 0: none late
+  long preemptions = 0;         // jobs run from yield()
+};
+
+/**
+ * @brief Earliest-deadline-first dispatcher on pinned worker threads
+ *
+ * For systems without SCHED_DEADLINE. Every worker is a @ref preempt::thread
+ * with a fixed SCHED_FIFO priority on its own CPU and a queue of jobs ordered
+ * by absolute deadline (a binary heap, O(log n) submit and dispatch). The
+ * kernel never preempts one job for another: a worker switches jobs when one
+ * returns or at a cooperative @ref yield() inside a job, which runs the
+ * waiting jobs with earlier deadlines first.
+ *
+ * Lateness is measured when a job returns, see @ref stats(). Jobs must not
+ * throw.
+ *
+ * Example:
+ *
+ *     preempt::edf_dispatcher edf {{2, 3}, 50};
+ *     edf.submit(std::chrono::microseconds {500}, [] { control(); });
+ *     ...
+ *     edf.join();               // runs the queued jobs, then ends the workers
+ */
+class edf_dispatcher : public poly_task<> {
+public:
+  using clock = std::chrono::steady_clock;
+  using job = std::function<void()>;
+
+  /**
+   * Start one worker per CPU of cpus; -1 is a worker that is not pinned.
+   *
+   * @param priority: SCHED_FIFO priority of the workers, 0 for SCHED_OTHER.
+   *
+   * @param capacity: jobs per queue to reserve memory for.
+   */
+  explicit edf_dispatcher(std::vector<int> const& cpus, int priority = 1,
+                          base::stack_options const& stack = {}, std::size_t capacity = 256);
+
+  ~edf_dispatcher();
+
+  /** Number of workers. */
+  std::size_t size() const noexcept { return workers_.size(); }
+
+  /** Queue a job on a worker. */
+  void submit(std::size_t worker, clock::time_point deadline, job);
+
+  /** Queue a job on the worker with the fewest queued jobs. */
+  void submit(clock::time_point deadline, job);
+
+  /** Queue a job due relative to now. */
+  void submit(std::chrono::nanoseconds relative, job);
+
+  /**
+   * Preemption point for the running job: run the queued jobs of this worker
+   * whose deadlines are earlier than the running job's before returning.
+   * Does nothing outside of a worker.
+   *
+   * @return Number of jobs run.
+   */
+  static int yield();
+
+  /** Deadline of the job the calling worker runs, clock::time_point::max() elsewhere. */
+  static clock::time_point current_deadline() noexcept;
+
+  /** Wait until all queues are empty and no job runs. */
+  void wait_idle();
+
+  /** Counters of a worker. */
+  edf_stats stats(std::size_t worker) const;
+
+  /** Let the workers finish the queued jobs, then join them. */
+  void join() override;
+
+private:
+  struct entry {
+    clock::time_point deadline;
+    std::uint64_t sequence;     // first come first served for equal deadlines
+    job call;
+  };
+
+  struct worker {
+    mutable std::mutex mutex;
+    std::condition_variable wakeup;
+    std::vector<entry> heap;
+    std::uint64_t sequence = 0;
+    std::atomic<std::size_t> queued {0};
+    int busy = 0;               // nesting of running jobs
+    bool stopping = false;
+    int cpu = -1;
+    edf_stats stats;
+  };
+
+  void work(std::size_t index);
+  static void run_next(worker&, std::unique_lock<std::mutex>&, bool preempting);
+
+  std::vector<std::unique_ptr<worker>> workers_;
+};
+} // preempt
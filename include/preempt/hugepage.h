@@ -0,0 +1,204 @@
+/* -*-coding:raw-text-unix-*-
+ *
+ * preempt/hugepage.h -- memory on huge pages for real-time working sets
+ */
+#pragma once
+
+#include <base/posix.h>
+#include <base/threading.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <string>
+#include <utility>
+
+namespace preempt {
+/**
+ * @brief Memory region backed by huge pages
+ *
+ * A task that sweeps a table of a few MiB touches a new 4KiB page every few
+ * accesses and spends its time in TLB misses. On 2MiB pages the same table
+ * needs a handful of TLB entries.
+ *
+ * The region is mapped with MAP_HUGETLB from the pool of /proc/sys/vm/
+ * nr_hugepages (see @ref reserve_huge_pages()). If the pool is empty it falls
+ * back to transparent huge pages (madvise(MADV_HUGEPAGE) on a 2MiB aligned
+ * mapping) and, where the kernel has no huge page at hand, to normal pages.
+ * All pages are populated before the constructor returns and locked unless
+ * told otherwise, so the real-time side never takes a page fault.
+ *
+ * Example:
+ *
+ *     preempt::huge_region table {64 << 20};
+ *     if (!table)
+ *       std::cerr << table.last_error() << std::endl;
+ *     std::cerr << table.huge_pages() << " huge pages" << std::endl;
+ */
+class huge_region {
+public:
+  enum class backing { none, hugetlb, transparent, normal };
+
+  huge_region() noexcept { }
+
+  /**
+   * Map size bytes, rounded up to the huge page size.
+   *
+   * @param lock: mlock() the pages, else they are only populated.
+   *
+   * @param node: NUMA node for the pages (see @ref bind_memory()), -1 for
+   *        the default policy.
+   */
+  explicit huge_region(std::size_t size, bool lock = true, int node = -1);
+
+  ~huge_region();
+
+  huge_region(huge_region&&) noexcept;
+  huge_region& operator = (huge_region&&) noexcept;
+
+  /** True if the region is mapped, false otherwise (see last_error()). */
+  explicit operator bool() const noexcept { return data_ != nullptr; }
+
+  std::string last_error() const { return error_; }
+
+  void* data() const noexcept { return data_; }
+  std::size_t size() const noexcept { return size_; }
+  backing kind() const noexcept { return kind_; }
+  bool locked() const noexcept { return locked_; }
+
+  /**
+   * Number of huge pages actually obtained. For transparent huge pages this
+   * reads AnonHugePages of the mapping from /proc/self/smaps.
+   */
+  std::size_t huge_pages() const;
+
+  /**
+   * Stack options for a thread that runs on this region. The region must
+   * outlive the thread.
+   */
+  base::stack_options stack() const noexcept;
+
+private:
+  void* data_ = nullptr;
+  std::size_t size_ = 0;
+  backing kind_ = backing::none;
+  bool locked_ = false;
+  std::string error_;
+};
+
+/**
+ * @brief Bump allocator on a @ref huge_region
+ *
+ * Allocation is a pointer increment, there is no free() of single blocks:
+ * @ref reset() releases all of them at once. Meant for the working set of one
+ * task that is set up before the real-time loop starts. Not thread-safe.
+ */
+class huge_arena {
+public:
+  explicit huge_arena(std::size_t size, bool lock = true, int node = -1);
+
+  explicit operator bool() const noexcept { return bool(region_); }
+
+  std::string last_error() const { return region_.last_error(); }
+
+  /** Aligned block of bytes or nullptr if the arena is exhausted. */
+  void* allocate(std::size_t bytes, std::size_t align = alignof(std::max_align_t)) noexcept;
+
+  /** Construct a T in the arena or return nullptr if it is exhausted. */
+  template <typename T, typename... Args>
+  T* create(Args&&... args);
+
+  /** Forget all allocations. Does not call destructors. */
+  void reset() noexcept { used_ = 0; }
+
+  std::size_t used() const noexcept { return used_; }
+  std::size_t capacity() const noexcept { return region_.size(); }
+  huge_region const& region() const noexcept { return region_; }
+
+private:
+  huge_region region_;
+  std::size_t used_ = 0;
+};
+
+/**
+ * Standard allocator on a @ref huge_arena, e.g. for a std::vector that is
+ * sized once. deallocate() does nothing; allocate() throws std::bad_alloc
+ * when the arena is exhausted.
+ */
+template <typename T>
+class arena_allocator {
+public:
+  using value_type = T;
+
+  explicit arena_allocator(huge_arena& arena) noexcept : arena_ {&arena} { }
+
+  template <typename U>
+  arena_allocator(arena_allocator<U> const& other) noexcept : arena_ {other.arena()} { }
+
+  T* allocate(std::size_t n);
+  void deallocate(T*, std::size_t) noexcept { }
+
+  huge_arena* arena() const noexcept { return arena_; }
+
+private:
+  huge_arena* arena_;
+};
+
+template <typename T, typename U>
+bool
+operator == (arena_allocator<T> const& a, arena_allocator<U> const& b) {
+  return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+bool
+operator != (arena_allocator<T> const& a, arena_allocator<U> const& b) {
+  return a.arena() != b.arena();
+}
+
+/** Huge page size of the system (Hugepagesize in /proc/meminfo). */
+std::size_t
+huge_page_size();
+
+/** Number of free pages in the MAP_HUGETLB pool (HugePages_Free). */
+long
+free_huge_pages();
+
+/**
+ * Grow the MAP_HUGETLB pool to at least count pages by writing
+ * /proc/sys/vm/nr_hugepages. Needs root. The kernel may find fewer free
+ * contiguous blocks than requested: check @ref free_huge_pages().
+ */
+bool
+reserve_huge_pages(long count);
+
+/***********************************************************************
+ * inlined implementation
+ */
+inline
+void*
+huge_arena::allocate(std::size_t bytes, std::size_t align) noexcept {
+  std::uintptr_t const base = reinterpret_cast<std::uintptr_t>(region_.data());
+  std::uintptr_t const first = (base + used_ + align - 1) & ~std::uintptr_t(align - 1);
+  if (region_.data() == nullptr || first + bytes > base + region_.size())
+    return nullptr;
+  used_ = first + bytes - base;
+  return reinterpret_cast<void*>(first);
+}
+
+template <typename T, typename... Args>
+T*
+huge_arena::create(Args&&... args) {
+  if (void* p = allocate(sizeof(T), alignof(T)))
+    return new (p) T(std::forward<Args>(args)...);
+  return nullptr;
+}
+
+template <typename T>
+T*
+arena_allocator<T>::allocate(std::size_t n) {
+  if (void* p = arena_->allocate(n * sizeof(T), alignof(T)))
+    return static_cast<T*>(p);
+  throw std::bad_alloc {};
+}
+} // preempt
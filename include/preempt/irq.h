@@ -0,0 +1,104 @@
+/* -*-coding:raw-text-unix-*-
+ *
+ * preempt/irq.h -- steer device interrupts away from real-time CPUs
+ */
+#pragma once
+
+#include <base/posix.h>
+
+#include <string>
+#include <vector>
+
+namespace preempt {
+/**
+ * @brief Move device interrupts off a set of real-time CPUs
+ *
+ * Interrupt handlers that run on an isolated CPU delay every real-time thread
+ * pinned to that CPU. This class rewrites /proc/irq/N/smp_affinity_list so
+ * that no movable IRQ targets one of the given CPUs anymore, remembers the
+ * previous affinities and can write them back.
+ *
+ * Some interrupts cannot be moved (per-CPU timers, IPIs, managed IRQs of
+ * multi-queue devices). The kernel refuses the write with EIO in this case;
+ * such IRQs are reported by @ref failures() and otherwise left alone.
+ *
+ * Example:
+ *
+ *     preempt::irq_steering irqs;                  // operates on /proc
+ *     if (!irqs.steer_away({2, 3})) {
+ *       for (auto const& f : irqs.failures())
+ *         std::cerr << "IRQ " << f.irq << ": " << std::strerror(f.errnum) << '\n';
+ *     }
+ *      .
+ *      .
+ *     irqs.restore();
+ *
+ * Writing the affinities requires root privileges (CAP_SYS_ADMIN). The procfs
+ * root can be replaced by a directory with the same layout for testing.
+ */
+class irq_steering {
+public:
+  /** Previous smp_affinity_list of a moved IRQ. */
+  struct affinity {
+    int irq;
+    std::string cpus;
+  };
+
+  /** IRQ that could not be read or moved, errnum is the errno value. */
+  struct failure {
+    int irq;
+    int errnum;
+  };
+
+  /** The housekeeping CPUs default to all CPUs of this machine. */
+  explicit irq_steering(std::string procfs_root = "/proc");
+
+  /** Numbers of all IRQs that have a smp_affinity_list, in ascending order. */
+  std::vector<int> irqs() const;
+
+  /** Read the current affinity of an IRQ. */
+  bool get_affinity(int irq, std::vector<int>& cpus) const;
+
+  /** Write the affinity of an IRQ. */
+  bool set_affinity(int irq, std::vector<int> const& cpus) const;
+
+  /**
+   * Define the CPUs that receive an IRQ whose affinity is entirely inside the
+   * real-time set.
+   */
+  void set_housekeeping_cpus(std::vector<int> cpus);
+
+  /**
+   * Remove the CPUs in rt_cpus from the affinity of every IRQ. IRQs that
+   * target only real-time CPUs are moved to the housekeeping CPUs.
+   *
+   * May be called more than once; the affinity saved first for an IRQ is kept
+   * so that @ref restore() always returns to the original state.
+   *
+   * @return True if every IRQ was moved or did not need to be moved, false if
+   *         at least one IRQ failed (see @ref failures()).
+   */
+  bool steer_away(std::vector<int> const& rt_cpus);
+
+  /**
+   * Write back the affinities saved by @ref steer_away().
+   *
+   * @return True if all affinities were restored.
+   */
+  bool restore();
+
+  /** IRQs that failed during the last call to steer_away() or restore(). */
+  std::vector<failure> const& failures() const;
+
+  /** Original affinities of the IRQs moved so far. */
+  std::vector<affinity> const& saved() const;
+
+private:
+  std::string path(int irq) const;
+
+  std::string root_;
+  std::vector<int> housekeeping_;
+  std::vector<affinity> saved_;
+  std::vector<failure> failures_;
+};
+} // preempt
@@ -0,0 +1,295 @@
+/* -*-coding:raw-text-unix-*-
+ *
+ * preempt/mpsc_queue.h -- many real-time producers, one consumer
+ */
+#pragma once
+
+#include <base/details/cc.h>    // CACHELINE_SIZE
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace preempt {
+/**
+ * Link of a node in an @ref intrusive_mpsc queue.
+ */
+struct mpsc_hook {
+  std::atomic<mpsc_hook*> next {nullptr};
+};
+
+/**
+ * @brief Vyukov's intrusive multi-producer/single-consumer queue
+ *
+ * Nodes derive from @ref mpsc_hook and are linked in place, nothing is
+ * allocated. push() is wait-free: one atomic exchange and two stores, no
+ * loop, from any number of threads. pop() is called by one consumer only and
+ * returns nodes in push order.
+ *
+ * A producer preempted between its exchange and its last store hides the
+ * nodes pushed after its own until it runs again: pop() then returns nullptr
+ * although the queue is not empty. The consumer just tries again later.
+ */
+class intrusive_mpsc {
+public:
+  intrusive_mpsc() noexcept : head_ {&stub_}, tail_ {&stub_} { }
+
+  intrusive_mpsc(intrusive_mpsc const&) = delete;
+  intrusive_mpsc& operator = (intrusive_mpsc const&) = delete;
+
+  /** Producers: append a node that is not in a queue. */
+  void push(mpsc_hook&) noexcept;
+
+  /** Consumer: take the oldest node, nullptr if there is none (yet). */
+  mpsc_hook* pop() noexcept;
+
+  /** Consumer: true if nothing is queued, or only behind a push in progress. */
+  bool empty() const noexcept;
+
+private:
+  alignas(CACHELINE_SIZE) std::atomic<mpsc_hook*> head_;        // producers
+  alignas(CACHELINE_SIZE) mpsc_hook* tail_;                     // consumer
+  mpsc_hook stub_;
+};
+
+/**
+ * @brief Bounded queue of values from many real-time threads to one consumer
+ *
+ * An @ref intrusive_mpsc queue whose nodes come from per-producer pools
+ * allocated by the constructor. A producer takes nodes from its own free list
+ * and, once that is empty, takes back all nodes the consumer has returned
+ * with one exchange. push() therefore finishes in a bounded number of steps,
+ * never allocates and never waits for another thread, so a @ref
+ * critical_task may call it from run(). If a producer's pool is exhausted,
+ * the value is dropped and counted.
+ *
+ * Each producer thread uses its own index. Pools and their nodes are
+ * allocated per producer on separate cache lines, but push() writes the link
+ * of the node queued before, which may belong to another producer, and all
+ * producers exchange the queue's head.
+ *
+ * Example:
+ *
+ *     preempt::mpsc_queue<event> events {4, 256};  // 4 producers
+ *
+ *     // real-time thread i
+ *     events.push(i, event {...});
+ *
+ *     // aggregator
+ *     events.consume([](event& e) { aggregate(e); });
+ */
+template <typename T>
+class mpsc_queue {
+public:
+  using value_type = T;
+
+  /**
+   * @param producers: Number of producer indexes, 0 to producers - 1.
+   *
+   * @param nodes: Pool size of each producer, the most values it can have
+   *        queued.
+   */
+  mpsc_queue(int producers, std::size_t nodes);
+
+  /** Destroy the values still queued. */
+  ~mpsc_queue();
+
+  mpsc_queue(mpsc_queue const&) = delete;
+  mpsc_queue& operator = (mpsc_queue const&) = delete;
+
+  /**
+   * Producer: construct a value in a node of producer's pool and queue it.
+   *
+   * @return False if the pool was exhausted and the value dropped.
+   */
+  template <typename... Args>
+  bool push(int producer, Args&&... args) noexcept;
+
+  /** Consumer: move the oldest value to out. @return False if none. */
+  bool try_pop(T& out);
+
+  /**
+   * Consumer: call f(T&) for up to max values in push order. Nodes are
+   * given back to their producers in chains, one exchange per run of nodes
+   * of the same producer.
+   *
+   * @return Number of values consumed.
+   */
+  template <typename F>
+  std::size_t consume(F&& f, std::size_t max = SIZE_MAX);
+
+  /** Consumer: true if no value can be taken now. */
+  bool empty() const noexcept { return queue_.empty(); }
+
+  int producers() const noexcept { return producers_; }
+
+  /** Values of a producer dropped because its pool was exhausted. */
+  long dropped(int producer) const noexcept;
+
+private:
+  struct node : mpsc_hook {
+    node* free_next = nullptr;
+    int owner = 0;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+
+    T& value() noexcept { return *reinterpret_cast<T*>(&storage); }
+  };
+
+  struct alignas(CACHELINE_SIZE) pool {
+    node* nodes = nullptr;                              // cache line aligned
+    node* free = nullptr;                               // producer only
+    std::atomic<long> dropped {0};
+    alignas(CACHELINE_SIZE) std::atomic<node*> returned {nullptr};
+  };
+
+  node* pop_node() noexcept;
+  void give_back(node* first, node* last) noexcept;
+
+  intrusive_mpsc queue_;
+  int producers_;
+  pool* pools_ = nullptr;       // cache line aligned
+};
+
+/***********************************************************************
+ * inlined implementation
+ */
+inline void
+intrusive_mpsc::push(mpsc_hook& n) noexcept {
+  n.next.store(nullptr, std::memory_order_relaxed);
+  mpsc_hook* const prev = head_.exchange(&n, std::memory_order_acq_rel);
+  prev->next.store(&n, std::memory_order_release);
+}
+
+inline bool
+intrusive_mpsc::empty() const noexcept {
+  return tail_ == &stub_ && stub_.next.load(std::memory_order_acquire) == nullptr;
+}
+
+template <typename T>
+mpsc_queue<T>::mpsc_queue(int producers, std::size_t nodes) : producers_ {producers} {
+  void* memory = nullptr;
+  if (::posix_memalign(&memory, alignof(pool), producers * sizeof(pool)))
+    throw std::bad_alloc {};
+  pools_ = static_cast<pool*>(memory);
+  for (int i = 0; i < producers; ++i)
+    new (&pools_[i]) pool;
+  /* each pool's nodes on cache lines of their own */
+  std::size_t const align = alignof(node) > CACHELINE_SIZE ? alignof(node) : CACHELINE_SIZE;
+  std::size_t const bytes = (nodes * sizeof(node) + align - 1) / align * align;
+  for (int i = 0; i < producers; ++i) {
+    pool& p = pools_[i];
+    if (::posix_memalign(&memory, align, bytes ? bytes : align)) {
+      for (int k = 0; k < producers; ++k)
+        std::free(pools_[k].nodes);
+      std::free(pools_);
+      throw std::bad_alloc {};
+    }
+    p.nodes = static_cast<node*>(memory);
+    for (std::size_t j = 0; j < nodes; ++j) {
+      node* n = new (&p.nodes[j]) node;
+      n->owner = i;
+      n->free_next = p.free;
+      p.free = n;
+    }
+  }
+}
+
+template <typename T>
+mpsc_queue<T>::~mpsc_queue() {
+  while (node* n = pop_node())
+    n->value().~T();
+  for (int i = 0; i < producers_; ++i) {
+    std::free(pools_[i].nodes);         // nodes are trivially destructible
+    pools_[i].~pool();
+  }
+  std::free(pools_);
+}
+
+template <typename T>
+template <typename... Args>
+bool
+mpsc_queue<T>::push(int producer, Args&&... args) noexcept {
+  static_assert(std::is_nothrow_constructible<T, Args&&...>::value,
+                "mpsc_queue::push(): construction may throw");
+  pool& p = pools_[producer];
+  node* n = p.free;
+  if (!n) {
+    n = p.returned.exchange(nullptr, std::memory_order_acquire);
+    if (!n) {
+      p.dropped.fetch_add(1, std::memory_order_relaxed);
+      return false;
+    }
+  }
+  p.free = n->free_next;
+  new (&n->storage) T(std::forward<Args>(args)...);
+  queue_.push(*n);
+  return true;
+}
+
+template <typename T>
+bool
+mpsc_queue<T>::try_pop(T& out) {
+  node* const n = pop_node();
+  if (!n)
+    return false;
+  out = std::move(n->value());
+  n->value().~T();
+  give_back(n, n);
+  return true;
+}
+
+template <typename T>
+template <typename F>
+std::size_t
+mpsc_queue<T>::consume(F&& f, std::size_t max) {
+  std::size_t count = 0;
+  node* first = nullptr;
+  node* last = nullptr;
+  for (; count < max; ++count) {
+    node* const n = pop_node();
+    if (!n)
+      break;
+    f(n->value());
+    n->value().~T();
+    if (first && first->owner != n->owner) {
+      give_back(first, last);
+      first = nullptr;
+    }
+    n->free_next = first;
+    if (!first)
+      last = n;
+    first = n;
+  }
+  if (first)
+    give_back(first, last);
+  return count;
+}
+
+template <typename T>
+long
+mpsc_queue<T>::dropped(int producer) const noexcept {
+  return pools_[producer].dropped.load(std::memory_order_relaxed);
+}
+
+template <typename T>
+typename mpsc_queue<T>::node*
+mpsc_queue<T>::pop_node() noexcept {
+  return static_cast<node*>(queue_.pop());
+}
+
+template <typename T>
+void
+mpsc_queue<T>::give_back(node* first, node* last) noexcept {
+  /* only the owner takes the list away, so this retries at most once per refill */
+  std::atomic<node*>& returned = pools_[first->owner].returned;
+  node* head = returned.load(std::memory_order_relaxed);
+  do
+    last->free_next = head;
+  while (!returned.compare_exchange_weak(head, first, std::memory_order_release,
+                                         std::memory_order_relaxed));
+}
+} // preempt
@@ -0,0 +1,96 @@
+/* -*-coding:raw-text-unix-*-
+ *
+ * preempt/numa.h -- keep the memory of a real-time task on the node of its CPU
+ */
+#pragma once
+
+#include <base/posix.h>
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace preempt {
+/**
+ * @brief NUMA nodes and their CPUs
+ *
+ * Read from /sys/devices/system/node. A machine without that directory (no
+ * CONFIG_NUMA) has a single node 0 with all CPUs. The sysfs root can be
+ * replaced by a directory with the same layout for testing.
+ *
+ * Example:
+ *
+ *     preempt::numa_topology numa;
+ *     int const node = numa.node_of_cpu(3);
+ */
+class numa_topology {
+public:
+  explicit numa_topology(std::string sysfs_root = "/sys");
+
+  /** Online nodes in ascending order. */
+  std::vector<int> const& nodes() const noexcept { return nodes_; }
+
+  /** True if there is nothing to place: all memory is local. */
+  bool single_node() const noexcept { return nodes_.size() < 2; }
+
+  /** Node of a CPU, -1 if the CPU is unknown. */
+  int node_of_cpu(int cpu) const;
+
+  /** CPUs of a node, empty if the node is unknown. */
+  std::vector<int> cpus_of_node(int node) const;
+
+private:
+  std::vector<int> nodes_;
+  std::vector<std::vector<int>> cpus_;      // by node number
+};
+
+/** Topology of this machine, read once. */
+numa_topology const& system_numa_topology();
+
+/** Node of the CPU the calling thread runs on. */
+int current_numa_node();
+
+/**
+ * Bind [addr, addr + size), extended to whole pages, to a node with
+ * mbind(MPOL_BIND). Pages that are already resident elsewhere are moved.
+ * Does nothing on a single-node machine.
+ */
+bool bind_memory(void const* addr, std::size_t size, int node);
+
+/**
+ * Allocate future pages of the calling thread on a node first
+ * (set_mempolicy(MPOL_PREFERRED)); -1 restores the default policy. Does nothing
+ * on a single-node machine.
+ */
+bool prefer_memory_node(int node);
+
+/**
+ * Pin the calling thread to a CPU, prefer the memory of its node and move the
+ * thread's stack there. Call it first thing in the thread function of a task:
+ * the stack was allocated by the thread that created it, possibly on the
+ * other socket.
+ */
+bool run_on_cpu(int cpu);
+
+/**
+ * Number of resident pages of [addr, addr + size) that are not on the given
+ * node, asked with move_pages(). 0 on a single-node machine, -1 on error.
+ */
+long remote_pages(void const* addr, std::size_t size, int node);
+
+/**
+ * Remember a region that should stay on a node for @ref
+ * report_remote_pages(). Typically called where the region is bound.
+ */
+void register_numa_region(std::string name, void const* addr, std::size_t size, int node);
+
+/**
+ * One line per registered region with its number of remote pages:
+ *
+ *     samples         node=1 pages=512 remote=0
+ *
+ * @return Total number of remote pages.
+ */
+long report_remote_pages(std::ostream&);
+} // preempt
@@ -0,0 +1,79 @@
+/* -*-coding:raw-text-unix-*-
+ *
+ * preempt/perf.h -- hardware performance counters of the calling thread
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace preempt {
+/**
+ * Counter values of one measurement. Counters that could not be opened are
+ * -1. Values are scaled if the kernel had to multiplex the counters.
+ */
+struct perf_sample {
+  std::int64_t task_clock = -1;         // nanoseconds on the CPU
+  std::int64_t cycles = -1;
+  std::int64_t instructions = -1;
+  std::int64_t cache_misses = -1;       // usually last level cache
+  std::int64_t branch_misses = -1;
+
+  /** Instructions per cycle or 0 if not counted. */
+  double ipc() const;
+
+  /** Mean clock frequency while running in GHz or 0 if not counted. */
+  double ghz() const;
+};
+
+/**
+ * @brief perf_event_open() counter group of the calling thread
+ *
+ * Counts user-space task clock, cycles, instructions, cache misses and branch
+ * misses of the thread that constructed the object as one group, so all
+ * values refer to the same interval.
+ *
+ * The software task clock works wherever perf_event_open() is permitted at
+ * all; the hardware counters are missing in most virtual machines. If
+ * /proc/sys/kernel/perf_event_paranoid or a seccomp filter forbids
+ * perf_event_open() nothing is counted and the object converts to false.
+ *
+ * Example:
+ *
+ *     preempt::perf_counters pc;
+ *     pc.start();
+ *     work();
+ *     auto s = pc.stop();
+ *     if (s.cycles != -1)
+ *       std::cout << "IPC " << s.ipc() << std::endl;
+ *
+ * start() and stop() are one ioctl() and one read() system call.
+ */
+class perf_counters {
+public:
+  perf_counters();
+  ~perf_counters();
+
+  perf_counters(perf_counters const&) = delete;
+  perf_counters& operator = (perf_counters const&) = delete;
+
+  /** True if at least one counter is open. */
+  explicit operator bool() const;
+
+  /** Reason why the first counter that failed could not be opened. */
+  std::string const& last_error() const;
+
+  /** Reset and enable the group. */
+  void start();
+
+  /** Disable the group and return the counts since start(). */
+  perf_sample stop();
+
+private:
+  enum { task_clock, cycles, instructions, cache_misses, branch_misses, count };
+
+  int fd_[count];
+  int leader_ = -1;
+  std::string error_;
+};
+} // preempt
@@ -6,6 +6,9 @@
 
 #include <base/posix.h>
 
+#include <cstddef>
+#include <iosfwd>
+
 namespace preempt {
 pid_t
 get_current_process_id();
@@ -14,6 +17,36 @@ pid_t
 get_parent_process_id();
 
 namespace this_process {
+/**
+ * How @ref lock_pages() locks the address space.
+ */
+enum class lock_mode {
+  /** mlockall(MCL_CURRENT | MCL_FUTURE), see @ref lock_all_pages(). Every
+      mapping becomes resident, including libraries, the stacks of non-realtime
+      threads and buffers only they touch. */
+  all,
+  /** mlockall(MCL_CURRENT | MCL_FUTURE | MCL_ONFAULT): a page is locked when
+      it is touched the first time, so untouched memory costs no RAM. The
+      realtime side must prefault what it uses, see @ref lock_region() and
+      base::stack_options. Same as all if the kernel (before Linux 4.4) or C
+      library does not know MCL_ONFAULT. */
+  on_fault,
+  /** No global locking: only what is locked with @ref lock_region() and
+      @ref lock_mapping() stays resident. */
+  regions
+};
+
+/**
+ * VmLck and VmRSS of /proc/self/status in KiB, -1 if unknown.
+ *
+ * Note that VmLck counts locked mappings in full even under
+ * lock_mode::on_fault; VmRSS shows what is actually resident.
+ */
+struct memory_usage {
+  long locked_kib = -1;
+  long resident_kib = -1;
+};
+
 /**
  * The only thing known to mess with the realtime scheduling policies is the
  * memory manager. To disable pagefaults all pages must be locked before calling
@@ -25,6 +58,12 @@ namespace this_process {
 void
 begin_realtime();
 
+/**
+ * Like @ref begin_realtime() but with a certain lock mode.
+ */
+void
+begin_realtime(lock_mode);
+
 /**
  * Undo @ref begin_realtime.
  */
@@ -66,6 +105,58 @@ lock_all_pages();
 bool
 unlock_all_pages();
 
+/**
+ * Lock the address space according to the mode. lock_mode::all is the same
+ * as @ref lock_all_pages(). Undo with @ref unlock_all_pages().
+ */
+bool
+lock_pages(lock_mode);
+
+/**
+ * Lock [addr, addr + size), extended to whole pages, and make it resident.
+ * Writable private pages are faulted in for writing. Use it for arenas, queues
+ * and other objects the realtime side touches.
+ */
+bool
+lock_region(void const* addr, std::size_t size);
+
+/**
+ * Undo @ref lock_region.
+ */
+bool
+unlock_region(void const* addr, std::size_t size);
+
+/**
+ * @ref lock_region() of an object.
+ */
+template <typename T>
+bool
+lock_object(T const& object) {
+  return lock_region(&object, sizeof object);
+}
+
+/**
+ * Lock the whole mapping of /proc/self/maps that contains addr. With the
+ * address of a function this locks the text segment of the executable or the
+ * library it belongs to.
+ */
+bool
+lock_mapping(void const* addr);
+
+/**
+ * Current VmLck and VmRSS of the process.
+ */
+memory_usage
+get_memory_usage();
+
+/**
+ * Write VmLck and VmRSS before and now:
+ *
+ *     VmLck: 0kB -> 2112kB, VmRSS: 3560kB -> 5672kB
+ */
+void
+report_memory_usage(std::ostream&, memory_usage const& before);
+
 /**
  * Disable writing of core file.
  */
@@ -0,0 +1,152 @@
+/* -*-coding:raw-text-unix-*-
+ *
+ * preempt/reactor.h -- one event loop for the non-real-time side of a process
+ */
+#pragma once
+
+#include <preempt/task.h>
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace preempt {
+/**
+ * Counters of a @ref reactor.
+ */
+struct reactor_stats {
+  long passes = 0;              // returns from epoll_wait() with events
+  long events = 0;              // callbacks run
+  long max_batch = 0;           // most events in one pass
+  long timer_expirations = 0;
+  long max_latency_ns = 0;      // timer expiration to callback, worst
+  long avg_latency_ns = 0;
+  long max_pass_ns = 0;         // longest dispatch pass
+};
+
+/**
+ * @brief epoll event loop with timers and wakeups from real-time threads
+ *
+ * Instead of one sleeping thread per concern, the non-real-time work of a
+ * process (supervision, logging, sockets) hangs off one thread that waits in
+ * epoll_wait(): file descriptors become ready, periodic and one-shot timers
+ * are timerfds, and real-time threads wake the loop through an eventfd with
+ * one write() that never blocks. All events of one epoll_wait() are
+ * dispatched in one pass, and wakeups and timer expirations that pile up
+ * are coalesced by the kernel's counters into one callback with the count.
+ *
+ * Registration is not thread-safe: watch(), every(), after(), wakeup()
+ * and remove() are called before start() or from callbacks. Only
+ * notifier::notify() and stop() may be called from other threads.
+ *
+ * Example:
+ *
+ *     preempt::reactor loop;
+ *     loop.every(100000, [](std::uint64_t) { report(); });
+ *     auto wake = loop.wakeup([](std::uint64_t n) { drain_samples(n); });
+ *     loop.start();
+ *     ...
+ *     wake.notify();             // from a real-time thread
+ */
+class reactor : public mono_task<> {
+public:
+  using callback = std::function<void(std::uint64_t)>;
+
+  /**
+   * @brief Wakes a @ref reactor from any thread
+   */
+  class notifier {
+  public:
+    notifier() noexcept { }
+
+    explicit operator bool() const noexcept { return fd_ >= 0; }
+
+    /** Add one to the eventfd: a single write() that never blocks. */
+    void notify() const noexcept;
+
+  private:
+    friend class reactor;
+    explicit notifier(int fd) noexcept : fd_ {fd} { }
+
+    int fd_ = -1;
+  };
+
+  reactor();
+  ~reactor();
+
+  reactor(reactor const&) = delete;
+  reactor& operator = (reactor const&) = delete;
+
+  explicit operator bool() const noexcept { return epoll_fd_ >= 0; }
+
+  std::string last_error() const { return error_; }
+
+  /**
+   * Call back with the epoll events (EPOLLIN...) when fd is ready. The fd
+   * stays the caller's.
+   *
+   * @return fd or -1.
+   */
+  int watch(int fd, std::uint32_t events, callback);
+
+  /**
+   * Periodic timer. The callback gets the number of expirations since the
+   * last call, more than 1 if the loop fell behind.
+   *
+   * @return Id for remove() or -1.
+   */
+  int every(long period_us, callback);
+
+  /** One-shot timer, removed after it fired. */
+  int after(long delay_us, callback);
+
+  /** Eventfd wakeup; the callback gets the number of notify() calls. */
+  notifier wakeup(callback);
+
+  /** Remove a watched fd, a timer or a notifier. */
+  bool remove(int id);
+
+  /**
+   * Wait at most timeout_ms (-1: forever) and dispatch one pass.
+   *
+   * @return Number of callbacks run, -1 on error.
+   */
+  int run_once(int timeout_ms = -1);
+
+  /** Dispatch until stop(). */
+  void run();
+
+  /** Run the loop on a SCHED_OTHER @ref preempt::thread. */
+  void start(base::stack_options const& = {});
+
+  /** End run() and join the loop thread. */
+  void stop();
+
+  /** Counters, consistent on the loop thread or after stop(). */
+  reactor_stats stats() const noexcept;
+
+private:
+  enum class kind : std::uint8_t { none, fd, timer, once, event };
+
+  struct entry {
+    kind type = kind::none;
+    callback fn;
+    std::int64_t period_ns = 0;
+    std::int64_t next_ns = 0;   // expected expiration of timers
+  };
+
+  int add(int fd, kind, std::uint32_t events, callback);
+  int timer(long delay_us, long period_us, kind, callback);
+  void dispatch(int fd, std::uint32_t events, std::int64_t now_ns);
+
+  int epoll_fd_ = -1;
+  int stop_fd_ = -1;
+  std::vector<entry> entries_;  // by fd
+  std::atomic<bool> stopping_ {false};
+  std::string error_;
+  reactor_stats stats_;
+  long latency_sum_ns_ = 0;
+};
+} // preempt
@@ -0,0 +1,107 @@
+/* -*-coding:raw-text-unix-*-
+ *
+ * preempt/schedulability.h -- offline analysis of periodic task sets
+ */
+#pragma once
+
+#include <base/posix.h>
+
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace preempt {
+namespace analysis {
+/**
+ * @brief Periodic task for the analysis
+ *
+ * Typically one @ref critical_task: wcet_us is its time slice Us, which the
+ * task enforces at run time.
+ */
+struct task_spec {
+  std::string name;
+  long period_us = 0;
+  long deadline_us = 0;         // relative, may exceed the period; 0: equal to it
+  long wcet_us = 0;
+  int priority = 0;             // SCHED_FIFO; higher runs first, 0: unassigned
+
+  long deadline() const noexcept { return deadline_us ? deadline_us : period_us; }
+};
+
+using task_set = std::vector<task_spec>;
+
+/** Sum of wcet / period. */
+double utilization(task_set const&);
+
+/** Liu and Layland bound n (2^(1/n) - 1) for n tasks. */
+double liu_layland_bound(std::size_t n);
+
+/**
+ * Sufficient test for rate-monotonic priorities and deadlines equal to
+ * periods: utilization() <= liu_layland_bound(). A set that fails it may
+ * still be schedulable, see @ref response_times().
+ */
+bool liu_layland_test(task_set const&);
+
+/**
+ * Exact worst-case response times for fixed priorities on one CPU, the
+ * classic recurrence R = C + sum over higher priorities of ceil(R / T) C.
+ * A deadline beyond the period lets jobs queue behind earlier jobs of the
+ * same task, so every job of the level-i busy period is analysed.
+ * Tasks of the same priority count as higher priority: SCHED_FIFO queues them
+ * in an order the analysis does not know.
+ *
+ * @return Response time per task in the order of the set, -1 for tasks
+ *         whose response time exceeds their deadline.
+ */
+std::vector<long> response_times(task_set const&);
+
+/** True if every task meets its deadline according to @ref response_times(). */
+bool response_time_test(task_set const&);
+
+/**
+ * Exact test for earliest deadline first on one CPU: the processor demand of
+ * all jobs with deadlines in [0, t] must not exceed t for every absolute
+ * deadline t up to the synchronous busy period.
+ */
+bool edf_test(task_set const&);
+
+/**
+ * Rate-monotonic priorities: the shorter the period the higher the
+ * priority. Distinct priorities from max downwards as long as there are
+ * enough levels, else spread evenly over [min, max].
+ */
+void assign_rate_monotonic(task_set&, int min = base::get_min_priority<SCHED_FIFO>(),
+                           int max = base::get_max_priority<SCHED_FIFO>());
+
+/** Deadline-monotonic priorities, optimal for deadlines up to the period. */
+void assign_deadline_monotonic(task_set&, int min = base::get_min_priority<SCHED_FIFO>(),
+                               int max = base::get_max_priority<SCHED_FIFO>());
+
+/**
+ * Read a task set, one task per line:
+ *
+ *     # name    period  deadline  wcet  [priority]     (microseconds)
+ *     control   1000    1000      200   90
+ *     logger    10000   0         1500
+ *
+ * @return False with a description in *error for a malformed line.
+ */
+bool parse_task_set(std::istream&, task_set&, std::string* error = nullptr);
+
+/**
+ * Print the set with response times and the result of every test.
+ *
+ * @return Result of @ref response_time_test(), the test for the SCHED_FIFO
+ *         priorities the tasks will actually run with.
+ */
+bool report(task_set const&, std::ostream&);
+
+/**
+ * Call @ref base::quick_exit with a report if the set fails the response time
+ * test. Meant for startup, before any thread of the set is created.
+ */
+void require_schedulable(task_set const&);
+} // analysis
+} // preempt
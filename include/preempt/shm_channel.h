@@ -0,0 +1,275 @@
+/* -*-coding:raw-text-unix-*-
+ *
+ * preempt/shm_channel.h -- lock-free channel between a real-time process and
+ *                          non-real-time processes
+ */
+#pragma once
+
+#include <base/posix.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>              // std::memcpy
+#include <string>
+
+namespace preempt {
+/**
+ * @brief Single-producer/single-consumer ring buffer in POSIX shared memory
+ *
+ * The ring lives in /dev/shm/<name>, is mapped into both processes and locked
+ * into RAM. Messages are written directly into fixed-size slots (zero-copy),
+ * head and tail are published with acquire/release atomics on separate cache
+ * lines.
+ *
+ * Either side may be the real-time side. The fast-path functions @ref
+ * reserve(), @ref commit(), @ref try_push(), @ref peek(), @ref release() and
+ * @ref try_pop() never block and never enter the kernel. Waking up a sleeping
+ * peer is a separate, explicit step (@ref notify()); it only costs a system
+ * call if the consumer is actually waiting.
+ *
+ * Producer (real-time process):
+ *
+ *     preempt::shm_channel ch {"/sensors", shm_channel::producer, 64, 1024,
+ *                              shm_channel::wakeup::futex};
+ *     if (void* slot = ch.reserve()) {
+ *       write_sample(slot);
+ *       ch.commit(sizeof(sample));
+ *     }
+ *
+ * Consumer (supervisor process):
+ *
+ *     preempt::shm_channel ch {"/sensors", shm_channel::consumer};
+ *     sample s;
+ *     while (ch.peer_alive()) {
+ *       if (ch.try_pop(&s, sizeof s))
+ *         handle(s);
+ *       else
+ *         ch.wait(10000);      // futex wait, at most 10ms
+ *     }
+ *
+ * The eventfd wakeup mode only works between processes that inherit the
+ * descriptor of the creating process (fork()).
+ */
+class shm_channel {
+public:
+  enum role { producer, consumer };
+  enum class wakeup { none, futex, eventfd };
+
+  /**
+   * Create a new channel: shm_open(O_CREAT|O_EXCL), size, map and lock it.
+   * The creating object unlinks the name in its destructor.
+   *
+   * @param slot_size: Maximum size of a message in bytes; it must fit in 32
+   *        bits. Messages are aligned for any type (std::max_align_t).
+   *
+   * @param slots: Capacity, rounded up to a power of two.
+   */
+  shm_channel(std::string name, role, std::size_t slot_size, std::size_t slots,
+              wakeup = wakeup::none);
+
+  /** Attach to a channel created by another process. */
+  shm_channel(std::string name, role);
+
+  ~shm_channel();
+
+  shm_channel(shm_channel const&) = delete;
+  shm_channel& operator = (shm_channel const&) = delete;
+
+  /** True if the channel is mapped, false otherwise (see last_error()). */
+  explicit operator bool() const noexcept { return hdr_ != nullptr; }
+
+  std::string last_error() const { return error_; }
+
+  std::size_t slot_size() const noexcept;
+  std::size_t capacity() const noexcept;
+
+  /** Number of messages in the ring (approximate while the peer runs). */
+  std::size_t size() const noexcept;
+
+  /**
+   * Producer: address of the next free slot or nullptr if full, aligned
+   * for any type.
+   */
+  void* reserve() noexcept;
+
+  /** Producer: publish the slot returned by reserve(). */
+  void commit(std::size_t size) noexcept;
+
+  /** Producer: copy a message into the ring. Returns false if full. */
+  bool try_push(void const* data, std::size_t size) noexcept;
+
+  /** Consumer: address of the oldest message or nullptr if empty. */
+  void const* peek(std::size_t* size = nullptr) noexcept;
+
+  /** Consumer: free the slot returned by peek(). */
+  void release() noexcept;
+
+  /** Consumer: copy at most max bytes of the oldest message. */
+  bool try_pop(void* buffer, std::size_t max, std::size_t* size = nullptr) noexcept;
+
+  /**
+   * Producer: wake the consumer if it sleeps in wait(). Costs one FUTEX_WAKE
+   * or eventfd write() in this case, otherwise one atomic load.
+   */
+  void notify() noexcept;
+
+  /**
+   * Consumer: sleep until the ring is not empty, @ref notify() was called or
+   * the timeout in microseconds passed. Without a wakeup mode this polls with
+   * sleeps of 100us.
+   *
+   * @return True if the ring is not empty.
+   */
+  bool wait(long timeout_us) noexcept;
+
+  /**
+   * True if the other side is attached and its process still exists. A
+   * process that crashed or exited without detaching is reported as dead.
+   * Calls kill(pid, 0), so do not use it on the real-time fast path.
+   */
+  bool peer_alive() const noexcept;
+
+  /** Number of reserve() calls that failed because the ring was full. */
+  std::uint64_t overruns() const noexcept;
+
+private:
+  struct header;
+
+  /** Length of a message in front of it, padded to keep the payload aligned. */
+  static constexpr std::size_t prefix = alignof(std::max_align_t);
+
+  unsigned char* slot(std::uint64_t index) const noexcept;
+  bool map(int fd, std::size_t bytes);
+
+  std::string name_;
+  std::string error_;
+  role role_;
+  bool owner_ = false;
+  header* hdr_ = nullptr;
+  std::size_t bytes_ = 0;
+  unsigned char* slots_ = nullptr;
+  std::uint64_t cached_ = 0;    // producer: tail, consumer: head
+  std::uint64_t local_ = 0;     // producer: head, consumer: tail
+};
+
+/***********************************************************************
+ * inlined implementation
+ */
+struct shm_channel::header {
+  std::uint32_t magic;
+  std::uint32_t version;
+  std::uint32_t slot_size;      // payload bytes
+  std::uint32_t stride;         // bytes between slots
+  std::uint64_t mask;           // slots - 1
+  std::int32_t  wakeup;
+  std::int32_t  eventfd;
+
+  alignas(CACHELINE_SIZE) std::atomic<std::uint64_t> head;     // producer
+  std::atomic<std::uint64_t> overruns;
+  alignas(CACHELINE_SIZE) std::atomic<std::uint64_t> tail;     // consumer
+  alignas(CACHELINE_SIZE) std::atomic<std::int32_t> pid[2];    // producer, consumer
+  std::atomic<std::uint32_t> waiting;
+  std::atomic<std::uint32_t> futex;
+};
+
+inline
+unsigned char*
+shm_channel::slot(std::uint64_t index) const noexcept {
+  return slots_ + (index & hdr_->mask) * hdr_->stride;
+}
+
+inline
+std::size_t
+shm_channel::slot_size() const noexcept {
+  return hdr_->slot_size;
+}
+
+inline
+std::size_t
+shm_channel::capacity() const noexcept {
+  return hdr_->mask + 1;
+}
+
+inline
+std::size_t
+shm_channel::size() const noexcept {
+  return hdr_->head.load(std::memory_order_acquire) - hdr_->tail.load(std::memory_order_acquire);
+}
+
+inline
+void*
+shm_channel::reserve() noexcept {
+  if (local_ - cached_ > hdr_->mask) {
+    /* looks full: only now touch the consumer's cache line */
+    cached_ = hdr_->tail.load(std::memory_order_acquire);
+    if (local_ - cached_ > hdr_->mask) {
+      hdr_->overruns.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    }
+  }
+  return slot(local_) + prefix;
+}
+
+inline
+void
+shm_channel::commit(std::size_t size) noexcept {
+  std::uint32_t const n = size < hdr_->slot_size ? size : hdr_->slot_size;
+  std::memcpy(slot(local_), &n, sizeof n);
+  hdr_->head.store(++local_, std::memory_order_release);
+}
+
+inline
+bool
+shm_channel::try_push(void const* data, std::size_t size) noexcept {
+  if (void* p = reserve()) {
+    std::memcpy(p, data, size < hdr_->slot_size ? size : hdr_->slot_size);
+    commit(size);
+    return true;
+  }
+  return false;
+}
+
+inline
+void const*
+shm_channel::peek(std::size_t* size) noexcept {
+  if (local_ == cached_) {
+    cached_ = hdr_->head.load(std::memory_order_acquire);
+    if (local_ == cached_)
+      return nullptr;
+  }
+  unsigned char const* p = slot(local_);
+  if (size) {
+    std::uint32_t n;
+    std::memcpy(&n, p, sizeof n);
+    *size = n;
+  }
+  return p + prefix;
+}
+
+inline
+void
+shm_channel::release() noexcept {
+  hdr_->tail.store(++local_, std::memory_order_release);
+}
+
+inline
+bool
+shm_channel::try_pop(void* buffer, std::size_t max, std::size_t* size) noexcept {
+  std::size_t n;
+  if (void const* p = peek(&n)) {
+    std::memcpy(buffer, p, n < max ? n : max);
+    if (size)
+      *size = n;
+    release();
+    return true;
+  }
+  return false;
+}
+
+inline
+std::uint64_t
+shm_channel::overruns() const noexcept {
+  return hdr_->overruns.load(std::memory_order_relaxed);
+}
+} // preempt
@@ -7,6 +7,9 @@
 #include <vector>
 #include <mutex>
 
+#include <preempt/budget.h>
+#include <preempt/numa.h>
+#include <preempt/perf.h>
 #include <preempt/thread.h>
 
 namespace preempt {
@@ -32,7 +35,10 @@ public:
  * Task that uses a single thread to distribute work.
  *
  * Technically a wrapper around std::thread or preempt::thread with a @ref
- * basic_thread interface.
+ * basic_thread interface. spawn() passes its arguments to the constructor of
+ * Thread, so a preempt::thread takes base::stack_options first:
+ *
+ *     spawn(stack, &task::run, this);
  *
  * Example:
  *
@@ -133,8 +139,36 @@ public:
   void start(int priority = 1);
 
   /**
-   * Actual thread function. May not consume more than Ms milliseconds or the
-   * process terminates.
+   * Like start(int) but with a stack of a certain size, prefaulted or
+   * measured, see @ref base::stack_options.
+   */
+  void start(int priority, base::stack_options const&);
+
+  /**
+   * Run on a certain CPU with the memory of its NUMA node, see @ref
+   * run_on_cpu(). Takes effect with the next start(); -1 does not pin.
+   */
+  void pin(int cpu);
+
+  /**
+   * Count hardware events of run() with @ref perf_counters. Opening the
+   * counters costs a few system calls on the task's thread before run();
+   * reading them is not included in runtime().
+   */
+  void count_events(bool on = true);
+
+  /**
+   * Enforce the time slice as a budget of CPU time while run() runs, see
+   * @ref cpu_budget: an overrun is caught within a scheduler tick even if
+   * run() never returns. Takes effect with the next start().
+   */
+  void enforce_budget(overrun_action);
+
+  /**
+   * Actual thread function. May not consume more than Us microseconds. By
+   * default the process terminates when it returns late; with @ref
+   * enforce_budget() the configured action is taken instead, as soon as the
+   * budget is used up.
    */
   virtual void run() = 0;
 
@@ -143,10 +177,32 @@ public:
    */
   long runtime() const;
 
+  /**
+   * Performance counters of the last run() if enabled by @ref count_events().
+   * Counters that are not available are -1.
+   */
+  perf_sample const& counters() const;
+
+  /** True if the budget expired during the last run(), see @ref enforce_budget(). */
+  bool overrun() const;
+
+protected:
+  /**
+   * End run() here if its budget expired with overrun_action::cancel. Call
+   * it in loops of run() that may not terminate in time.
+   */
+  static void cancellation_point() { cpu_budget::cancellation_point(); }
+
 private:
   void hook();
+  void timed_run();
 
   long usec_;
+  int cpu_ = -1;
+  bool count_events_ = false;
+  overrun_action budget_action_ = overrun_action::none;
+  cpu_budget budget_;
+  perf_sample counters_;
 };
 
 /***********************************************************************
@@ -218,7 +274,37 @@ poly_task<Thread>::threads() {
 template <long Us>
 void
 critical_task<Us>::start(int priority) {
-  spawn(&critical_task::hook, this).change_scheduling(SCHED_FIFO, priority);
+  start(priority, base::stack_options {});
+}
+
+template <long Us>
+void
+critical_task<Us>::start(int priority, base::stack_options const& stack) {
+  spawn(SCHED_FIFO, priority, stack, &critical_task::hook, this);
+}
+
+template <long Us>
+void
+critical_task<Us>::pin(int cpu) {
+  cpu_ = cpu;
+}
+
+template <long Us>
+void
+critical_task<Us>::count_events(bool on) {
+  count_events_ = on;
+}
+
+template <long Us>
+void
+critical_task<Us>::enforce_budget(overrun_action action) {
+  budget_action_ = action;
+}
+
+template <long Us>
+bool
+critical_task<Us>::overrun() const {
+  return budget_.expired();
 }
 
 template <long Us>
@@ -227,21 +313,52 @@ critical_task<Us>::runtime() const {
   return usec_;
 }
 
+template <long Us>
+perf_sample const&
+critical_task<Us>::counters() const {
+  return counters_;
+}
+
 template <long Us>
 void
 critical_task<Us>::hook()
+{
+  if (cpu_ >= 0 && !run_on_cpu(cpu_))
+    base::quick_exit(base::sprintf("critical_task error: run_on_cpu(%d)", cpu_).c_str());
+  if (count_events_) {
+    perf_counters pc;           // counts this thread only
+    pc.start();
+    timed_run();
+    counters_ = pc.stop();
+  } else {
+    timed_run();
+  }
+}
+
+template <long Us>
+void
+critical_task<Us>::timed_run()
 {
   // TODO: use base::timeout()?
   using namespace std;
   using namespace std::chrono;
+  if (!budget_.arm(Us, budget_action_))
+    base::quick_exit(budget_.last_error().c_str());
   auto start = clock::now();
   auto deadline = start + microseconds {Us};
-  { run(); }
+  try {
+    run();
+  } catch (budget_exceeded const&) {
+    // cancelled at a cancellation_point()
+  }
   auto stop = clock::now();
+  budget_.disarm();
   auto us = duration_cast<microseconds>(stop - start);
   usec_ = us.count();           // just store last duration
-  if (stop > deadline) {
-    base::quick_exit(base::sprintf("critical_task error: deadline=%luus used=%lums", Us, usec_).c_str());
+  if (budget_action_ == overrun_action::none && stop > deadline) {
+    base::static_string<80> error;   // no allocation on the real-time thread
+    base::format_to(error, "critical_task error: deadline=%ldus used=%ldus", Us, usec_);
+    base::quick_exit(error.c_str());
   }
 }
 } // preempt
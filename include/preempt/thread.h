@@ -10,10 +10,69 @@
 #include <base/verify.h>
 #include <base/threading.h>
 
-#include <cstring>              // std::strerror
 #include <cassert>
+#include <cstddef>
+#include <cstring>              // std::strerror
+#include <iosfwd>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 namespace preempt {
+class thread;
+
+namespace details {
+/** Thread function and its arguments, owned by the new thread. */
+struct thread_start {
+  base::stack_options stack;
+
+  virtual ~thread_start() { }
+  virtual void run() = 0;
+};
+
+/** INVOKE of the standard for functions, functors and member functions. */
+template <class F, class... Args>
+auto
+invoke(F&& f, Args&&... args) -> decltype(std::forward<F>(f)(std::forward<Args>(args)...)) {
+  return std::forward<F>(f)(std::forward<Args>(args)...);
+}
+
+template <class M, class C, class P, class... Args>
+auto
+invoke(M C::* pm, P&& p, Args&&... args)
+  -> decltype(((*std::forward<P>(p)).*pm)(std::forward<Args>(args)...)) {
+  return ((*std::forward<P>(p)).*pm)(std::forward<Args>(args)...);
+}
+
+template <class M, class C, class O, class... Args>
+auto
+invoke(M C::* pm, O&& o, Args&&... args)
+  -> decltype((std::forward<O>(o).*pm)(std::forward<Args>(args)...)) {
+  return (std::forward<O>(o).*pm)(std::forward<Args>(args)...);
+}
+
+template <class... T>
+struct thread_call : thread_start {
+  std::tuple<T...> call;
+
+  template <class... U>
+  explicit thread_call(U&&... u) : call {std::forward<U>(u)...} { }
+
+  void run() override { apply(std::index_sequence_for<T...> {}); }
+
+  template <std::size_t... I>
+  void apply(std::index_sequence<I...>) { invoke(std::move(std::get<I>(call))...); }
+};
+
+template <class Function, class F = typename std::decay<Function>::type>
+using enable_if_thread_function = typename std::enable_if<
+  !std::is_integral<F>::value && !std::is_same<F, base::stack_options>::value
+  && !std::is_same<F, thread>::value>::type;
+} // details
+
 /**
  * @brief Like std::thread but with optional realtime priority and POSIX
  * scheduling policies
@@ -24,12 +83,17 @@ namespace preempt {
  *     thr = preempt::thread(function)                 // no priority
  *     thr = preempt::thread(SCHED_FIFO, 10, function) // priority 10
  *
+ *     base::stack_options stack;
+ *     stack.size = 64 * 1024;
+ *     stack.prefault = true;
+ *     thr = preempt::thread(SCHED_FIFO, 10, stack, function)
+ *
  * @see https://en.cppreference.com/w/cpp/thread/thread
  */
 class thread
 {
 public:
-  using native_handle_type = std::thread::native_handle_type;
+  using native_handle_type = pthread_t;
   using id = std::thread::id;
 
   /** The default constructor creates a new thread object which does not
@@ -42,26 +106,35 @@ public:
       represents a thread of execution.
   */
   thread(thread&& other) noexcept;
-  thread(std::thread&& other) noexcept;
 
   /** Construct new, normal thread object. Under POSIX this means a thread
       running under the SCHED_OTHER scheduling policy and priority 0. To set a
       new scheduling policy and priority @ref try_scheduling().
   */
-  template<class Function, class... Args>
+  template<class Function, class... Args,
+           class = details::enable_if_thread_function<Function>>
   explicit thread(Function&& f, Args&&... args);
 
   /** Start a realtime thread with a certain scheduling policy and priority.
-      Before the ctor returns the thread may not only begin execution, but also
-      can preempt any other threads with a lower priority (@ref
-      change_scheduling).
+      The thread begins execution with this policy and priority and can
+      preempt any other threads with a lower priority before the ctor returns.
 
-      If setting the policy/priority fails the process is exited with
+      If the thread cannot be created the process is exited with
       EXIT_FAILURE.
   */
-  template<class Function, class... Args>
+  template<class Function, class... Args,
+           class = details::enable_if_thread_function<Function>>
   explicit thread(int policy, int priority, Function&&, Args&&...);
 
+  /** Like the constructors above but with a stack of a given size. With
+      stack_options::watermark the peak stack usage is measured when the
+      thread function returns, see @ref stack_high_water_mark().
+  */
+  template<class Function, class... Args>
+  thread(base::stack_options const&, Function&&, Args&&...);
+  template<class Function, class... Args>
+  thread(int policy, int priority, base::stack_options const&, Function&&, Args&&...);
+
   /** Free the occupied system resources. */
   ~thread();
 
@@ -138,13 +211,56 @@ public:
   */
   void change_scheduling(int policy, int priority) noexcept;
 
-  std::string last_error() const noexcept { return error_; }
+  /** Peak stack usage in bytes of a joined thread that was started with
+      stack_options::watermark, else 0. */
+  std::size_t stack_high_water_mark() const noexcept;
+
+  /** Description of the last failure of try_scheduling(). Formatted on
+      demand: the handle itself only keeps the error number. */
+  std::string last_error() const;
 
 private:
-  std::thread impl_;
-  std::string error_;
+  void start(int policy, int priority, base::stack_options const&, details::thread_start*);
+
+  pthread_t handle_ {};
+  bool joinable_ = false;
+  int errnum_ = 0;
+  std::size_t stack_peak_ = 0;
+};
+
+static_assert(sizeof(thread) <= sizeof(pthread_t) + 2 * sizeof(void*),
+              "preempt::thread is compact");
+
+/**
+ * Peak stack usage of a finished thread started with
+ * stack_options::watermark.
+ */
+struct stack_usage {
+  char name[16];                // pthread_getname_np()
+  std::size_t size;             // bytes, without guard
+  std::size_t peak;             // bytes
+
+  /** Twice the peak rounded up to pages, at least PTHREAD_STACK_MIN. */
+  std::size_t suggested_size() const;
 };
 
+/**
+ * Stack usage of the first 256 threads that were started with
+ * stack_options::watermark and have finished. Recording takes no lock and does
+ * not allocate.
+ */
+std::vector<stack_usage> stack_usages();
+
+/**
+ * One line per entry of @ref stack_usages() with the stack size it suggests:
+ *
+ *     worker      size=8192KiB peak=12KiB suggested=24KiB
+ *
+ * Locked memory shrinks by the difference for each thread under
+ * mlockall(MCL_FUTURE).
+ */
+void report_stack_usage(std::ostream&);
+
 #if 0
 template <int Policy, int Priority>
 class static_thread : public thread ..
@@ -158,20 +274,32 @@ thread::thread() noexcept {}
 
 inline
 thread::thread(thread&& other) noexcept
-  : impl_ {std::move(other.impl_)} {}
+  : handle_ {other.handle_}, joinable_ {other.joinable_}, errnum_ {other.errnum_},
+    stack_peak_ {other.stack_peak_} {
+  other.joinable_ = false;
+  other.errnum_ = 0;
+  other.stack_peak_ = 0;
+}
 
-inline
-thread::thread(std::thread&& other) noexcept
-  : impl_ {std::move(other)} {}
+template<class Function, class... Args, class>
+thread::thread(Function&& f, Args&&... args)
+  : thread {base::stack_options {}, std::forward<Function>(f), std::forward<Args>(args)...} { }
+
+template<class Function, class... Args, class>
+thread::thread(int policy, int priority, Function&& f, Args&&... args)
+  : thread {policy, priority, base::stack_options {}, std::forward<Function>(f),
+            std::forward<Args>(args)...} { }
 
 template<class Function, class... Args>
-thread::thread(Function&& f, Args&&... args)
-  : impl_ {std::forward<Function>(f), std::forward<Args>(args)...} { }
+thread::thread(base::stack_options const& stack, Function&& f, Args&&... args)
+  : thread {SCHED_OTHER, 0, stack, std::forward<Function>(f), std::forward<Args>(args)...} { }
 
 template<class Function, class... Args>
-thread::thread(int policy, int priority, Function&& f, Args&&... args)
-  : thread{std::forward<Function>(f), std::forward<Args>(args)...} {
-  change_scheduling(policy, priority); // may not return
+thread::thread(int policy, int priority, base::stack_options const& stack, Function&& f,
+               Args&&... args) {
+  using call = details::thread_call<typename std::decay<Function>::type,
+                                    typename std::decay<Args>::type...>;
+  start(policy, priority, stack, new call {std::forward<Function>(f), std::forward<Args>(args)...});
 }
 
 inline
@@ -185,56 +313,67 @@ thread::~thread() {
 
 inline
 thread& thread::operator = (thread&& other) noexcept {
-  impl_ = std::move(other.impl_);
+  if (joinable())
+    std::terminate();           // like std::thread
+  thread {std::move(other)}.swap(*this);
   return *this;
 }
 
 inline
 bool
 thread::joinable() const noexcept {
-  return impl_.joinable();
+  return joinable_;
 }
 
 inline
 thread::id
 thread::get_id() const noexcept {
-  return impl_.get_id();
+  return joinable_ ? id {handle_} : id {};
 }
 
 inline
 thread::native_handle_type
 thread::native_handle() {
-  return impl_.native_handle();
+  return handle_;
 }
 
 inline
 void
-thread::join() {
-  return impl_.join();
+thread::swap(thread& other) noexcept {
+  std::swap(handle_, other.handle_);
+  std::swap(joinable_, other.joinable_);
+  std::swap(errnum_, other.errnum_);
+  std::swap(stack_peak_, other.stack_peak_);
 }
 
 inline
-void
-thread::detach() {
-  return impl_.detach();
+bool
+thread::try_scheduling(int policy, int priority) noexcept {
+  if (false == joinable_)
+    return true;
+  errnum_ = base::set_scheduling(handle_, policy, priority);
+  return errnum_ == 0;
 }
 
 inline
 void
-thread::swap(thread& other) noexcept {
-  return impl_.swap(other.impl_);
+thread::change_scheduling(int policy, int priority) noexcept {
+  if (false == try_scheduling(policy, priority))
+    base::quick_exit(last_error().c_str());
 }
 
 inline
-bool
-thread::try_scheduling(int policy, int priority) noexcept {
-  return base::try_scheduling(impl_, policy, priority, &error_);
+std::size_t
+thread::stack_high_water_mark() const noexcept {
+  return stack_peak_;
 }
 
 inline
-void
-thread::change_scheduling(int policy, int priority) noexcept {
-  base::change_scheduling(impl_, policy, priority, &error_);
+std::string
+thread::last_error() const {
+  if (errnum_ == 0)
+    return std::string {};
+  return base::sprintf("FAILED: pthread_setschedparam(): '%s'", std::strerror(errnum_));
 }
 
 inline
@@ -0,0 +1,139 @@
+/* -*-coding:raw-text-unix-*-
+ *
+ * preempt/timing_wheel.h -- thousands of software timers on one tick
+ */
+#pragma once
+
+#include <preempt/task.h>
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+namespace preempt {
+/**
+ * @brief Hierarchical timing wheel
+ *
+ * Timers are kept in four wheels: 256 slots of one tick, then three wheels
+ * of 64 slots each 64 times coarser, which covers 2^26 ticks (about 18 hours
+ * at 1ms); later timers wait in the last slot. Arming and cancelling
+ * unlink and link a list node, and a tick takes the timers of one slot; when
+ * a wheel wraps, one slot of the next coarser wheel is spread over the finer
+ * ones. Everything is O(1) and nothing is allocated: the timers belong to
+ * the caller.
+ *
+ * The wheel is driven either by its own SCHED_FIFO thread with an absolute
+ * clock_nanosleep() per tick (start()) or by calling advance() from an
+ * existing tick, e.g. a @ref cyclic_executive task. The callbacks of a tick
+ * run as a batch on that thread, without the wheel's lock, so they may arm
+ * timers again. arm() and cancel() may be called from any thread.
+ *
+ * Example:
+ *
+ *     void on_timeout(preempt::timing_wheel::timer& t) { ... }
+ *
+ *     preempt::timing_wheel wheel {1000};      // 1ms ticks
+ *     preempt::timing_wheel::timer t {&on_timeout};
+ *     wheel.start(10);
+ *     wheel.arm(t, 250000);                    // in 250ms
+ *     ...
+ *     wheel.cancel(t);
+ */
+class timing_wheel : public mono_task<> {
+  struct link {
+    link* next = this;
+    link* prev = this;
+  };
+
+public:
+  /**
+   * @brief Timer of a @ref timing_wheel, owned by the caller
+   */
+  class timer : private link {
+  public:
+    using callback = void (*)(timer&);
+
+    explicit timer(callback fn, void* context = nullptr) noexcept
+      : fn_ {fn}, context_ {context} { }
+
+    /** Cancels the timer. */
+    ~timer();
+
+    timer(timer const&) = delete;
+    timer& operator = (timer const&) = delete;
+
+    /** True between arm() and expiry or cancel(). */
+    bool armed() const noexcept { return wheel_.load(std::memory_order_relaxed) != nullptr; }
+
+    void* context() const noexcept { return context_; }
+
+  private:
+    friend class timing_wheel;
+
+    std::uint64_t expires_ = 0;                   // tick
+    std::atomic<timing_wheel*> wheel_ {nullptr};
+    callback fn_;
+    void* context_;
+  };
+
+  explicit timing_wheel(long tick_us);
+
+  ~timing_wheel() { stop(); }
+
+  /** Start a SCHED_FIFO thread that advances the wheel every tick. */
+  void start(int priority = 1, base::stack_options const& = {});
+
+  /** End and join the tick thread. */
+  void stop();
+
+  /**
+   * Let a timer expire in delay_us, rounded up to whole ticks and at least
+   * one tick. An armed timer is moved.
+   */
+  void arm(timer&, long delay_us);
+
+  /** Same with the delay in ticks, at least 1. */
+  void arm_ticks(timer&, std::uint64_t ticks);
+
+  /** Disarm a timer; does nothing if it is not armed. */
+  void cancel(timer&);
+
+  /**
+   * Process ticks and run the callbacks of each tick as a batch.
+   *
+   * @return Number of callbacks run.
+   */
+  std::size_t advance(std::uint64_t ticks = 1);
+
+  /** Ticks processed so far. */
+  std::uint64_t ticks() const noexcept { return current_.load(std::memory_order_relaxed); }
+
+  long tick_us() const noexcept { return tick_us_; }
+
+  /** Number of armed timers. */
+  std::size_t size() const noexcept { return size_.load(std::memory_order_relaxed); }
+
+private:
+  static constexpr int root_bits = 8;
+  static constexpr int level_bits = 6;
+  static constexpr int levels = 3;                // above the root wheel
+  static constexpr std::size_t root_size = std::size_t(1) << root_bits;
+  static constexpr std::size_t level_size = std::size_t(1) << level_bits;
+
+  void add(timer&);
+  void cascade(int level, std::size_t index);
+  void tick_thread();
+
+  static void unlink(link&) noexcept;
+  static void push(link& head, link&) noexcept;
+
+  long tick_us_;
+  std::mutex mutex_;
+  std::atomic<std::uint64_t> current_ {0};        // next tick to process
+  std::atomic<std::size_t> size_ {0};
+  std::atomic<bool> stopping_ {false};
+  link root_[root_size];
+  link wheels_[levels][level_size];
+};
+} // preempt
@@ -0,0 +1,210 @@
+/* -*-coding:raw-text-unix-*-
+ *
+ * preempt/tracepoint.h -- binary event recorder with ftrace correlation
+ */
+#pragma once
+
+#include <base/details/cc.h>    // CACHELINE_SIZE
+
+#include <time.h>
+#include <sched.h>
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>          // __rdtscp
+#endif
+
+/**
+ * Record an event with an id (0..65535) and a 64-bit payload. Costs one
+ * relaxed load while recording is stopped.
+ *
+ * @example:
+ *     PREEMPT_TRACEPOINT(EV_ACTIVATE, cycle);
+ */
+#define PREEMPT_TRACEPOINT(id, payload)                         \
+  ::preempt::tracing::record(static_cast<std::uint16_t>(id),    \
+                             static_cast<std::uint64_t>(payload))
+
+namespace preempt {
+/**
+ * @brief Low-overhead tracepoints
+ *
+ * Each thread writes compact binary events (timestamp counter, CPU, thread
+ * id, event id, payload) into its own lock-free ring buffer. A SCHED_OTHER
+ * flusher thread drains the rings into a memory-mapped file. Because the
+ * file header stores the timestamp counter frequency and a reference point
+ * of CLOCK_MONOTONIC, @ref decode() prints monotonic timestamps that line up
+ * with an ftrace recording using "trace_clock=mono". Optionally every event is
+ * also written to the ftrace trace_marker file.
+ *
+ * Example:
+ *
+ *     namespace tracing = preempt::tracing;
+ *     enum { EV_START = 1, EV_STOP };
+ *
+ *     tracing::define(EV_START, "start");
+ *     tracing::define(EV_STOP, "stop");
+ *     tracing::start("/tmp/firmware.trace");
+ *
+ *     // in each real-time thread, before the loop:
+ *     tracing::register_thread();
+ *     for (;;) {
+ *       PREEMPT_TRACEPOINT(EV_START, cycle);
+ *         .
+ *       PREEMPT_TRACEPOINT(EV_STOP, cycle);
+ *     }
+ *
+ *     tracing::stop();
+ *     tracing::decode("/tmp/firmware.trace", std::cout, tracing::format::chrome);
+ *
+ * A full ring drops events (counted) instead of waiting for the flusher.
+ */
+namespace tracing {
+/** Event as stored in the rings and in the trace file. */
+struct event {
+  std::uint64_t tsc;            // timestamp counter
+  std::uint64_t payload;
+  std::uint32_t tid;
+  std::uint16_t cpu;
+  std::uint16_t id;
+};
+
+enum class format { text, chrome };
+
+/** Events per thread ring, a power of two. */
+constexpr std::size_t ring_capacity = 8192;
+
+/** Names of event ids 0..max_named_events - 1 are stored in the trace file. */
+constexpr std::size_t max_named_events = 256;
+
+/**
+ * Define the name of an event id. Names are written into the trace file when
+ * recording stops and printed by @ref decode().
+ */
+void define(std::uint16_t id, char const* name);
+
+/**
+ * Start recording into a new file.
+ *
+ * @param flush_ms: Interval of the flusher thread in milliseconds.
+ *
+ * @param trace_marker: Also write every event as text into
+ *        /sys/kernel/tracing/trace_marker. This costs a write() system call
+ *        per event on the recording thread.
+ *
+ * @return False if recording is active or the trace file or trace_marker could
+ *         not be opened, see @ref last_error().
+ */
+bool start(std::string const& path, unsigned flush_ms = 10, bool trace_marker = false);
+
+/** Reason why the last call to start() failed. */
+std::string last_error();
+
+/** Stop the flusher, write remaining events and close the file. */
+void stop();
+
+/** True between start() and stop(). */
+bool active() noexcept;
+
+/**
+ * Allocate the ring of the calling thread. Otherwise the first tracepoint of
+ * a thread allocates it, which real-time threads should avoid.
+ */
+void register_thread();
+
+/** Move events from all rings into the file (done by the flusher thread). */
+std::size_t flush();
+
+/** Events dropped so far because a ring was full. */
+std::uint64_t dropped() noexcept;
+
+/**
+ * Print a trace file as text (one event per line) or in the Chrome trace
+ * event format (load into chrome://tracing or Perfetto).
+ *
+ * @return Number of events or -1 if the file is not a trace.
+ */
+long decode(std::string const& path, std::ostream&, format = format::text);
+
+/** Write an event, see @ref PREEMPT_TRACEPOINT. */
+void record(std::uint16_t id, std::uint64_t payload) noexcept;
+
+namespace details {
+struct alignas(CACHELINE_SIZE) ring {
+  alignas(CACHELINE_SIZE) std::atomic<std::uint64_t> head {0};  // owner thread
+  std::uint64_t cached_tail = 0;
+  std::atomic<std::uint64_t> dropped {0};
+  std::uint32_t tid = 0;
+  alignas(CACHELINE_SIZE) std::atomic<std::uint64_t> tail {0};  // flusher
+  std::atomic<bool> orphaned {false};
+  event events[ring_capacity];
+};
+
+extern std::atomic<bool> g_recording;
+extern std::atomic<int> g_marker_fd;
+
+ring* register_ring();
+void write_marker(std::uint16_t id, std::uint64_t payload) noexcept;
+
+inline
+ring*&
+this_ring() noexcept {
+  static thread_local ring* r = nullptr;
+  return r;
+}
+
+inline
+std::uint64_t
+read_tsc(std::uint32_t* cpu) noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+  unsigned aux;
+  std::uint64_t const tsc = __rdtscp(&aux);
+  *cpu = aux & 0xfff;           // Linux stores cpu | node << 12 in TSC_AUX
+  return tsc;
+#else
+  ::timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  *cpu = ::sched_getcpu();
+  return std::uint64_t(ts.tv_sec) * 1000000000u + ts.tv_nsec;
+#endif
+}
+} // details
+
+/***********************************************************************
+ * inlined implementation
+ */
+inline
+void
+record(std::uint16_t id, std::uint64_t payload) noexcept {
+  using namespace details;
+  if (!g_recording.load(std::memory_order_relaxed))
+    return;
+  ring* r = this_ring();
+  if (r == nullptr && (r = register_ring()) == nullptr)
+    return;
+  std::uint64_t const head = r->head.load(std::memory_order_relaxed);
+  if (head - r->cached_tail >= ring_capacity) {
+    r->cached_tail = r->tail.load(std::memory_order_acquire);
+    if (head - r->cached_tail >= ring_capacity) {
+      r->dropped.store(r->dropped.load(std::memory_order_relaxed) + 1,
+                       std::memory_order_relaxed);
+      return;
+    }
+  }
+  event& e = r->events[head & (ring_capacity - 1)];
+  std::uint32_t cpu;
+  e.tsc = read_tsc(&cpu);
+  e.payload = payload;
+  e.tid = r->tid;
+  e.cpu = std::uint16_t(cpu);
+  e.id = id;
+  r->head.store(head + 1, std::memory_order_release);
+  if (g_marker_fd.load(std::memory_order_relaxed) != -1)
+    write_marker(id, payload);
+}
+} // tracing
+} // preempt
@@ -0,0 +1,139 @@
+/* -*-coding:raw-text-unix-*-
+ *
+ * preempt/watchdog.h -- demote real-time threads that stop making progress
+ */
+#pragma once
+
+#include <preempt/task.h>
+
+#include <base/details/cc.h>    // CACHELINE_SIZE
+
+#include <atomic>
+#include <cstdint>
+
+#include <sys/types.h>
+
+namespace preempt {
+namespace details {
+/**
+ * Heartbeat of one monitored thread. The thread writes beats; everything
+ * the watchdog reads per period shares this cache line.
+ */
+struct alignas(CACHELINE_SIZE) watchdog_slot {
+  std::atomic<std::uint64_t> beats {0};
+  std::atomic<std::uint32_t> generation {0};    // modulo 4: 2 watched
+  std::atomic<long> missed {0};                 // written by the watchdog on a miss
+  ::pid_t tid = 0;
+  long window_ns = 0;
+  bool escalate = false;
+  char name[16] {};
+};
+} // details
+
+/**
+ * @brief Watchdog thread for stuck real-time threads
+ *
+ * With RT throttling disabled (sched_rt_runtime_us = -1) nothing stops a
+ * SCHED_FIFO thread that spins. The watchdog runs at the highest SCHED_FIFO
+ * priority, preferably on a housekeeping CPU, and wakes up once per period.
+ * A monitored thread calls heartbeat::beat() regularly; if its counter does
+ * not change for longer than its window the thread is demoted to
+ * SCHED_OTHER, reported on stderr and, if so registered, the process ends
+ * with @ref base::quick_exit.
+ *
+ * Per period the watchdog reads one cache line per monitored thread and
+ * writes nothing shared unless a thread is stuck. beat() is a relaxed
+ * atomic increment of a counter no other thread writes.
+ *
+ * Example:
+ *
+ *     preempt::watchdog wd {1000, 0};      // 1ms period on CPU 0
+ *     wd.start();
+ *     ...
+ *     // in the real-time thread
+ *     auto hb = wd.watch("control", 5000);
+ *     for (;;) {
+ *       hb.beat();
+ *       step();
+ *     }
+ */
+class watchdog : public mono_task<> {
+public:
+  static constexpr int max_threads = 64;
+
+  /**
+   * @brief Handle of a monitored thread
+   */
+  class heartbeat {
+  public:
+    heartbeat() noexcept { }
+
+    /** False if the watchdog had no free slot. */
+    explicit operator bool() const noexcept { return slot_ != nullptr; }
+
+    /** Signal progress. */
+    void beat() noexcept { slot_->beats.fetch_add(1, std::memory_order_relaxed); }
+
+    /** Number of windows the thread missed so far. */
+    long missed() const noexcept { return slot_->missed.load(std::memory_order_relaxed); }
+
+  private:
+    friend class watchdog;
+    explicit heartbeat(details::watchdog_slot* slot) noexcept : slot_ {slot} { }
+
+    details::watchdog_slot* slot_ = nullptr;
+  };
+
+  /**
+   * @param period_us: Interval of the checks. A stuck thread is found at most
+   *        one period after its window ends.
+   *
+   * @param cpu: CPU of the watchdog thread, -1 for any.
+   *
+   * @param priority: SCHED_FIFO priority, by default the highest.
+   */
+  explicit watchdog(long period_us = 10000, int cpu = -1,
+                    int priority = base::get_max_priority<SCHED_FIFO>());
+
+  ~watchdog() { stop(); }
+
+  /** Start the watchdog thread. */
+  void start(base::stack_options const& = {});
+
+  /** End and join the watchdog thread. */
+  void stop();
+
+  /**
+   * Monitor the calling thread. It must beat at least once per window.
+   *
+   * @param escalate: Exit the process instead of only demoting the thread.
+   */
+  heartbeat watch(char const* name, long window_us, bool escalate = false);
+
+  /** Stop monitoring a thread, e.g. before it ends. */
+  void unwatch(heartbeat&) noexcept;
+
+  /** Number of misses of all threads so far. */
+  long misses() const noexcept { return misses_.load(std::memory_order_relaxed); }
+
+private:
+  struct state {                // private to the watchdog thread
+    std::uint32_t generation = 0;
+    std::uint64_t beats = 0;
+    std::int64_t since_ns = 0;
+    bool stuck = false;
+  };
+
+  void supervise();
+  void check(details::watchdog_slot&, state&, std::int64_t now_ns);
+
+  long period_us_;
+  int cpu_;
+  int priority_;
+  std::atomic<bool> stopping_ {false};
+  std::atomic<long> misses_ {0};
+  std::atomic<int> used_ {0};   // slots below have been watched
+  details::watchdog_slot slots_[max_threads];
+  state states_[max_threads];
+};
+} // preempt
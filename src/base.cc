@@ -1,9 +1,66 @@
 #include <preempt/all.h>
 
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
 namespace base {
 std::mutex g_logging_mutex;
 std::atomic_bool g_verify_flag {true};
 
+namespace details {
+std::atomic<std::uint64_t> g_rcu_epoch {1}; // zero means "not reading"
+
+static rcu_reader g_rcu_readers[rcu_max_readers];
+static std::atomic<int> g_rcu_readers_used {0}; // high-water mark
+
+rcu_reader*
+rcu_register_reader() {
+  struct release {
+    ~release() {
+      if (rcu_reader* r = rcu_this_reader()) {
+        rcu_this_reader() = nullptr;
+        r->used.store(false, std::memory_order_release);
+      }
+    }
+  };
+  static thread_local release on_thread_exit;
+  (void) on_thread_exit;
+  for (int i = 0; i < rcu_max_readers; ++i) {
+    bool expected = false;
+    if (!g_rcu_readers[i].used.load(std::memory_order_relaxed)
+        && g_rcu_readers[i].used.compare_exchange_strong(expected, true)) {
+      int used = g_rcu_readers_used.load();
+      while (used < i + 1 && !g_rcu_readers_used.compare_exchange_weak(used, i + 1))
+        ;
+      return rcu_this_reader() = &g_rcu_readers[i];
+    }
+  }
+  base::quick_exit("base::read_guard: too many reader threads", __FILE__, __LINE__);
+}
+
+std::uint64_t
+rcu_advance_epoch() {
+  return g_rcu_epoch.fetch_add(1, std::memory_order_seq_cst) + 1;
+}
+
+std::uint64_t
+rcu_oldest_reader() {
+  std::uint64_t oldest = UINT64_MAX;
+  int const used = g_rcu_readers_used.load(std::memory_order_seq_cst);
+  for (int i = 0; i < used; ++i) {
+    std::uint64_t const epoch = g_rcu_readers[i].epoch.load(std::memory_order_seq_cst);
+    if (epoch && epoch < oldest)
+      oldest = epoch;
+  }
+  return oldest;
+}
+} // details
+
 std::pair<int, int>
 get_thread_policy_and_prioritiy(pthread_t h) {
   sched_param param;
@@ -41,6 +98,81 @@ get_current_thread_id() {
 #endif
 }
 
+constexpr std::size_t stack_options::default_guard;
+
+namespace {
+constexpr std::uint64_t stack_pattern = 0xa5a5a5a5a5a5a5a5ull;
+/* prepared by prepare_stack(), [low, high) */
+thread_local char* t_stack_low = nullptr;
+thread_local char* t_stack_high = nullptr;
+
+bool
+get_stack_bounds(char** low, char** high) {
+  ::pthread_attr_t attr;
+  if (pthread_getattr_np(pthread_self(), &attr))
+    return false;
+  void* addr;
+  std::size_t size;
+  int const errnum = pthread_attr_getstack(&attr, &addr, &size);
+  pthread_attr_destroy(&attr);
+  if (errnum)
+    return false;
+  *low = static_cast<char*>(addr);
+  *high = *low + size;
+  return true;
+}
+} // namespace
+
+int
+set_stack_attributes(::pthread_attr_t* attr, stack_options const& stack) noexcept {
+  if (stack.addr)
+    return pthread_attr_setstack(attr, stack.addr, stack.size);
+  if (stack.size)
+    if (int errnum = pthread_attr_setstacksize(attr, stack.size))
+      return errnum;
+  if (stack.guard != stack_options::default_guard)
+    if (int errnum = pthread_attr_setguardsize(attr, stack.guard))
+      return errnum;
+  return 0;
+}
+
+__attribute__((noinline))
+void
+prepare_stack(stack_options const& stack) noexcept {
+  if (!(stack.prefault || stack.lock || stack.watermark) || is_main_thread())
+    return;
+  char* low;
+  char* high;
+  if (!get_stack_bounds(&low, &high))
+    return;
+  if (stack.lock)
+    ::mlock(low, high - low);
+  /* Everything below this frame is unused. Stay clear of the callees of this
+     function: they only need a few bytes. */
+  char* const top = static_cast<char*>(__builtin_frame_address(0)) - 1024;
+  if (stack.watermark) {
+    for (auto p = reinterpret_cast<std::uint64_t volatile*>(low);
+         reinterpret_cast<char volatile*>(p + 1) <= top; ++p)
+      *p = stack_pattern;
+    t_stack_low = low;
+    t_stack_high = high;
+  } else if (stack.prefault) {
+    long const page = ::sysconf(_SC_PAGESIZE);
+    for (char volatile* p = low; p < top; p += page)
+      *p = 0;
+  }
+}
+
+std::size_t
+stack_high_water_mark() noexcept {
+  if (t_stack_low == nullptr)
+    return 0;
+  auto p = reinterpret_cast<std::uint64_t const*>(t_stack_low);
+  while (reinterpret_cast<char const*>(p) < t_stack_high && *p == stack_pattern)
+    ++p;
+  return t_stack_high - reinterpret_cast<char const*>(p);
+}
+
 bool
 running_under_VM() {
 #if RUNNING_UNDER_LINUX
@@ -79,6 +211,196 @@ have_realtime_kernel() {
   return not have_realtime_throttling();
 #endif /* RUNNING_UNDER_LINUX */
 }
+
+bool
+read_text_file(std::string const& path, std::string& contents) {
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd == -1)
+    return false;
+  char buf[4096];
+  ssize_t n;
+  contents.clear();
+  while ((n = ::read(fd, buf, sizeof buf)) > 0)
+    contents.append(buf, n);
+  int const errnum = errno;
+  ::close(fd);
+  if (n < 0) {
+    errno = errnum;
+    return false;
+  }
+  return true;
+}
+
+bool
+write_text_file(std::string const& path, std::string const& contents) {
+  int fd = ::open(path.c_str(), O_WRONLY | O_TRUNC | O_CLOEXEC);
+  if (fd == -1)
+    return false;
+  ssize_t n = ::write(fd, contents.data(), contents.size());
+  int const errnum = errno;
+  if (::close(fd) == -1 && n >= 0)
+    return false;
+  if (n < 0) {
+    errno = errnum;
+    return false;
+  }
+  return true;
+}
+
+bool
+parse_cpu_list(std::string const& list, std::vector<int>& cpus) {
+  cpus.clear();
+  char const* s = list.c_str();
+  while (*s && *s != '\n') {
+    char* end;
+    long lo = std::strtol(s, &end, 10), hi = lo;
+    if (end == s || lo < 0)
+      return false;
+    s = end;
+    if (*s == '-') {
+      ++s;
+      hi = std::strtol(s, &end, 10);
+      if (end == s || hi < lo)
+        return false;
+      s = end;
+    }
+    for (long cpu = lo; cpu <= hi; ++cpu)
+      cpus.push_back(int(cpu));
+    if (*s == ',')
+      ++s;
+    else if (*s && *s != '\n')
+      return false;
+  }
+  std::sort(cpus.begin(), cpus.end());
+  cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+  return true;
+}
+
+std::string
+format_cpu_list(std::vector<int> cpus) {
+  std::sort(cpus.begin(), cpus.end());
+  cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+  std::string result;
+  for (std::size_t i = 0; i < cpus.size(); ) {
+    std::size_t j = i;
+    while (j + 1 < cpus.size() && cpus[j + 1] == cpus[j] + 1)
+      ++j;
+    if (!result.empty())
+      result += ',';
+    result += std::to_string(cpus[i]);
+    if (j > i)
+      result += '-' + std::to_string(cpus[j]);
+    i = j + 1;
+  }
+  return result;
+}
+
+void
+xoshiro256ss::jump() {
+  static constexpr std::uint64_t polynomial[] = {
+    0x180ec6d33cfd0aba, 0xd5a61266f0c9392c, 0xa9582618e03fc9aa, 0x39abdc4529b1661c
+  };
+  std::uint64_t s[4] = {0, 0, 0, 0};
+  for (std::uint64_t word : polynomial) {
+    for (int b = 0; b < 64; ++b) {
+      if (word & (std::uint64_t(1) << b))
+        for (int i = 0; i < 4; ++i)
+          s[i] ^= s_[i];
+      (*this)();
+    }
+  }
+  std::copy(s, s + 4, s_);
+}
+
+xoshiro256ss_x4::xoshiro256ss_x4(std::uint64_t seed) {
+  xoshiro256ss lane {seed};
+  for (int k = 0; k < 4; ++k) {
+    for (int i = 0; i < 4; ++i)
+      s_[i][k] = lane.s_[i];
+    lane.jump();
+  }
+}
+
+void
+xoshiro256ss_x4::fill(std::uint64_t* out, std::size_t n) {
+#ifdef __SSE2__
+  __m128i s[4][2];
+  for (int i = 0; i < 4; ++i)
+    for (int h = 0; h < 2; ++h)
+      s[i][h] = _mm_load_si128(reinterpret_cast<__m128i const*>(&s_[i][2 * h]));
+  auto const rotl = [](__m128i x, int k) {
+    return _mm_or_si128(_mm_slli_epi64(x, k), _mm_srli_epi64(x, 64 - k));
+  };
+  auto const step = [&s, &rotl](int h) {
+    __m128i const s1 = s[1][h];
+    __m128i const x5 = _mm_add_epi64(_mm_slli_epi64(s1, 2), s1);        // * 5
+    __m128i const r = rotl(x5, 7);
+    __m128i const t = _mm_slli_epi64(s1, 17);
+    s[2][h] = _mm_xor_si128(s[2][h], s[0][h]);
+    s[3][h] = _mm_xor_si128(s[3][h], s1);
+    s[1][h] = _mm_xor_si128(s1, s[2][h]);
+    s[0][h] = _mm_xor_si128(s[0][h], s[3][h]);
+    s[2][h] = _mm_xor_si128(s[2][h], t);
+    s[3][h] = rotl(s[3][h], 45);
+    return _mm_add_epi64(_mm_slli_epi64(r, 3), r);                      // * 9
+  };
+  std::size_t i = 0;
+  for (; i + 4 <= n; i += 4) {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), step(0));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 2), step(1));
+  }
+  if (i < n) {
+    alignas(16) std::uint64_t result[4];
+    _mm_store_si128(reinterpret_cast<__m128i*>(result), step(0));
+    _mm_store_si128(reinterpret_cast<__m128i*>(result + 2), step(1));
+    std::copy(result, result + (n - i), out + i);
+  }
+  for (int i = 0; i < 4; ++i)
+    for (int h = 0; h < 2; ++h)
+      _mm_store_si128(reinterpret_cast<__m128i*>(&s_[i][2 * h]), s[i][h]);
+#else
+  for (std::size_t i = 0; i < n; i += 4) {
+    for (int k = 0; k < 4; ++k) {
+      std::uint64_t const result = details::rotl(s_[1][k] * 5, 7) * 9;
+      std::uint64_t const t = s_[1][k] << 17;
+      s_[2][k] ^= s_[0][k];
+      s_[3][k] ^= s_[1][k];
+      s_[1][k] ^= s_[2][k];
+      s_[0][k] ^= s_[3][k];
+      s_[2][k] ^= t;
+      s_[3][k] = details::rotl(s_[3][k], 45);
+      if (i + k < n)
+        out[i + k] = result;
+    }
+  }
+#endif
+}
+
+xoshiro256ss&
+thread_rng() {
+  static std::atomic<std::uint64_t> g_threads {0};
+  static thread_local xoshiro256ss rng {0x5eed0000 + g_threads++};
+  return rng;
+}
+
+void
+seed_thread_rng(std::uint64_t seed) {
+  thread_rng() = xoshiro256ss {seed};
+}
+
+char const*
+to_string(workload w) {
+  switch (w) {
+  case workload::random:     return "random";
+  case workload::sorted:     return "sorted";
+  case workload::reverse:    return "reverse";
+  case workload::organ_pipe: return "organ pipe";
+  case workload::sawtooth:   return "sawtooth";
+  case workload::few_unique: return "few unique";
+  case workload::all_equal:  return "all equal";
+  }
+  return "?";
+}
 } // base
 
 bool
@@ -0,0 +1,108 @@
+#include <preempt/all.h>
+
+#include <cerrno>
+#include <cstring>
+#include <mutex>
+
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace preempt {
+namespace {
+/* budget armed on the calling thread */
+thread_local cpu_budget* t_budget = nullptr;
+
+bool
+install_handler(void (*handler)(int, siginfo_t*, void*), std::string& error) {
+  static std::once_flag once;
+  static int errnum = 0;
+  std::call_once(once, [handler] {
+    struct sigaction sa;
+    std::memset(&sa, 0, sizeof sa);
+    sa.sa_sigaction = handler;
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigemptyset(&sa.sa_mask);
+    if (::sigaction(cpu_budget::signal(), &sa, nullptr))
+      errnum = errno;
+  });
+  if (errnum)
+    error = base::sprintf("FAILED: sigaction(): '%s'", std::strerror(errnum));
+  return errnum == 0;
+}
+} // namespace
+
+bool
+cpu_budget::arm(long us, overrun_action action) {
+  disarm();
+  error_.clear();
+  action_ = action;
+  expired_ = false;
+  if (action == overrun_action::none)
+    return true;
+  if (!install_handler(&cpu_budget::on_expiry, error_))
+    return false;
+  ::clockid_t clock;
+  if (int errnum = pthread_getcpuclockid(pthread_self(), &clock)) {
+    error_ = base::sprintf("FAILED: pthread_getcpuclockid(): '%s'", std::strerror(errnum));
+    return false;
+  }
+  ::sigevent sev;
+  std::memset(&sev, 0, sizeof sev);
+  sev.sigev_notify = SIGEV_THREAD_ID;
+  sev.sigev_signo = signal();
+  sev.sigev_value.sival_ptr = this;
+  sev._sigev_un._tid = ::syscall(SYS_gettid);
+  if (::timer_create(clock, &sev, &timer_)) {
+    error_ = base::sprintf("FAILED: timer_create(): '%s'", std::strerror(errno));
+    return false;
+  }
+  ::itimerspec its {};
+  its.it_value.tv_sec = us / 1000000;
+  its.it_value.tv_nsec = us % 1000000 * 1000;
+  if (::timer_settime(timer_, 0, &its, nullptr)) {
+    error_ = base::sprintf("FAILED: timer_settime(): '%s'", std::strerror(errno));
+    ::timer_delete(timer_);
+    return false;
+  }
+  armed_ = true;
+  t_budget = this;
+  return true;
+}
+
+void
+cpu_budget::disarm() noexcept {
+  if (!armed_)
+    return;
+  ::timer_delete(timer_);       // also discards a pending expiry signal
+  armed_ = false;
+  if (t_budget == this)
+    t_budget = nullptr;
+}
+
+void
+cpu_budget::cancellation_point() {
+  cpu_budget const* b = t_budget;
+  if (b && b->action_ == overrun_action::cancel && b->expired())
+    throw budget_exceeded {};
+}
+
+int
+cpu_budget::signal() noexcept {
+  return SIGRTMIN + 1;
+}
+
+void
+cpu_budget::on_expiry(int, siginfo_t* info, void*) {
+  auto* b = static_cast<cpu_budget*>(info->si_value.sival_ptr);
+  if (b == nullptr || info->si_code != SI_TIMER)
+    return;
+  b->expired_.store(true, std::memory_order_relaxed);
+  if (b->action_ == overrun_action::demote || b->action_ == overrun_action::cancel) {
+    int const saved = errno;
+    ::sched_param const param {0};
+    ::sched_setscheduler(0, SCHED_OTHER, &param);   // 0: the calling thread
+    errno = saved;
+  }
+}
+} // preempt
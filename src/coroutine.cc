@@ -0,0 +1,155 @@
+#include <preempt/all.h>
+
+#ifdef PREEMPT_HAS_COROUTINES
+
+#include <algorithm>
+
+namespace preempt {
+namespace {
+struct later {
+  template <typename Timer>
+  bool operator () (Timer const& a, Timer const& b) const noexcept { return a.when > b.when; }
+};
+
+base::nsec_t
+to_nsec(coroutine_scheduler::clock::time_point t) {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(t.time_since_epoch()).count();
+}
+} // namespace
+
+frame_pool::frame_pool(std::size_t block_size, std::size_t blocks)
+  : block_size_ {(block_size + alignof(std::max_align_t) - 1) / alignof(std::max_align_t)
+                 * alignof(std::max_align_t)},
+    blocks_ {blocks},
+    memory_ {new unsigned char[block_size_ * blocks]} {
+  for (std::size_t i = blocks; i-- > 0; )
+    free_ = new (memory_.get() + i * block_size_) node {free_};
+}
+
+void*
+frame_pool::allocate(std::size_t size) noexcept {
+  largest_ = std::max(largest_, size);
+  if (size > block_size_ || free_ == nullptr)
+    return nullptr;
+  node* n = free_;
+  free_ = n->next;
+  ++in_use_;
+  return n;
+}
+
+void
+frame_pool::deallocate(void* p) noexcept {
+  free_ = new (p) node {free_};
+  --in_use_;
+}
+
+coroutine_scheduler::coroutine_scheduler(long tick_us, std::size_t max_tasks,
+                                         std::size_t frame_size)
+  : pool_ {frame_size + alignof(std::max_align_t), max_tasks},
+    tick_ {std::chrono::microseconds {tick_us}},
+    tasks_(max_tasks),
+    ready_(max_tasks) {
+  tick_waiters_.reserve(max_tasks);
+  timers_.reserve(max_tasks);
+}
+
+coroutine_scheduler::~coroutine_scheduler() {
+  stop();
+  for (auto& h : tasks_)
+    if (h)
+      h.destroy();
+}
+
+bool
+coroutine_scheduler::spawn(co_task&& task) {
+  if (!task)
+    return false;
+  auto const free = std::find(tasks_.begin(), tasks_.end(), handle_type {});
+  if (free == tasks_.end())
+    return false;
+  handle_type const h = std::exchange(task.handle_, nullptr);
+  *free = h;
+  h.promise().slot = free - tasks_.begin();
+  ++live_;
+  ready(h);
+  return true;
+}
+
+void
+coroutine_scheduler::start(int priority, base::stack_options const& stack) {
+  stop();
+  stopping_ = false;
+  mono_task<>::spawn(priority > 0 ? SCHED_FIFO : SCHED_OTHER, priority, stack,
+                     &coroutine_scheduler::run, this);
+}
+
+void
+coroutine_scheduler::stop() {
+  stopping_ = true;
+  join();
+}
+
+void
+coroutine_scheduler::run() {
+  clock::time_point next_tick = clock::now() + tick_;
+  while (live_ > 0 && !stopping_.load(std::memory_order_relaxed)) {
+    for (std::size_t n = ready_size_; n > 0 && ready_size_ > 0; --n) {
+      handle_type const h = ready_[ready_head_];
+      ready_head_ = (ready_head_ + 1) % ready_.size();
+      --ready_size_;
+      resume(h);
+    }
+    if (live_ == 0)
+      break;
+    if (ready_size_ == 0) {
+      clock::time_point wake = next_tick;
+      if (!timers_.empty() && timers_.front().when < wake)
+        wake = timers_.front().when;
+      base::sleep_until(to_nsec(wake));
+    }
+    clock::time_point const now = clock::now();
+    if (now >= next_tick) {
+      ++ticks_;
+      while (next_tick <= now)
+        next_tick += tick_;     // skip ticks that were missed
+      for (auto h : tick_waiters_)
+        ready(h);
+      tick_waiters_.clear();
+    }
+    while (!timers_.empty() && timers_.front().when <= now) {
+      std::pop_heap(timers_.begin(), timers_.end(), later {});
+      ready(timers_.back().handle);
+      timers_.pop_back();
+    }
+  }
+}
+
+void
+coroutine_scheduler::ready(handle_type h) noexcept {
+  ready_[(ready_head_ + ready_size_) % ready_.size()] = h;
+  ++ready_size_;
+}
+
+void
+coroutine_scheduler::wait_tick(handle_type h) noexcept {
+  tick_waiters_.push_back(h);   // within the capacity reserved
+}
+
+void
+coroutine_scheduler::wait_until(handle_type h, clock::time_point when) noexcept {
+  timers_.push_back(timer {when, h});
+  std::push_heap(timers_.begin(), timers_.end(), later {});
+}
+
+void
+coroutine_scheduler::resume(handle_type h) {
+  h.resume();
+  if (h.done()) {
+    tasks_[h.promise().slot] = nullptr;
+    h.destroy();
+    --live_;
+  }
+}
+} // preempt
+
+#endif // PREEMPT_HAS_COROUTINES
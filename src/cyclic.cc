@@ -0,0 +1,28 @@
+#include <preempt/all.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <ostream>
+
+namespace preempt {
+namespace details {
+void
+report_frames(std::ostream& os, std::size_t frames, std::uint64_t const* tasks,
+              long const* load_us, long minor_us, base::nsec_t const* min_slack_ns,
+              long const* overruns) {
+  for (std::size_t f = 0; f < frames; ++f) {
+    char ids[64 * 3 + 1] = "";
+    int used = 0;
+    for (int i = 0; i < 64 && used < int(sizeof ids) - 4; ++i)
+      if (tasks[f] & (std::uint64_t(1) << i))
+        used += std::snprintf(ids + used, sizeof ids - used, "%d ", i);
+    char line[sizeof ids + 128];
+    std::snprintf(line, sizeof line,
+                  "frame %4zu: tasks %-12s load %5ld/%ldus  min slack %6lldus  overruns %ld\n",
+                  f, ids, load_us[f], minor_us, static_cast<long long>(min_slack_ns[f] / 1000),
+                  overruns[f]);
+    os << line;
+  }
+}
+} // details
+} // preempt
@@ -0,0 +1,134 @@
+#include <preempt/all.h>
+
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace preempt {
+namespace {
+template <class T>
+void
+raise_to(std::atomic<T>& max, T value) noexcept {
+  T current = max.load(std::memory_order_relaxed);
+  while (value > current
+         && !max.compare_exchange_weak(current, value, std::memory_order_relaxed)) {
+  }
+}
+} // namespace
+
+deferred_executor::deferred_executor(std::size_t capacity, int workers) {
+  std::size_t size = 2;
+  while (size < capacity)
+    size *= 2;
+  mask_ = size - 1;
+  void* memory = nullptr;
+  if (::posix_memalign(&memory, alignof(details::deferred_cell),
+                       size * sizeof(details::deferred_cell)))
+    throw std::bad_alloc {};
+  cells_ = static_cast<details::deferred_cell*>(memory);
+  for (std::size_t i = 0; i < size; ++i)
+    new (&cells_[i]) details::deferred_cell {{i}};
+  for (int i = 0; i < workers; ++i)
+    spawn(&deferred_executor::work, this);
+}
+
+deferred_executor::~deferred_executor() {
+  stopping_ = true;
+  futex_.fetch_add(1, std::memory_order_release);
+  ::syscall(SYS_futex, &futex_, FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+  join();
+  run_pending();
+  std::free(cells_);            // cells are trivially destructible
+}
+
+std::size_t
+deferred_executor::run_pending() {
+  std::size_t n = 0;
+  while (pop_and_run())
+    ++n;
+  return n;
+}
+
+void
+deferred_executor::drain() {
+  long const target = posted_.load();
+  while (executed_.load() < target)
+    std::this_thread::sleep_for(std::chrono::microseconds {100});
+}
+
+deferred_stats
+deferred_executor::stats() const noexcept {
+  deferred_stats s;
+  std::size_t const out = dequeue_.load(std::memory_order_relaxed);
+  std::size_t const in = enqueue_.load(std::memory_order_relaxed);
+  s.depth = in > out ? in - out : 0;
+  s.max_depth = max_depth_.load(std::memory_order_relaxed);
+  s.posted = posted_.load(std::memory_order_relaxed);
+  s.executed = executed_.load(std::memory_order_relaxed);
+  s.dropped = dropped_.load(std::memory_order_relaxed);
+  s.max_post_ns = max_post_ns_.load(std::memory_order_relaxed);
+  return s;
+}
+
+bool
+deferred_executor::pop_and_run() {
+  std::size_t position = dequeue_.load(std::memory_order_relaxed);
+  details::deferred_cell* cell;
+  for (;;) {
+    cell = &cells_[position & mask_];
+    std::size_t const sequence = cell->sequence.load(std::memory_order_acquire);
+    auto const diff = static_cast<std::ptrdiff_t>(sequence - (position + 1));
+    if (diff == 0) {
+      if (dequeue_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+        break;
+    } else if (diff < 0) {
+      return false;             // empty
+    } else {
+      position = dequeue_.load(std::memory_order_relaxed);
+    }
+  }
+  cell->call(cell->storage);
+  cell->sequence.store(position + mask_ + 1, std::memory_order_release);
+  executed_.fetch_add(1, std::memory_order_release);
+  return true;
+}
+
+void
+deferred_executor::work() {
+  while (!stopping_.load(std::memory_order_relaxed)) {
+    std::uint32_t const seq = futex_.load(std::memory_order_acquire);
+    if (pop_and_run())
+      continue;
+    sleepers_.fetch_add(1, std::memory_order_seq_cst);
+    if (!stopping_.load() && futex_.load(std::memory_order_seq_cst) == seq) {
+      ::timespec ts {0, 100000000};       // recheck every 100ms
+      ::syscall(SYS_futex, &futex_, FUTEX_WAIT, seq, &ts, nullptr, 0);
+    }
+    sleepers_.fetch_sub(1, std::memory_order_relaxed);
+  }
+}
+
+void
+deferred_executor::posted(std::size_t position, std::chrono::steady_clock::time_point start)
+  noexcept {
+  futex_.fetch_add(1, std::memory_order_seq_cst);
+  if (sleepers_.load(std::memory_order_seq_cst) > 0)
+    ::syscall(SYS_futex, &futex_, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+  posted_.fetch_add(1, std::memory_order_relaxed);
+  std::size_t const out = dequeue_.load(std::memory_order_relaxed);
+  if (position + 1 > out)
+    raise_to(max_depth_, position + 1 - out);
+  long const ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now() - start).count();
+  raise_to(max_post_ns_, ns);
+}
+
+void
+deferred_executor::dropped() noexcept {
+  dropped_.fetch_add(1, std::memory_order_relaxed);
+}
+} // preempt
@@ -0,0 +1,162 @@
+#include <preempt/all.h>
+
+#include <algorithm>
+#include <limits>
+
+namespace preempt {
+namespace {
+struct later {
+  template <typename Entry>
+  bool operator () (Entry const& a, Entry const& b) const noexcept {
+    return a.deadline > b.deadline || (a.deadline == b.deadline && a.sequence > b.sequence);
+  }
+};
+
+using time_point = edf_dispatcher::clock::time_point;
+
+/* worker and deadline of the job running on the calling thread */
+thread_local void* t_worker = nullptr;
+thread_local time_point t_deadline = time_point::max();
+} // namespace
+
+edf_dispatcher::edf_dispatcher(std::vector<int> const& cpus, int priority,
+                               base::stack_options const& stack, std::size_t capacity) {
+  for (int cpu : cpus) {
+    workers_.emplace_back(new worker);
+    workers_.back()->cpu = cpu;
+    workers_.back()->heap.reserve(capacity);
+  }
+  int const policy = priority > 0 ? SCHED_FIFO : SCHED_OTHER;
+  for (std::size_t i = 0; i < workers_.size(); ++i)
+    spawn(policy, priority, stack, &edf_dispatcher::work, this, i);
+}
+
+edf_dispatcher::~edf_dispatcher() {
+  join();
+}
+
+void
+edf_dispatcher::submit(std::size_t index, clock::time_point deadline, job call) {
+  worker& w = *workers_.at(index);
+  {
+    std::lock_guard<std::mutex> lock {w.mutex};
+    w.heap.push_back(entry {deadline, w.sequence++, std::move(call)});
+    std::push_heap(w.heap.begin(), w.heap.end(), later {});
+    w.queued.store(w.heap.size(), std::memory_order_relaxed);
+  }
+  w.wakeup.notify_all();
+}
+
+void
+edf_dispatcher::submit(clock::time_point deadline, job call) {
+  std::size_t best = 0;
+  std::size_t fewest = std::numeric_limits<std::size_t>::max();
+  for (std::size_t i = 0; i < workers_.size(); ++i) {
+    std::size_t const n = workers_[i]->queued.load(std::memory_order_relaxed);
+    if (n < fewest) {
+      best = i;
+      fewest = n;
+    }
+  }
+  submit(best, deadline, std::move(call));
+}
+
+void
+edf_dispatcher::submit(std::chrono::nanoseconds relative, job call) {
+  submit(clock::now() + relative, std::move(call));
+}
+
+int
+edf_dispatcher::yield() {
+  if (t_worker == nullptr)
+    return 0;
+  worker& w = *static_cast<worker*>(t_worker);
+  int n = 0;
+  std::unique_lock<std::mutex> lock {w.mutex};
+  while (!w.heap.empty() && w.heap.front().deadline < t_deadline) {
+    run_next(w, lock, true);
+    ++n;
+  }
+  return n;
+}
+
+edf_dispatcher::clock::time_point
+edf_dispatcher::current_deadline() noexcept {
+  return t_deadline;
+}
+
+void
+edf_dispatcher::wait_idle() {
+  for (auto& w : workers_) {
+    std::unique_lock<std::mutex> lock {w->mutex};
+    w->wakeup.wait(lock, [&w] { return w->heap.empty() && w->busy == 0; });
+  }
+}
+
+edf_stats
+edf_dispatcher::stats(std::size_t index) const {
+  worker const& w = *workers_.at(index);
+  std::lock_guard<std::mutex> lock {w.mutex};
+  return w.stats;
+}
+
+void
+edf_dispatcher::join() {
+  if (!joinable())
+    return;                     // joined before, e.g. explicitly and then by the destructor
+  for (auto& w : workers_) {
+    {
+      std::lock_guard<std::mutex> lock {w->mutex};
+      w->stopping = true;
+    }
+    w->wakeup.notify_all();
+  }
+  poly_task<>::join();
+}
+
+void
+edf_dispatcher::work(std::size_t index) {
+  worker& w = *workers_[index];
+  if (w.cpu >= 0 && !run_on_cpu(w.cpu))
+    base::quick_exit(base::sprintf("edf_dispatcher error: run_on_cpu(%d)", w.cpu).c_str());
+  t_worker = &w;
+  std::unique_lock<std::mutex> lock {w.mutex};
+  for (;;) {
+    w.wakeup.wait(lock, [&w] { return !w.heap.empty() || w.stopping; });
+    if (w.heap.empty())
+      break;                    // stopping
+    run_next(w, lock, false);
+    if (w.heap.empty())
+      w.wakeup.notify_all();    // wait_idle()
+  }
+  t_worker = nullptr;
+}
+
+void
+edf_dispatcher::run_next(worker& w, std::unique_lock<std::mutex>& lock, bool preempting) {
+  std::pop_heap(w.heap.begin(), w.heap.end(), later {});
+  entry e = std::move(w.heap.back());
+  w.heap.pop_back();
+  w.queued.store(w.heap.size(), std::memory_order_relaxed);
+  ++w.busy;
+  clock::time_point const outer = t_deadline;
+  t_deadline = e.deadline;
+  lock.unlock();
+  e.call();
+  clock::time_point const finish = clock::now();
+  e.call = nullptr;             // destroy captures outside of the lock
+  lock.lock();
+  t_deadline = outer;
+  --w.busy;
+  long const lateness = std::chrono::duration_cast<std::chrono::nanoseconds>(
+    finish - e.deadline).count();
+  edf_stats& s = w.stats;
+  if (s.jobs == 0 || lateness > s.max_lateness_ns)
+    s.max_lateness_ns = lateness;
+  ++s.jobs;
+  if (lateness > 0)
+    ++s.late;
+  if (preempting)
+    ++s.preemptions;
+}
+} // preempt
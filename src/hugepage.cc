@@ -0,0 +1,186 @@
+#include <preempt/all.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace preempt {
+namespace {
+long
+meminfo(char const* key) {
+  std::string contents;
+  if (!base::read_text_file("/proc/meminfo", contents))
+    return -1;
+  auto const pos = contents.find(key);
+  if (pos == std::string::npos)
+    return -1;
+  return std::strtol(contents.c_str() + pos + std::strlen(key), nullptr, 10);
+}
+
+/** Write every base page so that the kernel populates the whole mapping. */
+void
+populate(void* data, std::size_t size) {
+  long const page = ::sysconf(_SC_PAGESIZE);
+  char* const end = static_cast<char*>(data) + size;
+  for (char volatile* p = static_cast<char*>(data); p < end; p += page)
+    *p = 0;
+}
+} // namespace
+
+std::size_t
+huge_page_size() {
+  static std::size_t const size = [] {
+    long const kib = meminfo("Hugepagesize:");
+    return kib > 0 ? std::size_t(kib) * 1024 : std::size_t(2) << 20;
+  }();
+  return size;
+}
+
+long
+free_huge_pages() {
+  return meminfo("HugePages_Free:");
+}
+
+bool
+reserve_huge_pages(long count) {
+  std::string current;
+  if (!base::read_text_file("/proc/sys/vm/nr_hugepages", current))
+    return false;
+  if (std::strtol(current.c_str(), nullptr, 10) >= count)
+    return true;
+  return base::write_text_file("/proc/sys/vm/nr_hugepages", std::to_string(count));
+}
+
+huge_region::huge_region(std::size_t size, bool lock, int node) {
+  std::size_t const huge = huge_page_size();
+  size_ = (size + huge - 1) / huge * huge;
+  if (size_ == 0)
+    size_ = huge;
+
+#ifdef MAP_HUGETLB
+  /* the pool is reserved at mmap() time: either all pages or ENOMEM */
+  void* p = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE,
+                   MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+  if (p != MAP_FAILED) {
+    data_ = p;
+    kind_ = backing::hugetlb;
+  }
+#endif // MAP_HUGETLB
+
+  if (data_ == nullptr) {
+    /* over-allocate, then trim to a huge page boundary */
+    void* q = ::mmap(nullptr, size_ + huge, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (q == MAP_FAILED) {
+      error_ = base::sprintf("FAILED: mmap(%zu): '%s'", size_ + huge, std::strerror(errno));
+      size_ = 0;
+      return;
+    }
+    std::uintptr_t const begin = reinterpret_cast<std::uintptr_t>(q);
+    std::uintptr_t const aligned = (begin + huge - 1) & ~std::uintptr_t(huge - 1);
+    if (aligned > begin)
+      ::munmap(q, aligned - begin);
+    if (begin + huge > aligned)
+      ::munmap(reinterpret_cast<void*>(aligned + size_), begin + huge - aligned);
+    data_ = reinterpret_cast<void*>(aligned);
+    kind_ = backing::normal;
+#ifdef MADV_HUGEPAGE
+    if (::madvise(data_, size_, MADV_HUGEPAGE) == 0)
+      kind_ = backing::transparent;
+#endif // MADV_HUGEPAGE
+  }
+
+  /* before the first page is allocated */
+  if (node >= 0 && !bind_memory(data_, size_, node))
+    error_ = base::sprintf("FAILED: mbind(%d): '%s'", node, std::strerror(errno));
+
+  if (lock) {
+    if (::mlock(data_, size_) == 0)
+      locked_ = true;
+    else
+      error_ = base::sprintf("FAILED: mlock(%zu): '%s'", size_, std::strerror(errno));
+  }
+  if (!locked_)
+    populate(data_, size_);
+}
+
+huge_region::~huge_region() {
+  if (data_)
+    ::munmap(data_, size_);
+}
+
+huge_region::huge_region(huge_region&& other) noexcept
+  : data_ {other.data_}, size_ {other.size_}, kind_ {other.kind_}, locked_ {other.locked_},
+    error_ {std::move(other.error_)} {
+  other.data_ = nullptr;
+  other.size_ = 0;
+  other.kind_ = backing::none;
+  other.locked_ = false;
+}
+
+huge_region&
+huge_region::operator = (huge_region&& other) noexcept {
+  if (this != &other) {
+    if (data_)
+      ::munmap(data_, size_);
+    data_ = other.data_;
+    size_ = other.size_;
+    kind_ = other.kind_;
+    locked_ = other.locked_;
+    error_ = std::move(other.error_);
+    other.data_ = nullptr;
+    other.size_ = 0;
+    other.kind_ = backing::none;
+    other.locked_ = false;
+  }
+  return *this;
+}
+
+std::size_t
+huge_region::huge_pages() const {
+  switch (kind_) {
+  case backing::none:
+  case backing::normal:
+    return 0;
+  case backing::hugetlb:
+    return size_ / huge_page_size();
+  case backing::transparent:
+    break;
+  }
+  /* the mapping may have been merged with a neighbour: sum up all lines of
+     smaps that lie within the region */
+  std::FILE* smaps = std::fopen("/proc/self/smaps", "r");
+  if (smaps == nullptr)
+    return 0;
+  std::uintptr_t const first = reinterpret_cast<std::uintptr_t>(data_);
+  std::uintptr_t const last = first + size_;
+  std::uintptr_t begin = 0, end = 0;
+  bool inside = false;
+  long kib = 0;
+  char line[4096];              // PATH_MAX
+  while (std::fgets(line, sizeof line, smaps)) {
+    long value;
+    if (std::sscanf(line, "%" SCNxPTR "-%" SCNxPTR, &begin, &end) == 2)
+      inside = begin < last && end > first;
+    else if (inside && std::sscanf(line, "AnonHugePages: %ld kB", &value) == 1)
+      kib += value;
+  }
+  std::fclose(smaps);
+  return std::min(std::size_t(kib) * 1024, size_) / huge_page_size();
+}
+
+huge_arena::huge_arena(std::size_t size, bool lock, int node)
+  : region_ {size, lock, node} { }
+
+base::stack_options
+huge_region::stack() const noexcept {
+  base::stack_options stack;
+  stack.addr = data_;
+  stack.size = size_;
+  return stack;
+}
+} // preempt
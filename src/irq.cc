@@ -0,0 +1,120 @@
+#include <preempt/all.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+
+#include <dirent.h>
+
+namespace preempt {
+irq_steering::irq_steering(std::string procfs_root)
+  : root_ {std::move(procfs_root)} {
+  for (int cpu = 0; cpu < base::get_number_of_processors(); ++cpu)
+    housekeeping_.push_back(cpu);
+}
+
+std::string
+irq_steering::path(int irq) const {
+  return root_ + "/irq/" + std::to_string(irq) + "/smp_affinity_list";
+}
+
+std::vector<int>
+irq_steering::irqs() const {
+  std::vector<int> result;
+  if (DIR* dir = ::opendir((root_ + "/irq").c_str())) {
+    while (struct ::dirent* entry = ::readdir(dir)) {
+      char* end;
+      long irq = std::strtol(entry->d_name, &end, 10);
+      if (end == entry->d_name || *end != '\0')
+        continue;               // default_smp_affinity, ".", ".."
+      if (::access(path(int(irq)).c_str(), F_OK) == 0)
+        result.push_back(int(irq));
+    }
+    ::closedir(dir);
+  }
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+bool
+irq_steering::get_affinity(int irq, std::vector<int>& cpus) const {
+  std::string list;
+  if (!base::read_text_file(path(irq), list))
+    return false;
+  if (!base::parse_cpu_list(list, cpus)) {
+    errno = EINVAL;
+    return false;
+  }
+  return true;
+}
+
+bool
+irq_steering::set_affinity(int irq, std::vector<int> const& cpus) const {
+  return base::write_text_file(path(irq), base::format_cpu_list(cpus) + '\n');
+}
+
+void
+irq_steering::set_housekeeping_cpus(std::vector<int> cpus) {
+  housekeeping_ = std::move(cpus);
+}
+
+bool
+irq_steering::steer_away(std::vector<int> const& rt_cpus) {
+  auto is_rt = [&rt_cpus](int cpu) {
+    return std::find(rt_cpus.begin(), rt_cpus.end(), cpu) != rt_cpus.end();
+  };
+  failures_.clear();
+  for (int irq : irqs()) {
+    std::vector<int> current;
+    if (!get_affinity(irq, current)) {
+      failures_.push_back({irq, errno});
+      continue;
+    }
+    std::vector<int> wanted {current};
+    wanted.erase(std::remove_if(wanted.begin(), wanted.end(), is_rt), wanted.end());
+    if (wanted.size() == current.size())
+      continue;                 // does not hit a real-time CPU
+    if (wanted.empty()) {
+      wanted = housekeeping_;
+      wanted.erase(std::remove_if(wanted.begin(), wanted.end(), is_rt), wanted.end());
+      if (wanted.empty()) {
+        failures_.push_back({irq, EINVAL});
+        continue;
+      }
+    }
+    if (!set_affinity(irq, wanted)) {
+      failures_.push_back({irq, errno});
+      continue;
+    }
+    auto saved = std::find_if(saved_.begin(), saved_.end(),
+                              [irq](affinity const& a) { return a.irq == irq; });
+    if (saved == saved_.end())
+      saved_.push_back({irq, base::format_cpu_list(current)});
+  }
+  return failures_.empty();
+}
+
+bool
+irq_steering::restore() {
+  failures_.clear();
+  std::vector<affinity> remaining;
+  for (auto i = saved_.rbegin(); i != saved_.rend(); ++i) {
+    if (!base::write_text_file(path(i->irq), i->cpus + '\n')) {
+      failures_.push_back({i->irq, errno});
+      remaining.insert(remaining.begin(), *i);
+    }
+  }
+  saved_.swap(remaining);
+  return failures_.empty();
+}
+
+std::vector<irq_steering::failure> const&
+irq_steering::failures() const {
+  return failures_;
+}
+
+std::vector<irq_steering::affinity> const&
+irq_steering::saved() const {
+  return saved_;
+}
+} // preempt
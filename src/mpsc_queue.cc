@@ -0,0 +1,29 @@
+#include <preempt/all.h>
+
+namespace preempt {
+mpsc_hook*
+intrusive_mpsc::pop() noexcept {
+  mpsc_hook* tail = tail_;
+  mpsc_hook* next = tail->next.load(std::memory_order_acquire);
+  if (tail == &stub_) {
+    if (!next)
+      return nullptr;
+    tail_ = tail = next;
+    next = next->next.load(std::memory_order_acquire);
+  }
+  if (next) {
+    tail_ = next;
+    return tail;
+  }
+  if (tail != head_.load(std::memory_order_acquire))
+    return nullptr;             // a producer has not linked its node yet
+  /* tail is the last node: queue the stub behind it to take it out */
+  push(stub_);
+  next = tail->next.load(std::memory_order_acquire);
+  if (next) {
+    tail_ = next;
+    return tail;
+  }
+  return nullptr;
+}
+} // preempt
@@ -0,0 +1,207 @@
+#include <preempt/all.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <mutex>
+#include <ostream>
+
+namespace preempt {
+namespace {
+/* <numaif.h> belongs to libnuma, which we do not require */
+constexpr int mpol_default = 0;
+constexpr int mpol_preferred = 1;
+constexpr int mpol_bind = 2;
+constexpr unsigned mpol_mf_move = 1 << 1;
+constexpr int max_nodes = 1024;
+
+struct node_mask {
+  unsigned long bits[max_nodes / (8 * sizeof(unsigned long))] {};
+
+  explicit node_mask(int node) {
+    bits[node / (8 * sizeof(unsigned long))] = 1ul << (node % (8 * sizeof(unsigned long)));
+  }
+};
+
+void
+page_range(void const* addr, std::size_t size, std::uintptr_t* first, std::size_t* length) {
+  std::uintptr_t const page = ::sysconf(_SC_PAGESIZE);
+  std::uintptr_t const a = reinterpret_cast<std::uintptr_t>(addr);
+  *first = a & ~(page - 1);
+  *length = ((a + size + page - 1) & ~(page - 1)) - *first;
+}
+
+bool
+valid_node(int node) {
+  auto const& nodes = system_numa_topology().nodes();
+  return std::find(nodes.begin(), nodes.end(), node) != nodes.end();
+}
+
+struct numa_region {
+  std::string name;
+  void const* addr;
+  std::size_t size;
+  int node;
+};
+
+std::mutex g_numa_regions_mutex;
+std::vector<numa_region> g_numa_regions;
+} // namespace
+
+numa_topology::numa_topology(std::string sysfs_root) {
+  std::string const dir = sysfs_root + "/devices/system/node";
+  std::string list;
+  if (base::read_text_file(dir + "/online", list))
+    base::parse_cpu_list(list, nodes_);
+  for (int node : nodes_) {
+    if (node >= max_nodes)
+      break;
+    if (cpus_.size() <= std::size_t(node))
+      cpus_.resize(node + 1);
+    if (base::read_text_file(dir + "/node" + std::to_string(node) + "/cpulist", list))
+      base::parse_cpu_list(list, cpus_[node]);
+  }
+  if (nodes_.empty()) {
+    nodes_.push_back(0);
+    cpus_.resize(1);
+    for (int cpu = 0; cpu < base::get_number_of_processors(); ++cpu)
+      cpus_[0].push_back(cpu);
+  }
+}
+
+int
+numa_topology::node_of_cpu(int cpu) const {
+  for (int node : nodes_)
+    if (std::size_t(node) < cpus_.size()
+        && std::binary_search(cpus_[node].begin(), cpus_[node].end(), cpu))
+      return node;
+  return -1;
+}
+
+std::vector<int>
+numa_topology::cpus_of_node(int node) const {
+  if (node < 0 || std::size_t(node) >= cpus_.size())
+    return {};
+  return cpus_[node];
+}
+
+numa_topology const&
+system_numa_topology() {
+  static numa_topology const topology;
+  return topology;
+}
+
+int
+current_numa_node() {
+  int const cpu = ::sched_getcpu();
+  return cpu < 0 ? -1 : system_numa_topology().node_of_cpu(cpu);
+}
+
+bool
+bind_memory(void const* addr, std::size_t size, int node) {
+  if (!valid_node(node)) {
+    errno = EINVAL;
+    return false;
+  }
+  if (size == 0 || system_numa_topology().single_node())
+    return true;
+  std::uintptr_t first;
+  std::size_t length;
+  page_range(addr, size, &first, &length);
+  node_mask const mask {node};
+  return ::syscall(SYS_mbind, first, length, mpol_bind, mask.bits, max_nodes, mpol_mf_move) == 0;
+}
+
+bool
+prefer_memory_node(int node) {
+  if (node >= 0 && !valid_node(node)) {
+    errno = EINVAL;
+    return false;
+  }
+  if (system_numa_topology().single_node())
+    return true;
+  if (node < 0)
+    return ::syscall(SYS_set_mempolicy, mpol_default, nullptr, 0) == 0;
+  node_mask const mask {node};
+  return ::syscall(SYS_set_mempolicy, mpol_preferred, mask.bits, max_nodes) == 0;
+}
+
+bool
+run_on_cpu(int cpu) {
+  int const node = system_numa_topology().node_of_cpu(cpu);
+  if (node < 0 || cpu >= CPU_SETSIZE) {
+    errno = EINVAL;
+    return false;
+  }
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(cpu, &set);
+  if (int errnum = pthread_setaffinity_np(pthread_self(), sizeof set, &set)) {
+    errno = errnum;
+    return false;
+  }
+  if (system_numa_topology().single_node())
+    return true;
+  if (!prefer_memory_node(node))
+    return false;
+  ::pthread_attr_t attr;
+  if (pthread_getattr_np(pthread_self(), &attr))
+    return false;
+  void* stack;
+  std::size_t size;
+  int const errnum = pthread_attr_getstack(&attr, &stack, &size);
+  pthread_attr_destroy(&attr);
+  /* the main thread's stack grows on demand and has no fixed mapping */
+  return errnum == 0 && (base::is_main_thread() || bind_memory(stack, size, node));
+}
+
+long
+remote_pages(void const* addr, std::size_t size, int node) {
+  if (size == 0 || system_numa_topology().single_node())
+    return 0;
+  std::uintptr_t first;
+  std::size_t length;
+  page_range(addr, size, &first, &length);
+  std::size_t const page = ::sysconf(_SC_PAGESIZE);
+  long remote = 0;
+  constexpr std::size_t batch = 512;
+  void* pages[batch];
+  int status[batch];
+  for (std::size_t offset = 0; offset < length; offset += batch * page) {
+    std::size_t const n = std::min(batch, (length - offset) / page);
+    for (std::size_t i = 0; i < n; ++i)
+      pages[i] = reinterpret_cast<void*>(first + offset + i * page);
+    /* without target nodes move_pages() only reports where pages are */
+    if (::syscall(SYS_move_pages, 0, n, pages, nullptr, status, 0) != 0)
+      return -1;
+    for (std::size_t i = 0; i < n; ++i)
+      if (status[i] >= 0 && status[i] != node)
+        ++remote;               // negative: not resident
+  }
+  return remote;
+}
+
+void
+register_numa_region(std::string name, void const* addr, std::size_t size, int node) {
+  std::lock_guard<std::mutex> lock {g_numa_regions_mutex};
+  g_numa_regions.push_back(numa_region {std::move(name), addr, size, node});
+}
+
+long
+report_remote_pages(std::ostream& os) {
+  std::lock_guard<std::mutex> lock {g_numa_regions_mutex};
+  long total = 0;
+  std::size_t const page = ::sysconf(_SC_PAGESIZE);
+  for (auto const& r : g_numa_regions) {
+    long const remote = remote_pages(r.addr, r.size, r.node);
+    char line[128];
+    std::snprintf(line, sizeof line, "%-15s node=%d pages=%zu remote=%ld\n", r.name.c_str(),
+                  r.node, (r.size + page - 1) / page, remote);
+    os << line;
+    if (remote > 0)
+      total += remote;
+  }
+  return total;
+}
+} // preempt
@@ -0,0 +1,114 @@
+#include <preempt/all.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace preempt {
+namespace {
+struct counter_type {
+  std::uint32_t type;
+  std::uint64_t config;
+  char const* name;
+};
+
+constexpr counter_type counter_types[] = {
+  {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK, "task-clock"},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES, "cycles"},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS, "instructions"},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES, "cache-misses"},
+  {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES, "branch-misses"},
+};
+
+int
+perf_event_open(::perf_event_attr* attr, int group_fd) {
+  /* this thread on any CPU */
+  return int(::syscall(__NR_perf_event_open, attr, 0, -1, group_fd, PERF_FLAG_FD_CLOEXEC));
+}
+} // namespace
+
+double
+perf_sample::ipc() const {
+  return cycles > 0 && instructions >= 0 ? double(instructions) / cycles : 0;
+}
+
+double
+perf_sample::ghz() const {
+  return cycles >= 0 && task_clock > 0 ? double(cycles) / task_clock : 0;
+}
+
+perf_counters::perf_counters() {
+  static_assert(sizeof counter_types / sizeof counter_types[0] == count, "counter table");
+  for (int i = 0; i < count; ++i) {
+    ::perf_event_attr attr;
+    std::memset(&attr, 0, sizeof attr);
+    attr.size = sizeof attr;
+    attr.type = counter_types[i].type;
+    attr.config = counter_types[i].config;
+    attr.disabled = leader_ == -1;      // the group follows its leader
+    attr.exclude_kernel = 1;            // permitted with perf_event_paranoid=2
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+    fd_[i] = perf_event_open(&attr, leader_);
+    if (fd_[i] == -1) {
+      if (error_.empty())
+        error_ = base::sprintf("perf_event_open(%s) failed: '%s'", counter_types[i].name,
+                               std::strerror(errno));
+    } else if (leader_ == -1) {
+      leader_ = fd_[i];
+    }
+  }
+}
+
+perf_counters::~perf_counters() {
+  for (int fd : fd_)
+    if (fd != -1)
+      ::close(fd);
+}
+
+perf_counters::operator bool() const {
+  return leader_ != -1;
+}
+
+std::string const&
+perf_counters::last_error() const {
+  return error_;
+}
+
+void
+perf_counters::start() {
+  if (leader_ == -1)
+    return;
+  ::ioctl(leader_, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ::ioctl(leader_, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+perf_sample
+perf_counters::stop() {
+  perf_sample s;
+  if (leader_ == -1)
+    return s;
+  ::ioctl(leader_, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+  struct {
+    std::uint64_t nr, time_enabled, time_running, values[count];
+  } data;
+  ssize_t const n = ::read(leader_, &data, sizeof data);
+  if (n < ssize_t(3 * sizeof(std::uint64_t)) || data.time_running == 0)
+    return s;
+  double const scale = double(data.time_enabled) / data.time_running;
+  std::int64_t* const fields[count] = {
+    &s.task_clock, &s.cycles, &s.instructions, &s.cache_misses, &s.branch_misses
+  };
+  /* values are in the order the counters joined the group */
+  std::uint64_t v = 0;
+  for (int i = 0; i < count && v < data.nr; ++i)
+    if (fd_[i] != -1)
+      *fields[i] = std::int64_t(data.values[v++] * scale);
+  return s;
+}
+} // preempt
@@ -1,5 +1,11 @@
 #include <preempt/all.h>
 
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <ostream>
+#include <string>
+
 namespace preempt {
 pid_t
 get_current_process_id() {
@@ -14,8 +20,13 @@ get_parent_process_id() {
 namespace this_process {
 void
 begin_realtime() {
+  begin_realtime(lock_mode::all);
+}
+
+void
+begin_realtime(lock_mode mode) {
   unlimit_lock_pages();
-  lock_all_pages();
+  lock_pages(mode);
 }
 
 void
@@ -64,6 +75,114 @@ unlock_all_pages() {
 #endif // RUNNING_UNDER_LINUX
 }
 
+bool
+lock_pages(lock_mode mode) {
+#ifdef RUNNING_UNDER_LINUX
+  switch (mode) {
+  case lock_mode::all:
+    break;
+  case lock_mode::on_fault:
+#ifdef MCL_ONFAULT
+    if (::mlockall(MCL_CURRENT | MCL_FUTURE | MCL_ONFAULT) == 0)
+      return true;
+    if (errno != EINVAL)
+      return false;
+#endif // MCL_ONFAULT
+    break;                      // kernel before 4.4
+  case lock_mode::regions:
+    return true;
+  }
+  return lock_all_pages();
+#else
+  (void) mode;
+  return true;
+#endif // RUNNING_UNDER_LINUX
+}
+
+namespace {
+/** [addr, addr + size) extended to whole pages */
+void
+page_range(void const* addr, std::size_t size, void** first, std::size_t* length) {
+  std::uintptr_t const page = ::sysconf(_SC_PAGESIZE);
+  std::uintptr_t const begin = reinterpret_cast<std::uintptr_t>(addr) & ~(page - 1);
+  std::uintptr_t const end = (reinterpret_cast<std::uintptr_t>(addr) + size + page - 1)
+    & ~(page - 1);
+  *first = reinterpret_cast<void*>(begin);
+  *length = end - begin;
+}
+
+long
+status_kib(std::string const& status, char const* key) {
+  auto const pos = status.find(key);
+  if (pos == std::string::npos)
+    return -1;
+  return std::strtol(status.c_str() + pos + std::strlen(key), nullptr, 10);
+}
+} // namespace
+
+bool
+lock_region(void const* addr, std::size_t size) {
+  if (size == 0)
+    return true;
+#ifdef RUNNING_UNDER_LINUX
+  void* first;
+  std::size_t length;
+  page_range(addr, size, &first, &length);
+  /* populates the pages, even under MCL_ONFAULT */
+  return ::mlock(first, length) == 0;
+#else
+  return true;
+#endif // RUNNING_UNDER_LINUX
+}
+
+bool
+unlock_region(void const* addr, std::size_t size) {
+  if (size == 0)
+    return true;
+#ifdef RUNNING_UNDER_LINUX
+  void* first;
+  std::size_t length;
+  page_range(addr, size, &first, &length);
+  return ::munlock(first, length) == 0;
+#else
+  return true;
+#endif // RUNNING_UNDER_LINUX
+}
+
+bool
+lock_mapping(void const* addr) {
+  std::FILE* maps = std::fopen("/proc/self/maps", "r");
+  if (maps == nullptr)
+    return false;
+  std::uintptr_t const a = reinterpret_cast<std::uintptr_t>(addr);
+  std::uintptr_t begin = 0, end = 0;
+  bool found = false;
+  char line[4096];              // PATH_MAX
+  while (!found && std::fgets(line, sizeof line, maps))
+    found = std::sscanf(line, "%" SCNxPTR "-%" SCNxPTR, &begin, &end) == 2
+      && begin <= a && a < end;
+  std::fclose(maps);
+  return found && lock_region(reinterpret_cast<void const*>(begin), end - begin);
+}
+
+memory_usage
+get_memory_usage() {
+  memory_usage usage;
+  std::string status;
+  if (base::read_text_file("/proc/self/status", status)) {
+    usage.locked_kib = status_kib(status, "VmLck:");
+    usage.resident_kib = status_kib(status, "VmRSS:");
+  }
+  return usage;
+}
+
+void
+report_memory_usage(std::ostream& os, memory_usage const& before) {
+  memory_usage const now = get_memory_usage();
+  os << "VmLck: " << before.locked_kib << "kB -> " << now.locked_kib << "kB, VmRSS: "
+     << before.resident_kib << "kB -> " << now.resident_kib << "kB" << std::endl;
+}
+
 bool
 disable_core_file() {
   struct ::rlimit rl;
@@ -0,0 +1,233 @@
+#include <preempt/all.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+namespace preempt {
+namespace {
+constexpr int max_events = 64;
+} // namespace
+
+void
+reactor::notifier::notify() const noexcept {
+  std::uint64_t const one = 1;
+  (void)!::write(fd_, &one, sizeof one);
+}
+
+reactor::reactor() {
+  epoll_fd_ = ::epoll_create1(EPOLL_CLOEXEC);
+  if (epoll_fd_ < 0) {
+    error_ = base::sprintf("FAILED: epoll_create1(): '%s'", std::strerror(errno));
+    return;
+  }
+  stop_fd_ = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  ::epoll_event ev {};
+  ev.events = EPOLLIN;
+  ev.data.fd = stop_fd_;
+  if (stop_fd_ < 0 || ::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, stop_fd_, &ev)) {
+    error_ = base::sprintf("FAILED: eventfd(): '%s'", std::strerror(errno));
+    ::close(epoll_fd_);
+    epoll_fd_ = -1;
+  }
+}
+
+reactor::~reactor() {
+  stop();
+  for (int fd = 0; fd < int(entries_.size()); ++fd)
+    if (entries_[fd].type != kind::none && entries_[fd].type != kind::fd)
+      ::close(fd);
+  if (stop_fd_ >= 0)
+    ::close(stop_fd_);
+  if (epoll_fd_ >= 0)
+    ::close(epoll_fd_);
+}
+
+int
+reactor::watch(int fd, std::uint32_t events, callback fn) {
+  return add(fd, kind::fd, events, std::move(fn));
+}
+
+int
+reactor::every(long period_us, callback fn) {
+  return timer(period_us, period_us, kind::timer, std::move(fn));
+}
+
+int
+reactor::after(long delay_us, callback fn) {
+  return timer(delay_us, 0, kind::once, std::move(fn));
+}
+
+reactor::notifier
+reactor::wakeup(callback fn) {
+  int const fd = ::eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+  if (fd < 0) {
+    error_ = base::sprintf("FAILED: eventfd(): '%s'", std::strerror(errno));
+    return notifier {};
+  }
+  if (add(fd, kind::event, EPOLLIN, std::move(fn)) < 0) {
+    ::close(fd);
+    return notifier {};
+  }
+  return notifier {fd};
+}
+
+bool
+reactor::remove(int id) {
+  if (id < 0 || id >= int(entries_.size()) || entries_[id].type == kind::none)
+    return false;
+  ::epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, id, nullptr);
+  if (entries_[id].type != kind::fd)
+    ::close(id);
+  entries_[id] = entry {};
+  return true;
+}
+
+int
+reactor::run_once(int timeout_ms) {
+  ::epoll_event events[max_events];
+  int const n = ::epoll_wait(epoll_fd_, events, max_events, timeout_ms);
+  if (n < 0)
+    return errno == EINTR ? 0 : -1;
+  if (n == 0)
+    return 0;
+  std::int64_t const start = base::monotonic_now();
+  int dispatched = 0;
+  for (int i = 0; i < n; ++i) {
+    if (events[i].data.fd == stop_fd_)
+      continue;
+    dispatch(events[i].data.fd, events[i].events, start);
+    ++dispatched;
+  }
+  ++stats_.passes;
+  stats_.events += dispatched;
+  stats_.max_batch = std::max<long>(stats_.max_batch, dispatched);
+  stats_.max_pass_ns = std::max<long>(stats_.max_pass_ns, base::monotonic_now() - start);
+  return dispatched;
+}
+
+void
+reactor::run() {
+  while (!stopping_.load(std::memory_order_relaxed))
+    if (run_once() < 0)
+      base::quick_exit(base::sprintf("reactor error: epoll_wait(): '%s'",
+                                     std::strerror(errno)).c_str());
+}
+
+void
+reactor::start(base::stack_options const& stack) {
+  stop();
+  stopping_ = false;
+  spawn(SCHED_OTHER, 0, stack, &reactor::run, this);
+}
+
+void
+reactor::stop() {
+  stopping_ = true;
+  if (stop_fd_ >= 0)
+    notifier {stop_fd_}.notify();
+  join();
+  std::uint64_t count;
+  if (stop_fd_ >= 0)
+    (void)!::read(stop_fd_, &count, sizeof count);
+}
+
+reactor_stats
+reactor::stats() const noexcept {
+  reactor_stats s = stats_;
+  if (s.timer_expirations)
+    s.avg_latency_ns = latency_sum_ns_ / s.timer_expirations;
+  return s;
+}
+
+int
+reactor::add(int fd, kind type, std::uint32_t events, callback fn) {
+  if (fd < 0) {
+    error_ = "invalid file descriptor";
+    return -1;
+  }
+  if (int(entries_.size()) <= fd)
+    entries_.resize(fd + 1);
+  ::epoll_event ev {};
+  ev.events = events;
+  ev.data.fd = fd;
+  if (::epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev)) {
+    error_ = base::sprintf("FAILED: epoll_ctl(): '%s'", std::strerror(errno));
+    return -1;
+  }
+  entries_[fd].type = type;
+  entries_[fd].fn = std::move(fn);
+  return fd;
+}
+
+int
+reactor::timer(long delay_us, long period_us, kind type, callback fn) {
+  int const fd = ::timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+  if (fd < 0) {
+    error_ = base::sprintf("FAILED: timerfd_create(): '%s'", std::strerror(errno));
+    return -1;
+  }
+  delay_us = std::max(delay_us, 1L);
+  ::itimerspec its {};
+  its.it_value = base::nsec_to_timespec(base::usec_to_nsec(delay_us));
+  its.it_interval = base::nsec_to_timespec(base::usec_to_nsec(period_us));
+  std::int64_t const now = base::monotonic_now();
+  if (::timerfd_settime(fd, 0, &its, nullptr)) {
+    error_ = base::sprintf("FAILED: timerfd_settime(): '%s'", std::strerror(errno));
+    ::close(fd);
+    return -1;
+  }
+  if (add(fd, type, EPOLLIN, std::move(fn)) < 0) {
+    ::close(fd);
+    return -1;
+  }
+  entries_[fd].period_ns = std::int64_t(period_us) * 1000;
+  entries_[fd].next_ns = now + std::int64_t(delay_us) * 1000;
+  return fd;
+}
+
+void
+reactor::dispatch(int fd, std::uint32_t events, std::int64_t now) {
+  if (fd >= int(entries_.size()))
+    return;
+  entry& e = entries_[fd];
+  std::uint64_t arg = events;
+  switch (e.type) {
+    case kind::none:
+      return;                   // removed earlier in this pass
+    case kind::fd:
+      break;
+    case kind::event:
+      if (::read(fd, &arg, sizeof arg) != sizeof arg)
+        return;                 // already consumed
+      break;
+    case kind::timer:
+    case kind::once: {
+      if (::read(fd, &arg, sizeof arg) != sizeof arg)
+        return;
+      /* lateness of the last expiration */
+      std::int64_t const due = e.next_ns + std::int64_t(arg - 1) * e.period_ns;
+      std::int64_t const late = std::max<std::int64_t>(now - due, 0);
+      stats_.timer_expirations += arg;
+      stats_.max_latency_ns = std::max<long>(stats_.max_latency_ns, late);
+      latency_sum_ns_ += late * std::int64_t(arg);
+      e.next_ns = due + e.period_ns;
+      break;
+    }
+  }
+  if (e.type == kind::once) {
+    callback fn = std::move(e.fn);
+    remove(fd);
+    fn(arg);
+  } else {
+    /* a copy: the callback may remove itself or add entries */
+    callback fn = e.fn;
+    fn(arg);
+  }
+}
+} // preempt
@@ -0,0 +1,210 @@
+#include <preempt/all.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <istream>
+#include <numeric>
+#include <ostream>
+#include <sstream>
+
+namespace preempt {
+namespace analysis {
+namespace {
+long
+ceil_div(long a, long b) {
+  return (a + b - 1) / b;
+}
+
+bool
+valid(task_spec const& t) {
+  return t.period_us > 0 && t.wcet_us > 0 && t.deadline() > 0;
+}
+
+/**
+ * Priorities by rank (0 first) of the tasks ordered with less.
+ */
+template <typename Less>
+void
+assign_by_rank(task_set& set, int min, int max, Less less) {
+  std::vector<std::size_t> order(set.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::stable_sort(order.begin(), order.end(), [&set, &less](std::size_t a, std::size_t b) {
+    return less(set[a], set[b]);
+  });
+  long const levels = long(max) - min + 1;
+  long const n = long(set.size());
+  for (long rank = 0; rank < n; ++rank) {
+    long const step = n <= levels ? rank : rank * levels / n;
+    set[order[rank]].priority = int(max - step);
+  }
+}
+} // namespace
+
+double
+utilization(task_set const& set) {
+  double u = 0;
+  for (auto const& t : set)
+    if (t.period_us > 0)
+      u += double(t.wcet_us) / t.period_us;
+  return u;
+}
+
+double
+liu_layland_bound(std::size_t n) {
+  return n == 0 ? 1 : n * (std::pow(2.0, 1.0 / n) - 1);
+}
+
+bool
+liu_layland_test(task_set const& set) {
+  return utilization(set) <= liu_layland_bound(set.size());
+}
+
+std::vector<long>
+response_times(task_set const& set) {
+  std::vector<long> result(set.size(), -1);
+  for (std::size_t i = 0; i < set.size(); ++i) {
+    task_spec const& t = set[i];
+    if (!valid(t))
+      continue;
+    /*
+     * Jobs q = 0, 1, ... of the level-i busy period: job q completes at the
+     * fixed point of w = (q + 1) C + sum ceil(w / Tj) Cj and responds in
+     * w - q T. With deadlines up to the period only job 0 is in the busy
+     * period; beyond it later jobs may respond later (Lehoczky).
+     */
+    long worst = 0;
+    for (long q = 0; worst <= t.deadline(); ++q) {
+      long w = (q + 1) * t.wcet_us, previous = 0;
+      while (w != previous && w - q * t.period_us <= t.deadline()) {
+        previous = w;
+        w = (q + 1) * t.wcet_us;
+        for (std::size_t j = 0; j < set.size(); ++j)
+          if (j != i && set[j].priority >= t.priority && valid(set[j]))
+            w += ceil_div(previous, set[j].period_us) * set[j].wcet_us;
+      }
+      worst = std::max(worst, w - q * t.period_us);
+      if (w <= (q + 1) * t.period_us)
+        break;                  // the busy period ends before the next job
+    }
+    if (worst <= t.deadline())
+      result[i] = worst;
+  }
+  return result;
+}
+
+bool
+response_time_test(task_set const& set) {
+  auto const r = response_times(set);
+  return std::find(r.begin(), r.end(), -1L) == r.end();
+}
+
+bool
+edf_test(task_set const& set) {
+  for (auto const& t : set)
+    if (!valid(t))
+      return false;
+  if (utilization(set) > 1 + 1e-12)
+    return false;
+  /* synchronous busy period: w = sum ceil(w / T) C, converges for U <= 1 */
+  long busy = 0;
+  for (auto const& t : set)
+    busy += t.wcet_us;
+  for (int i = 0; i < 100000; ++i) {
+    long w = 0;
+    for (auto const& t : set)
+      w += ceil_div(busy, t.period_us) * t.wcet_us;
+    if (w == busy)
+      break;
+    busy = w;
+  }
+  /* check the demand at every absolute deadline up to the busy period */
+  std::vector<long> deadlines;
+  for (auto const& t : set)
+    for (long d = t.deadline(); d <= busy; d += t.period_us)
+      deadlines.push_back(d);
+  std::sort(deadlines.begin(), deadlines.end());
+  deadlines.erase(std::unique(deadlines.begin(), deadlines.end()), deadlines.end());
+  for (long d : deadlines) {
+    long demand = 0;
+    for (auto const& t : set)
+      if (d >= t.deadline())
+        demand += ((d - t.deadline()) / t.period_us + 1) * t.wcet_us;
+    if (demand > d)
+      return false;
+  }
+  return true;
+}
+
+void
+assign_rate_monotonic(task_set& set, int min, int max) {
+  assign_by_rank(set, min, max, [](task_spec const& a, task_spec const& b) {
+    return a.period_us < b.period_us;
+  });
+}
+
+void
+assign_deadline_monotonic(task_set& set, int min, int max) {
+  assign_by_rank(set, min, max, [](task_spec const& a, task_spec const& b) {
+    return a.deadline() < b.deadline()
+      || (a.deadline() == b.deadline() && a.period_us < b.period_us);
+  });
+}
+
+bool
+parse_task_set(std::istream& is, task_set& set, std::string* error) {
+  set.clear();
+  std::string line;
+  for (int number = 1; std::getline(is, line); ++number) {
+    auto const hash = line.find('#');
+    if (hash != std::string::npos)
+      line.erase(hash);
+    std::istringstream fields {line};
+    task_spec t;
+    if (!(fields >> t.name))
+      continue;                 // empty or comment
+    if (!(fields >> t.period_us >> t.deadline_us >> t.wcet_us) || !valid(t)
+        || t.deadline_us < 0) {
+      if (error)
+        *error = base::sprintf("line %d: expected name period deadline wcet [priority]",
+                               number);
+      return false;
+    }
+    fields >> t.priority;
+    set.push_back(t);
+  }
+  return true;
+}
+
+bool
+report(task_set const& set, std::ostream& os) {
+  auto const r = response_times(set);
+  char line[128];
+  std::snprintf(line, sizeof line, "%-15s %9s %9s %9s %5s %9s\n", "task", "T[us]", "D[us]",
+                "C[us]", "prio", "R[us]");
+  os << line;
+  for (std::size_t i = 0; i < set.size(); ++i) {
+    auto const& t = set[i];
+    std::snprintf(line, sizeof line, "%-15s %9ld %9ld %9ld %5d %9s\n", t.name.c_str(),
+                  t.period_us, t.deadline(), t.wcet_us, t.priority,
+                  r[i] < 0 ? "MISS" : std::to_string(r[i]).c_str());
+    os << line;
+  }
+  bool const rta = response_time_test(set);
+  std::snprintf(line, sizeof line, "utilization %.3f, Liu-Layland bound %.3f: %s\n",
+                utilization(set), liu_layland_bound(set.size()),
+                liu_layland_test(set) ? "schedulable" : "inconclusive");
+  os << line;
+  os << "response time analysis: " << (rta ? "schedulable" : "NOT schedulable") << '\n';
+  os << "EDF demand bound: " << (edf_test(set) ? "schedulable" : "NOT schedulable") << '\n';
+  return rta;
+}
+
+void
+require_schedulable(task_set const& set) {
+  std::ostringstream os;
+  if (!report(set, os))
+    base::quick_exit(("task set not schedulable:\n" + os.str()).c_str());
+}
+} // analysis
+} // preempt
@@ -0,0 +1,242 @@
+#include <preempt/all.h>
+
+#include <cerrno>
+#include <cstring>
+#include <new>
+
+#include <linux/futex.h>
+#include <signal.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <time.h>
+
+namespace preempt {
+namespace {
+constexpr std::uint32_t channel_magic = 0x50524543; // "PREC"
+constexpr std::uint32_t channel_version = 2;
+
+std::size_t
+round_up_pow2(std::size_t n) {
+  std::size_t p = 1;
+  while (p < n)
+    p <<= 1;
+  return p;
+}
+
+std::size_t
+round_up(std::size_t n, std::size_t m) {
+  return (n + m - 1) / m * m;
+}
+
+bool
+process_exists(pid_t pid) {
+  return pid > 0 && (::kill(pid, 0) == 0 || errno == EPERM);
+}
+} // namespace
+
+constexpr std::size_t shm_channel::prefix;
+
+shm_channel::shm_channel(std::string name, role r, std::size_t slot_size, std::size_t slots,
+                         wakeup w)
+  : name_ {std::move(name)}, role_ {r}, owner_ {true} {
+  slots = round_up_pow2(slots ? slots : 1);
+  if (slot_size > UINT32_MAX - prefix - CACHELINE_SIZE) {
+    error_ = base::sprintf("slot size %zu too big", slot_size);
+    owner_ = false;
+    return;
+  }
+  std::size_t const stride = round_up(prefix + slot_size, CACHELINE_SIZE);
+  std::size_t const bytes = round_up(sizeof(header), CACHELINE_SIZE) + slots * stride;
+
+  int fd = ::shm_open(name_.c_str(), O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0600);
+  if (fd == -1) {
+    error_ = base::sprintf("shm_open(%s) failed: '%s'", name_.c_str(), std::strerror(errno));
+    owner_ = false;
+    return;
+  }
+  if (::ftruncate(fd, bytes) == -1) {
+    error_ = base::sprintf("ftruncate(%zu) failed: '%s'", bytes, std::strerror(errno));
+    ::close(fd);
+    return;
+  }
+  int efd = -1;
+  if (w == wakeup::eventfd && (efd = ::eventfd(0, EFD_NONBLOCK)) == -1) {
+    error_ = base::sprintf("eventfd() failed: '%s'", std::strerror(errno));
+    ::close(fd);
+    return;
+  }
+  void* p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED) {
+    error_ = base::sprintf("mmap(%zu) failed: '%s'", bytes, std::strerror(errno));
+    if (efd != -1)
+      ::close(efd);
+    return;
+  }
+  header* h = new (p) header;
+  h->version = channel_version;
+  h->slot_size = std::uint32_t(slot_size);
+  h->stride = std::uint32_t(stride);
+  h->mask = slots - 1;
+  h->wakeup = int(w);
+  h->eventfd = efd;
+  h->head.store(0);
+  h->overruns.store(0);
+  h->tail.store(0);
+  h->pid[0].store(0);
+  h->pid[1].store(0);
+  h->waiting.store(0);
+  h->futex.store(0);
+  std::atomic_thread_fence(std::memory_order_release);
+  h->magic = channel_magic;
+  ::munmap(p, bytes);
+
+  /* map a second time like any other process */
+  if ((fd = ::shm_open(name_.c_str(), O_RDWR | O_CLOEXEC, 0)) == -1 || !map(fd, bytes)) {
+    if (error_.empty())
+      error_ = base::sprintf("shm_open(%s) failed: '%s'", name_.c_str(), std::strerror(errno));
+  }
+}
+
+shm_channel::shm_channel(std::string name, role r)
+  : name_ {std::move(name)}, role_ {r} {
+  int fd = ::shm_open(name_.c_str(), O_RDWR | O_CLOEXEC, 0);
+  if (fd == -1) {
+    error_ = base::sprintf("shm_open(%s) failed: '%s'", name_.c_str(), std::strerror(errno));
+    return;
+  }
+  struct ::stat st;
+  if (::fstat(fd, &st) == -1 || std::size_t(st.st_size) < sizeof(header)) {
+    error_ = base::sprintf("%s: not a channel", name_.c_str());
+    ::close(fd);
+    return;
+  }
+  map(fd, st.st_size);
+}
+
+bool
+shm_channel::map(int fd, std::size_t bytes) {
+  void* p = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+  ::close(fd);
+  if (p == MAP_FAILED) {
+    error_ = base::sprintf("mmap(%zu) failed: '%s'", bytes, std::strerror(errno));
+    return false;
+  }
+  header* h = static_cast<header*>(p);
+  std::size_t const offset = round_up(sizeof(header), CACHELINE_SIZE);
+  if (h->magic != channel_magic || h->version != channel_version
+      || offset + (h->mask + 1) * h->stride > bytes) {
+    error_ = base::sprintf("%s: not a channel or incompatible version", name_.c_str());
+    ::munmap(p, bytes);
+    return false;
+  }
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (::mlock(p, bytes) == -1) {
+    error_ = base::sprintf("mlock(%zu) failed: '%s'", bytes, std::strerror(errno));
+    ::munmap(p, bytes);
+    return false;
+  }
+  /* attach, taking over the slot of a process that died without detaching */
+  std::int32_t old = h->pid[role_].load();
+  if (old && process_exists(old)) {
+    error_ = base::sprintf("%s: %s already attached (pid %d)", name_.c_str(),
+                           role_ == producer ? "producer" : "consumer", old);
+    ::munlock(p, bytes);
+    ::munmap(p, bytes);
+    return false;
+  }
+  if (!h->pid[role_].compare_exchange_strong(old, ::getpid())) {
+    error_ = base::sprintf("%s: concurrent attach", name_.c_str());
+    ::munlock(p, bytes);
+    ::munmap(p, bytes);
+    return false;
+  }
+  hdr_ = h;
+  bytes_ = bytes;
+  slots_ = static_cast<unsigned char*>(p) + offset;
+  if (role_ == producer) {
+    local_ = h->head.load(std::memory_order_acquire);
+    cached_ = h->tail.load(std::memory_order_acquire);
+  } else {
+    local_ = h->tail.load(std::memory_order_acquire);
+    cached_ = h->head.load(std::memory_order_acquire);
+  }
+  return true;
+}
+
+shm_channel::~shm_channel() {
+  if (hdr_) {
+    std::int32_t self = ::getpid();
+    hdr_->pid[role_].compare_exchange_strong(self, 0);
+    if (owner_ && hdr_->eventfd != -1)
+      ::close(hdr_->eventfd);
+    ::munlock(hdr_, bytes_);
+    ::munmap(hdr_, bytes_);
+  }
+  if (owner_)
+    ::shm_unlink(name_.c_str());
+}
+
+void
+shm_channel::notify() noexcept {
+  std::atomic_thread_fence(std::memory_order_seq_cst); // order head before waiting
+  if (hdr_->waiting.load(std::memory_order_relaxed) == 0)
+    return;
+  switch (wakeup(hdr_->wakeup)) {
+    case wakeup::futex:
+      hdr_->futex.fetch_add(1, std::memory_order_release);
+      ::syscall(SYS_futex, &hdr_->futex, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+      break;
+    case wakeup::eventfd: {
+      std::uint64_t one = 1;
+      (void) ::write(hdr_->eventfd, &one, sizeof one);
+      break;
+    }
+    case wakeup::none:
+      break;
+  }
+}
+
+bool
+shm_channel::wait(long timeout_us) noexcept {
+  if (peek())
+    return true;
+  if (timeout_us <= 0)
+    return false;
+  switch (wakeup(hdr_->wakeup)) {
+    case wakeup::futex: {
+      std::uint32_t const seq = hdr_->futex.load(std::memory_order_acquire);
+      hdr_->waiting.store(1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst); // order waiting before head
+      if (!peek()) {
+        ::timespec ts = base::nsec_to_timespec(base::usec_to_nsec(timeout_us));
+        ::syscall(SYS_futex, &hdr_->futex, FUTEX_WAIT, seq, &ts, nullptr, 0);
+      }
+      hdr_->waiting.store(0, std::memory_order_relaxed);
+      break;
+    }
+    case wakeup::eventfd: {
+      hdr_->waiting.store(1, std::memory_order_relaxed);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      if (!peek()) {
+        ::pollfd pfd {hdr_->eventfd, POLLIN, 0};
+        ::poll(&pfd, 1, int((timeout_us + 999) / 1000));
+      }
+      std::uint64_t count;
+      (void) ::read(hdr_->eventfd, &count, sizeof count);
+      hdr_->waiting.store(0, std::memory_order_relaxed);
+      break;
+    }
+    case wakeup::none:
+      for (long slept = 0; slept < timeout_us && !peek(); slept += 100)
+        ::usleep(100);
+      break;
+  }
+  return peek() != nullptr;
+}
+
+bool
+shm_channel::peer_alive() const noexcept {
+  return process_exists(hdr_->pid[role_ == producer ? consumer : producer].load());
+}
+} // preempt
@@ -0,0 +1,129 @@
+#include <preempt/all.h>
+
+#include <algorithm>
+#include <atomic>
+#include <climits>              // PTHREAD_STACK_MIN
+#include <memory>
+#include <ostream>
+#include <system_error>
+
+namespace preempt {
+namespace {
+constexpr unsigned max_stack_usages = 256;
+
+stack_usage g_stack_usages[max_stack_usages];
+std::atomic<bool> g_stack_usage_ready[max_stack_usages];
+std::atomic<unsigned> g_stack_usages_next {0};
+
+void
+record_stack_usage(std::size_t peak) {
+  unsigned const i = g_stack_usages_next.fetch_add(1, std::memory_order_relaxed);
+  if (i >= max_stack_usages)
+    return;
+  stack_usage& u = g_stack_usages[i];
+  if (pthread_getname_np(pthread_self(), u.name, sizeof u.name))
+    u.name[0] = '\0';
+  u.size = 0;
+  ::pthread_attr_t attr;
+  if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+    pthread_attr_getstacksize(&attr, &u.size);
+    pthread_attr_destroy(&attr);
+  }
+  u.peak = peak;
+  g_stack_usage_ready[i].store(true, std::memory_order_release);
+}
+
+void*
+thread_main(void* p) {
+  std::unique_ptr<details::thread_start> call {static_cast<details::thread_start*>(p)};
+  base::prepare_stack(call->stack);
+  call->run();
+  std::size_t const peak = base::stack_high_water_mark();
+  if (peak)
+    record_stack_usage(peak);
+  return reinterpret_cast<void*>(peak);
+}
+} // namespace
+
+void
+thread::start(int policy, int priority, base::stack_options const& stack,
+              details::thread_start* call) {
+  call->stack = stack;
+  ::pthread_attr_t attr;
+  char const* what = "pthread_attr_init()";
+  int errnum = pthread_attr_init(&attr);
+  if (errnum == 0) {
+    ::sched_param sch {};
+    sch.sched_priority = priority;
+    /* SCHED_OTHER threads inherit the scheduling of their creator like
+       std::thread */
+    if (policy != SCHED_OTHER
+        && ((errnum = pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED))
+            || (errnum = pthread_attr_setschedpolicy(&attr, policy))
+            || (errnum = pthread_attr_setschedparam(&attr, &sch))))
+      what = "pthread_attr_setschedparam()";
+    else if ((errnum = base::set_stack_attributes(&attr, stack)))
+      what = "pthread_attr_setstacksize()";
+    else if ((errnum = pthread_create(&handle_, &attr, thread_main, call)))
+      what = "pthread_create()";
+    pthread_attr_destroy(&attr);
+  }
+  if (errnum) {
+    delete call;
+    base::quick_exit(base::sprintf("FAILED: %s: '%s'", what, std::strerror(errnum)).c_str());
+  }
+  joinable_ = true;
+}
+
+void
+thread::join() {
+  if (false == joinable_)
+    throw std::system_error {EINVAL, std::system_category(), "thread::join()"};
+  void* result = nullptr;
+  if (int errnum = pthread_join(handle_, &result))
+    throw std::system_error {errnum, std::system_category(), "thread::join()"};
+  joinable_ = false;
+  stack_peak_ = reinterpret_cast<std::size_t>(result);
+}
+
+void
+thread::detach() {
+  if (false == joinable_)
+    throw std::system_error {EINVAL, std::system_category(), "thread::detach()"};
+  if (int errnum = pthread_detach(handle_))
+    throw std::system_error {errnum, std::system_category(), "thread::detach()"};
+  joinable_ = false;
+}
+
+std::size_t
+stack_usage::suggested_size() const {
+  std::size_t const page = ::sysconf(_SC_PAGESIZE);
+  std::size_t const size = (2 * peak + page - 1) / page * page;
+  return std::max<std::size_t>(size, PTHREAD_STACK_MIN);
+}
+
+std::vector<stack_usage>
+stack_usages() {
+  std::vector<stack_usage> result;
+  unsigned const n = std::min(g_stack_usages_next.load(), max_stack_usages);
+  for (unsigned i = 0; i < n; ++i)
+    if (g_stack_usage_ready[i].load(std::memory_order_acquire))
+      result.push_back(g_stack_usages[i]);
+  return result;
+}
+
+void
+report_stack_usage(std::ostream& os) {
+  std::size_t total = 0, suggested = 0;
+  for (auto const& u : stack_usages()) {
+    char line[128];
+    std::snprintf(line, sizeof line, "%-15s size=%zuKiB peak=%zuKiB suggested=%zuKiB\n",
+                  u.name[0] ? u.name : "?", u.size / 1024, (u.peak + 1023) / 1024,
+                  u.suggested_size() / 1024);
+    os << line;
+    total += u.size;
+    suggested += u.suggested_size();
+  }
+  os << "stacks: " << total / 1024 << "KiB, suggested " << suggested / 1024 << "KiB\n";
+}
+} // preempt
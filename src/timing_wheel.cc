@@ -0,0 +1,172 @@
+#include <preempt/all.h>
+
+namespace preempt {
+constexpr int timing_wheel::root_bits;
+constexpr int timing_wheel::level_bits;
+constexpr int timing_wheel::levels;
+constexpr std::size_t timing_wheel::root_size;
+constexpr std::size_t timing_wheel::level_size;
+
+timing_wheel::timer::~timer() {
+  if (timing_wheel* wheel = wheel_.load())
+    wheel->cancel(*this);
+}
+
+timing_wheel::timing_wheel(long tick_us) : tick_us_ {tick_us} { }
+
+void
+timing_wheel::start(int priority, base::stack_options const& stack) {
+  stop();
+  stopping_ = false;
+  spawn(SCHED_FIFO, priority, stack, &timing_wheel::tick_thread, this);
+}
+
+void
+timing_wheel::stop() {
+  stopping_ = true;
+  join();
+}
+
+void
+timing_wheel::arm(timer& t, long delay_us) {
+  arm_ticks(t, delay_us <= 0 ? 1 : (delay_us + tick_us_ - 1) / tick_us_);
+}
+
+void
+timing_wheel::arm_ticks(timer& t, std::uint64_t ticks) {
+  std::lock_guard<std::mutex> lock {mutex_};
+  if (t.wheel_.load(std::memory_order_relaxed) == this)
+    unlink(t);
+  else
+    size_.fetch_add(1, std::memory_order_relaxed);
+  /* a delay of one tick expires at the next tick processed */
+  t.expires_ = current_.load(std::memory_order_relaxed) + (ticks ? ticks : 1) - 1;
+  t.wheel_.store(this, std::memory_order_relaxed);
+  add(t);
+}
+
+void
+timing_wheel::cancel(timer& t) {
+  std::lock_guard<std::mutex> lock {mutex_};
+  if (t.wheel_.load(std::memory_order_relaxed) != this)
+    return;
+  unlink(t);
+  t.wheel_.store(nullptr, std::memory_order_relaxed);
+  size_.fetch_sub(1, std::memory_order_relaxed);
+}
+
+std::size_t
+timing_wheel::advance(std::uint64_t ticks) {
+  std::size_t fired = 0;
+  for (; ticks > 0; --ticks) {
+    link batch;
+    {
+      std::lock_guard<std::mutex> lock {mutex_};
+      std::uint64_t const now = current_.load(std::memory_order_relaxed);
+      std::size_t const index = now & (root_size - 1);
+      if (index == 0) {
+        /* the root wheel wrapped: spread the next slot of the coarser wheels */
+        for (int level = 0; level < levels; ++level) {
+          std::size_t const i = (now >> (root_bits + level * level_bits)) & (level_size - 1);
+          cascade(level, i);
+          if (i != 0)
+            break;
+        }
+      }
+      link& slot = root_[index];
+      if (slot.next != &slot) {
+        batch.next = slot.next;
+        batch.prev = slot.prev;
+        batch.next->prev = batch.prev->next = &batch;
+        slot.next = slot.prev = &slot;
+      }
+      current_.store(now + 1, std::memory_order_relaxed);
+    }
+    /* run the batch without the lock; cancel() may take timers out of it */
+    for (;;) {
+      timer* t;
+      {
+        std::lock_guard<std::mutex> lock {mutex_};
+        if (batch.next == &batch)
+          break;
+        t = static_cast<timer*>(batch.next);
+        unlink(*t);
+        t->wheel_.store(nullptr, std::memory_order_relaxed);
+        size_.fetch_sub(1, std::memory_order_relaxed);
+      }
+      t->fn_(*t);
+      ++fired;
+    }
+  }
+  return fired;
+}
+
+void
+timing_wheel::add(timer& t) {
+  std::uint64_t const now = current_.load(std::memory_order_relaxed);
+  std::uint64_t expires = t.expires_;
+  if (expires < now)
+    expires = now;
+  std::uint64_t const delta = expires - now;
+  if (delta < root_size) {
+    push(root_[expires & (root_size - 1)], t);
+    return;
+  }
+  for (int level = 0; level < levels; ++level) {
+    int const shift = root_bits + level * level_bits;
+    if (delta < std::uint64_t(1) << (shift + level_bits) || level == levels - 1) {
+      std::uint64_t const max = (std::uint64_t(1) << (shift + level_bits)) - 1;
+      if (delta > max)
+        expires = now + max;    // waits in the last slot and is placed again
+      push(wheels_[level][(expires >> shift) & (level_size - 1)], t);
+      return;
+    }
+  }
+}
+
+void
+timing_wheel::cascade(int level, std::size_t index) {
+  link& slot = wheels_[level][index];
+  link pending;
+  if (slot.next == &slot)
+    return;
+  pending.next = slot.next;
+  pending.prev = slot.prev;
+  pending.next->prev = pending.prev->next = &pending;
+  slot.next = slot.prev = &slot;
+  while (pending.next != &pending) {
+    timer& t = *static_cast<timer*>(pending.next);
+    unlink(t);
+    add(t);
+  }
+}
+
+void
+timing_wheel::tick_thread() {
+  base::nsec_t const tick_ns = base::nsec_t(tick_us_) * 1000;
+  base::nsec_t const origin = base::monotonic_now() - base::nsec_t(ticks()) * tick_ns;
+  while (!stopping_.load(std::memory_order_relaxed)) {
+    base::nsec_t const next = origin + base::nsec_t(ticks() + 1) * tick_ns;
+    base::sleep_until(next);
+    /* catch up on ticks that were missed */
+    std::uint64_t const due = (base::monotonic_now() - origin) / tick_ns;
+    if (due > ticks())
+      advance(due - ticks());
+  }
+}
+
+void
+timing_wheel::unlink(link& l) noexcept {
+  l.prev->next = l.next;
+  l.next->prev = l.prev;
+  l.next = l.prev = &l;
+}
+
+void
+timing_wheel::push(link& head, link& l) noexcept {
+  l.prev = head.prev;
+  l.next = &head;
+  head.prev->next = &l;
+  head.prev = &l;
+}
+} // preempt
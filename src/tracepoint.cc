@@ -0,0 +1,475 @@
+#include <preempt/all.h>
+
+#include <base/seqlock.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+namespace preempt {
+namespace tracing {
+namespace {
+constexpr char file_magic[8] = {'P', 'R', 'T', 'R', 'A', 'C', 'E', '1'};
+constexpr std::size_t name_size = 32;
+constexpr std::size_t initial_file_size = 1 << 20;
+
+/**
+ * Start of the trace file, followed by the events. Two pairs of timestamp
+ * counter and CLOCK_MONOTONIC readings, taken at start() and stop(), convert
+ * counter values to monotonic time.
+ */
+struct file_header {
+  char magic[8];
+  std::uint32_t event_size;
+  std::uint32_t pid;
+  std::uint64_t tsc_hz;         // calibrated at start()
+  std::uint64_t tsc0, tsc1;
+  std::int64_t mono0, mono1;    // nanoseconds
+  std::uint64_t events;
+  std::uint64_t dropped;
+  char names[max_named_events][name_size];
+};
+
+/** Published per id, so that write_marker() reads names without the lock. */
+struct event_name {
+  char text[name_size];
+};
+
+struct anchor {
+  std::uint64_t tsc;
+  std::int64_t mono;
+};
+
+struct recorder {
+  std::mutex lock;
+  std::vector<details::ring*> rings;
+  std::uint64_t dropped = 0;    // of freed rings
+  base::seqlock<event_name> names[max_named_events];   // written under lock
+  std::string error;
+
+  int fd = -1;
+  char* map = nullptr;
+  std::size_t size = 0;         // of file and mapping
+  std::size_t used = 0;
+  std::uint64_t events = 0;
+  std::uint64_t tsc_hz = 0;
+  anchor begin {};
+
+  std::thread flusher;
+  std::condition_variable wakeup;
+  bool stopping = false;
+};
+
+recorder&
+instance() {
+  /* outlives thread-exit handlers; over-aligned, so not plain new in C++14 */
+  static recorder* r = [] {
+    void* p = nullptr;
+    if (::posix_memalign(&p, alignof(recorder), sizeof(recorder)) != 0)
+      throw std::bad_alloc {};
+    return new (p) recorder;
+  }();
+  return *r;
+}
+
+/** Counter value and monotonic time taken as closely together as possible. */
+anchor
+take_anchor() {
+  anchor best {};
+  std::int64_t window = INT64_MAX;
+  for (int i = 0; i < 5; ++i) {
+    std::uint32_t cpu;
+    std::int64_t const t0 = base::monotonic_now();
+    std::uint64_t const tsc = details::read_tsc(&cpu);
+    std::int64_t const t1 = base::monotonic_now();
+    if (t1 - t0 < window) {
+      window = t1 - t0;
+      best = anchor {tsc, t0 + (t1 - t0) / 2};
+    }
+  }
+  return best;
+}
+
+std::uint64_t
+calibrate(anchor const& a) {
+#if defined(__x86_64__) || defined(__i386__)
+  std::this_thread::sleep_for(std::chrono::milliseconds {20});
+  anchor const b = take_anchor();
+  return std::uint64_t(double(b.tsc - a.tsc) * 1e9 / double(b.mono - a.mono));
+#else
+  return 1000000000;            // read_tsc() returns nanoseconds
+#endif
+}
+
+file_header*
+header_of(recorder& r) {
+  return reinterpret_cast<file_header*>(r.map);
+}
+
+/** Grow file and mapping to hold at least bytes. Called with lock held. */
+bool
+reserve(recorder& r, std::size_t bytes) {
+  if (bytes <= r.size)
+    return true;
+  std::size_t size = r.size;
+  while (size < bytes)
+    size *= 2;
+  if (::ftruncate(r.fd, size) == -1)
+    return false;
+  void* p = ::mremap(r.map, r.size, size, MREMAP_MAYMOVE);
+  if (p == MAP_FAILED)
+    return false;
+  r.map = static_cast<char*>(p);
+  r.size = size;
+  return true;
+}
+
+void
+free_ring(recorder& r, details::ring* ring) {
+  r.dropped += ring->dropped.load(std::memory_order_relaxed);
+  r.rings.erase(std::find(r.rings.begin(), r.rings.end(), ring));
+  ring->~ring();
+  std::free(ring);
+}
+
+/** Copy new events of all rings into the file. Called with lock held. */
+std::size_t
+flush_locked(recorder& r) {
+  if (r.fd == -1)
+    return 0;
+  std::size_t moved = 0;
+  for (std::size_t i = 0; i < r.rings.size(); ) {
+    details::ring* ring = r.rings[i];
+    std::uint64_t const head = ring->head.load(std::memory_order_acquire);
+    std::uint64_t tail = ring->tail.load(std::memory_order_relaxed);
+    std::size_t const n = head - tail;
+    if (n && reserve(r, r.used + n * sizeof(event))) {
+      event* out = reinterpret_cast<event*>(r.map + r.used);
+      for (; tail != head; ++tail)
+        *out++ = ring->events[tail & (ring_capacity - 1)];
+      ring->tail.store(tail, std::memory_order_release);
+      r.used += n * sizeof(event);
+      r.events += n;
+      moved += n;
+    }
+    if (ring->orphaned.load(std::memory_order_acquire) &&
+        ring->tail.load(std::memory_order_relaxed) == head) {
+      free_ring(r, ring);
+    } else {
+      ++i;
+    }
+  }
+  return moved;
+}
+
+/** Runs SCHED_OTHER, whatever the policy of the thread calling start(). */
+void
+flusher_main(recorder* r, unsigned flush_ms) {
+  ::sched_param param {};
+  ::pthread_setschedparam(::pthread_self(), SCHED_OTHER, &param);
+  std::unique_lock<std::mutex> lock {r->lock};
+  while (!r->stopping) {
+    r->wakeup.wait_for(lock, std::chrono::milliseconds {flush_ms});
+    flush_locked(*r);
+  }
+}
+
+/** Marks the ring of an exiting thread; the flusher frees it once drained. */
+struct ring_owner {
+  ~ring_owner() {
+    details::ring*& ring = details::this_ring();
+    if (ring == nullptr)
+      return;
+    recorder& r = instance();
+    std::lock_guard<std::mutex> lock {r.lock};
+    if (r.fd == -1)
+      free_ring(r, ring);
+    else
+      ring->orphaned.store(true, std::memory_order_release);
+    ring = nullptr;
+  }
+};
+
+void
+append_json_string(std::string& out, char const* s) {
+  out += '"';
+  for (; *s; ++s) {
+    if (*s == '"' || *s == '\\') {
+      out += '\\';
+      out += *s;
+    } else if (static_cast<unsigned char>(*s) < 0x20) {
+      char escaped[8];
+      std::snprintf(escaped, sizeof escaped, "\\u%04x", unsigned(*s));
+      out += escaped;
+    } else {
+      out += *s;
+    }
+  }
+  out += '"';
+}
+} // namespace
+
+namespace details {
+std::atomic<bool> g_recording {false};
+std::atomic<int> g_marker_fd {-1};
+
+ring*
+register_ring() {
+  ring*& mine = this_ring();
+  if (mine != nullptr)
+    return mine;
+  static thread_local ring_owner owner;
+  (void)owner;
+  void* p = nullptr;
+  if (::posix_memalign(&p, alignof(ring), sizeof(ring)) != 0)
+    return nullptr;
+  ring* fresh = new (p) ring;
+  std::memset(fresh->events, 0, sizeof fresh->events);  // prefault
+  fresh->tid = std::uint32_t(base::get_current_thread_id());
+  recorder& r = instance();
+  std::lock_guard<std::mutex> lock {r.lock};
+  r.rings.push_back(fresh);
+  return mine = fresh;
+}
+
+void
+write_marker(std::uint16_t id, std::uint64_t payload) noexcept {
+  char buffer[96];
+  event_name const entry = id < max_named_events ? instance().names[id].load() : event_name {};
+  char const* name = entry.text;
+  int const n = *name
+    ? std::snprintf(buffer, sizeof buffer, "preempt: %s payload=%llu\n", name,
+                    static_cast<unsigned long long>(payload))
+    : std::snprintf(buffer, sizeof buffer, "preempt: event%u payload=%llu\n", unsigned(id),
+                    static_cast<unsigned long long>(payload));
+  ssize_t const rc = ::write(g_marker_fd.load(std::memory_order_relaxed), buffer,
+                             std::min<std::size_t>(n, sizeof buffer - 1));
+  (void)rc;
+}
+} // details
+
+void
+define(std::uint16_t id, char const* name) {
+  if (id >= max_named_events)
+    return;
+  recorder& r = instance();
+  std::lock_guard<std::mutex> lock {r.lock};
+  event_name entry {};
+  std::snprintf(entry.text, name_size, "%s", name);
+  r.names[id].store(entry);
+}
+
+bool
+start(std::string const& path, unsigned flush_ms, bool trace_marker) {
+  recorder& r = instance();
+  std::lock_guard<std::mutex> lock {r.lock};
+  if (r.fd != -1) {
+    r.error = "recording is already active";
+    return false;
+  }
+  int marker = -1;
+  if (trace_marker) {
+    for (char const* p : {"/sys/kernel/tracing/trace_marker",
+                          "/sys/kernel/debug/tracing/trace_marker"}) {
+      if ((marker = ::open(p, O_WRONLY | O_CLOEXEC)) != -1)
+        break;
+    }
+    if (marker == -1) {
+      r.error = base::sprintf("open(trace_marker) failed: '%s'", std::strerror(errno));
+      return false;
+    }
+  }
+  int const fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+  if (fd == -1 || ::ftruncate(fd, initial_file_size) == -1) {
+    r.error = base::sprintf("open(%s) failed: '%s'", path.c_str(), std::strerror(errno));
+    if (fd != -1)
+      ::close(fd);
+    if (marker != -1)
+      ::close(marker);
+    return false;
+  }
+  void* p = ::mmap(nullptr, initial_file_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+  if (p == MAP_FAILED) {
+    r.error = base::sprintf("mmap() failed: '%s'", std::strerror(errno));
+    ::close(fd);
+    if (marker != -1)
+      ::close(marker);
+    return false;
+  }
+  r.fd = fd;
+  r.map = static_cast<char*>(p);
+  r.size = initial_file_size;
+  r.used = sizeof(file_header);
+  r.events = 0;
+  r.begin = take_anchor();
+  r.tsc_hz = calibrate(r.begin);
+  r.stopping = false;
+  for (details::ring* ring : r.rings) {   // forget events of a previous recording
+    ring->tail.store(ring->head.load(std::memory_order_acquire), std::memory_order_release);
+    ring->dropped.store(0, std::memory_order_relaxed);
+  }
+  r.dropped = 0;
+  r.error.clear();
+  details::g_marker_fd.store(marker, std::memory_order_relaxed);
+  r.flusher = std::thread {flusher_main, &r, flush_ms ? flush_ms : 1};
+  details::g_recording.store(true, std::memory_order_release);
+  return true;
+}
+
+void
+stop() {
+  recorder& r = instance();
+  {
+    std::lock_guard<std::mutex> lock {r.lock};
+    if (r.fd == -1 || r.stopping)
+      return;
+    details::g_recording.store(false, std::memory_order_relaxed);
+    r.stopping = true;
+  }
+  r.wakeup.notify_all();
+  r.flusher.join();
+
+  std::lock_guard<std::mutex> lock {r.lock};
+  flush_locked(r);
+  file_header* h = header_of(r);
+  std::memcpy(h->magic, file_magic, sizeof h->magic);
+  h->event_size = sizeof(event);
+  h->pid = std::uint32_t(::getpid());
+  h->tsc_hz = r.tsc_hz;
+  anchor const end = take_anchor();
+  h->tsc0 = r.begin.tsc;
+  h->mono0 = r.begin.mono;
+  h->tsc1 = end.tsc;
+  h->mono1 = end.mono;
+  h->events = r.events;
+  h->dropped = r.dropped;
+  for (details::ring* ring : r.rings)
+    h->dropped += ring->dropped.load(std::memory_order_relaxed);
+  for (std::size_t id = 0; id < max_named_events; ++id)
+    std::memcpy(h->names[id], r.names[id].load().text, name_size);
+  ::munmap(r.map, r.size);
+  if (::ftruncate(r.fd, r.used) == -1)
+    r.error = base::sprintf("ftruncate() failed: '%s'", std::strerror(errno));
+  ::close(r.fd);
+  r.fd = -1;
+  r.map = nullptr;
+  int const marker = details::g_marker_fd.exchange(-1);
+  if (marker != -1)
+    ::close(marker);
+}
+
+bool
+active() noexcept {
+  return details::g_recording.load(std::memory_order_relaxed);
+}
+
+std::string
+last_error() {
+  recorder& r = instance();
+  std::lock_guard<std::mutex> lock {r.lock};
+  return r.error;
+}
+
+void
+register_thread() {
+  details::register_ring();
+}
+
+std::size_t
+flush() {
+  recorder& r = instance();
+  std::lock_guard<std::mutex> lock {r.lock};
+  return flush_locked(r);
+}
+
+std::uint64_t
+dropped() noexcept {
+  recorder& r = instance();
+  std::lock_guard<std::mutex> lock {r.lock};
+  std::uint64_t n = r.dropped;
+  for (details::ring* ring : r.rings)
+    n += ring->dropped.load(std::memory_order_relaxed);
+  return n;
+}
+
+long
+decode(std::string const& path, std::ostream& os, format fmt) {
+  std::ifstream in {path, std::ios::binary};
+  std::vector<char> bytes {std::istreambuf_iterator<char> {in}, std::istreambuf_iterator<char> {}};
+  if (bytes.size() < sizeof(file_header))
+    return -1;
+  file_header h;
+  std::memcpy(&h, bytes.data(), sizeof h);
+  if (std::memcmp(h.magic, file_magic, sizeof h.magic) != 0 || h.event_size != sizeof(event))
+    return -1;
+  std::size_t const n = std::min<std::size_t>(h.events,
+                                               (bytes.size() - sizeof h) / sizeof(event));
+  std::vector<event> events(n);
+  if (n)
+    std::memcpy(events.data(), bytes.data() + sizeof h, n * sizeof(event));
+  /* rings are flushed one after the other */
+  std::stable_sort(events.begin(), events.end(),
+                   [](event const& a, event const& b) { return a.tsc < b.tsc; });
+
+  /* prefer the long baseline between start and stop over the calibration */
+  double ns_per_tick = 1e9 / double(h.tsc_hz ? h.tsc_hz : 1);
+  if (h.mono1 - h.mono0 > 100000000 && h.tsc1 > h.tsc0)
+    ns_per_tick = double(h.mono1 - h.mono0) / double(h.tsc1 - h.tsc0);
+  auto const monotonic = [&](event const& e) {
+    return h.mono0 + std::int64_t(double(std::int64_t(e.tsc - h.tsc0)) * ns_per_tick);
+  };
+  for (auto& s : h.names)
+    s[name_size - 1] = '\0';
+  char unnamed[name_size];
+  auto const name = [&](event const& e) -> char const* {
+    if (e.id < max_named_events && h.names[e.id][0])
+      return h.names[e.id];
+    std::snprintf(unnamed, sizeof unnamed, "event%u", unsigned(e.id));
+    return unnamed;
+  };
+
+  char line[160];
+  if (fmt == format::text) {
+    os << "# " << n << " events, " << h.dropped << " dropped, pid " << h.pid
+       << ", CLOCK_MONOTONIC seconds\n";
+    for (event const& e : events) {
+      std::int64_t const t = monotonic(e);
+      std::snprintf(line, sizeof line, "%lld.%09lld cpu=%u tid=%u %s payload=%llu\n",
+                    static_cast<long long>(t / 1000000000),
+                    static_cast<long long>(t % 1000000000), unsigned(e.cpu), e.tid, name(e),
+                    static_cast<unsigned long long>(e.payload));
+      os << line;
+    }
+  } else {
+    std::string json = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    for (std::size_t i = 0; i < n; ++i) {
+      event const& e = events[i];
+      std::int64_t const t = monotonic(e);
+      json += i ? ",\n{\"name\":" : "\n{\"name\":";
+      append_json_string(json, name(e));
+      std::snprintf(line, sizeof line,
+                    ",\"ph\":\"i\",\"s\":\"t\",\"ts\":%lld.%03lld,\"pid\":%u,\"tid\":%u,"
+                    "\"args\":{\"cpu\":%u,\"payload\":%llu}}",
+                    static_cast<long long>(t / 1000), static_cast<long long>(t % 1000),
+                    h.pid, e.tid, unsigned(e.cpu), static_cast<unsigned long long>(e.payload));
+      json += line;
+    }
+    json += "\n]}\n";
+    os << json;
+  }
+  return long(n);
+}
+} // tracing
+} // preempt
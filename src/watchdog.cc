@@ -0,0 +1,118 @@
+#include <preempt/all.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+
+#include <sched.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+namespace preempt {
+constexpr int watchdog::max_threads;
+
+watchdog::watchdog(long period_us, int cpu, int priority)
+  : period_us_ {period_us}, cpu_ {cpu}, priority_ {priority} { }
+
+void
+watchdog::start(base::stack_options const& stack) {
+  stop();
+  stopping_ = false;
+  spawn(SCHED_FIFO, priority_, stack, &watchdog::supervise, this);
+}
+
+void
+watchdog::stop() {
+  stopping_ = true;
+  join();
+}
+
+watchdog::heartbeat
+watchdog::watch(char const* name, long window_us, bool escalate) {
+  for (int i = 0; i < max_threads; ++i) {
+    details::watchdog_slot& slot = slots_[i];
+    std::uint32_t generation = slot.generation.load(std::memory_order_relaxed);
+    if (generation % 4 != 0)
+      continue;
+    /* generation modulo 4: 0 free, 1 being filled in, 2 watched */
+    if (!slot.generation.compare_exchange_strong(generation, generation + 1))
+      continue;
+    slot.tid = ::syscall(SYS_gettid);
+    slot.window_ns = window_us * 1000;
+    slot.escalate = escalate;
+    std::snprintf(slot.name, sizeof slot.name, "%s", name);
+    slot.missed.store(0, std::memory_order_relaxed);
+    slot.beats.store(0, std::memory_order_relaxed);
+    slot.generation.store(generation + 2, std::memory_order_release);
+    int used = used_.load();
+    while (used <= i && !used_.compare_exchange_weak(used, i + 1)) {
+    }
+    return heartbeat {&slot};
+  }
+  return heartbeat {};
+}
+
+void
+watchdog::unwatch(heartbeat& hb) noexcept {
+  if (hb.slot_ == nullptr)
+    return;
+  hb.slot_->generation.fetch_add(2, std::memory_order_release);    // free
+  hb.slot_ = nullptr;
+}
+
+void
+watchdog::supervise() {
+  if (cpu_ >= 0 && !run_on_cpu(cpu_))
+    base::quick_exit(base::sprintf("watchdog error: run_on_cpu(%d)", cpu_).c_str());
+  base::nsec_t next = base::monotonic_now();
+  while (!stopping_.load(std::memory_order_relaxed)) {
+    next += base::nsec_t(period_us_) * 1000;
+    base::sleep_until(next);
+    std::int64_t const now = base::monotonic_now();
+    int const used = used_.load(std::memory_order_acquire);
+    for (int i = 0; i < used; ++i)
+      check(slots_[i], states_[i], now);
+  }
+}
+
+void
+watchdog::check(details::watchdog_slot& slot, state& s, std::int64_t now) {
+  std::uint32_t const generation = slot.generation.load(std::memory_order_acquire);
+  if (generation % 4 != 2)
+    return;                     // not watched
+  std::uint64_t const beats = slot.beats.load(std::memory_order_relaxed);
+  if (generation != s.generation || beats != s.beats) {
+    s.generation = generation;  // newly watched or alive
+    s.beats = beats;
+    s.since_ns = now;
+    s.stuck = false;
+    return;
+  }
+  if (s.stuck)
+    return;
+  /* unwatch() and watch() may refill the slot meanwhile: copy, then recheck */
+  ::pid_t const tid = slot.tid;
+  long const window_ns = slot.window_ns;
+  bool const escalate = slot.escalate;
+  char name[sizeof slot.name];
+  std::memcpy(name, slot.name, sizeof name);
+  name[sizeof name - 1] = '\0';
+  std::atomic_thread_fence(std::memory_order_acquire);
+  if (slot.generation.load(std::memory_order_relaxed) != generation)
+    return;
+  if (now - s.since_ns <= window_ns)
+    return;
+  s.stuck = true;
+  slot.missed.fetch_add(1, std::memory_order_relaxed);
+  misses_.fetch_add(1, std::memory_order_relaxed);
+  ::sched_param const param {0};
+  int const demoted = ::sched_setscheduler(tid, SCHED_OTHER, &param);
+  char line[160];
+  std::snprintf(line, sizeof line, "watchdog: thread '%s' (tid %d) missed its %ldus window%s\n",
+                name, int(tid), window_ns / 1000,
+                demoted == 0 ? ", demoted to SCHED_OTHER" : "");
+  if (escalate)
+    base::quick_exit(line);
+  (void)!::write(STDERR_FILENO, line, std::strlen(line));
+}
+} // preempt
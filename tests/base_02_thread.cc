@@ -33,6 +33,12 @@ int main(int argc, char *argv[])
   VERIFY(context);
   context.join();
   VERIFY(!context);
+  VERIFY(context.last_error().empty());
+
+  /* a failure is kept as an error number and formatted on demand */
+  auto invalid = base::thread(SCHED_FIFO, 1000, thread_function, argument);
+  VERIFY(!invalid && invalid.errnum == EINVAL);
+  VERIFY(invalid.last_error().find("pthread_attr_setschedparam()") == 0);
 
   return global_verify_flag() ? EXIT_SUCCESS : EXIT_FAILURE;
 }
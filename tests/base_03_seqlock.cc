@@ -0,0 +1,139 @@
+/* -*- coding: raw-text-unix; -*-
+ *
+ * Latest-value publication: base::seqlock and base::triple_buffer.
+ *
+ * Readers check that every snapshot is consistent. The writer measures its
+ * cost per store with 0, 1, 2 and 4 spinning readers, compared to a value
+ * guarded by std::mutex. For the lock-free primitives the cost should not grow
+ * with the number of readers.
+ */
+#include <base/chrono.h>
+#include <base/seqlock.h>
+#include <base/triple_buffer.h>
+#include <base/verify.h>
+
+#include <atomic>
+#include <iostream>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct sample {
+  long a, b, c;                 // b == -a, c == 2 * a
+};
+
+sample
+make_sample(long i) {
+  return sample {i, -i, 2 * i};
+}
+
+bool
+consistent(sample const& s) {
+  return s.b == -s.a && s.c == 2 * s.a;
+}
+
+struct mutex_value {
+  void store(sample const& s) { std::lock_guard<std::mutex> g {lock}; value = s; }
+  sample load() { std::lock_guard<std::mutex> g {lock}; return value; }
+  std::mutex lock;
+  sample value {};
+};
+
+int const writes = 100000;
+
+/**
+ * Run the writer with readers threads and return nanoseconds per store.
+ */
+template <typename Shared>
+double
+measure(char const* name, int readers) {
+  Shared shared;
+  std::atomic<bool> done {false};
+  std::vector<std::thread> threads;
+  for (int r = 0; r < readers; ++r) {
+    threads.emplace_back([&]() {
+      long last = 0;
+      while (!done.load(std::memory_order_relaxed)) {
+        sample s = shared.load();
+        VERIFY(consistent(s));
+        VERIFY(s.a >= last);    // never goes back in time
+        last = s.a;
+      }
+    });
+  }
+  base::benchmark bm;
+  bm.reset();
+  for (long i = 1; i <= writes; ++i)
+    shared.store(make_sample(i));
+  bm.stop();
+  done = true;
+  for (auto& t : threads)
+    t.join();
+  double const ns = double(bm.count()) / writes;
+  std::cerr << name << ": readers=" << readers << " store=" << ns << "ns" << std::endl;
+  return ns;
+}
+
+int
+main(int argc, char *argv[])
+{
+  /*********************************************
+   * base::seqlock
+   */
+  {
+    base::seqlock<sample> s;
+    VERIFY(s.version() == 1);
+    VERIFY(s.load().a == 0);
+    s.store(make_sample(7));
+    VERIFY(s.version() == 2);
+    sample x;
+    VERIFY(s.try_load(x) && x.a == 7 && consistent(x));
+    VERIFY(alignof(base::seqlock<char>) == CACHELINE_SIZE);
+  }
+
+  /*********************************************
+   * base::triple_buffer
+   */
+  {
+    base::triple_buffer<sample> t {make_sample(1)};
+    VERIFY(t.update() == false);
+    VERIFY(t.read_buffer().a == 1);
+    t.write(make_sample(2));
+    t.write(make_sample(3));
+    VERIFY(t.update());
+    VERIFY(t.read_buffer().a == 3);      // only the latest value
+    VERIFY(t.update() == false);
+    t.write_buffer() = make_sample(4);
+    t.publish();
+    VERIFY(t.read().a == 4);
+
+    /* one writer, one reader */
+    base::triple_buffer<sample> shared {make_sample(0)};
+    std::thread reader {[&]() {
+      long last = 0;
+      while (last < writes) {
+        sample const& s = shared.read();
+        VERIFY(consistent(s));
+        VERIFY(s.a >= last);
+        last = s.a;
+      }
+    }};
+    base::benchmark bm;
+    bm.reset();
+    for (long i = 1; i <= writes; ++i)
+      shared.write(make_sample(i));
+    bm.stop();
+    reader.join();
+    std::cerr << "triple_buffer: readers=1 store=" << double(bm.count()) / writes << "ns" << std::endl;
+  }
+
+  /*********************************************
+   * writer latency against number of readers
+   */
+  for (int readers : {0, 1, 2, 4}) {
+    measure<base::seqlock<sample>>("seqlock", readers);
+    measure<mutex_value>("std::mutex", readers);
+  }
+
+  return global_verify_flag() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
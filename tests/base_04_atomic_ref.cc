@@ -0,0 +1,113 @@
+/* -*- coding: raw-text-unix; -*-
+ *
+ * base::atomic_ref: atomic operations on plain objects without allocation.
+ */
+#include <base/utility.h>
+#include <base/verify.h>
+
+#include <thread>
+#include <vector>
+
+struct alignas(8) pair32 {
+  int first, second;
+};
+
+int counters[4];                // plain ints, no std::atomic
+
+void
+increment(int n) {
+  for (int i = 0; i < n; ++i) {
+    base::atomic_ref<int> {counters[0]}.fetch_add(1, std::memory_order_relaxed);
+    ++base::atomic_ref<int> {counters[1]};
+    base::atomic_ref<int> c {counters[2]};
+    int old = c.load(std::memory_order_relaxed);
+    while (!c.compare_exchange_weak(old, old + 2))
+      ;
+  }
+}
+
+int
+main(int argc, char *argv[])
+{
+  /*********************************************
+   * a reference is one pointer
+   */
+  static_assert(sizeof(base::atomic_ref<int>) == sizeof(int*), "not a plain pointer");
+  static_assert(base::atomic_ref<long>::is_always_lock_free, "long is lock-free");
+  static_assert(base::atomic_ref<pair32>::required_alignment == 8, "natural alignment");
+
+  /*********************************************
+   * load/store/exchange/compare_exchange
+   */
+  {
+    long x = 1;
+    base::atomic_ref<long> r {x};
+    VERIFY(r.is_lock_free());
+    VERIFY(r.load() == 1);
+    r.store(2, std::memory_order_release);
+    VERIFY(x == 2);
+    VERIFY(r.exchange(3) == 2 && x == 3);
+    long expected = 4;
+    VERIFY(!r.compare_exchange_strong(expected, 5) && expected == 3);
+    VERIFY(r.compare_exchange_strong(expected, 5) && x == 5);
+    r = 6;
+    VERIFY(long(r) == 6);
+  }
+
+  /*********************************************
+   * integral, pointer and floating-point arithmetic
+   */
+  {
+    unsigned u = 0xf0;
+    base::atomic_ref<unsigned> r {u};
+    VERIFY(r.fetch_add(0x10) == 0xf0 && u == 0x100);
+    VERIFY(r.fetch_sub(0x100) == 0x100 && u == 0);
+    VERIFY(r.fetch_or(0x3) == 0 && u == 0x3);
+    VERIFY(r.fetch_and(0x2) == 0x3 && u == 0x2);
+    VERIFY(r.fetch_xor(0x6) == 0x2 && u == 0x4);
+    VERIFY((r += 4) == 8 && (r -= 2) == 6);
+    VERIFY(r++ == 6 && ++r == 8 && r-- == 8 && --r == 6);
+    VERIFY((r |= 1) == 7 && (r &= 3) == 3 && (r ^= 1) == 2);
+
+    int array[8] {};
+    int* p = array;
+    base::atomic_ref<int*> rp {p};
+    VERIFY(rp.fetch_add(3) == array && p == array + 3);   // objects, not bytes
+    VERIFY(rp.fetch_sub(1) == array + 3 && p == array + 2);
+    VERIFY(++rp == array + 3);
+
+    double d = 1.5;
+    base::atomic_ref<double> rd {d};
+    VERIFY(rd.fetch_add(1.0) == 1.5 && d == 2.5);
+    VERIFY(rd.fetch_sub(0.5) == 2.5 && d == 2.0);
+  }
+
+  /*********************************************
+   * 8-byte struct
+   */
+  {
+    pair32 v {1, 2};
+    base::atomic_ref<pair32> r {v};
+    pair32 expected {1, 2};
+    VERIFY(r.compare_exchange_strong(expected, pair32 {3, 4}));
+    VERIFY(v.first == 3 && v.second == 4);
+    VERIFY(r.exchange(pair32 {5, 6}).first == 3 && r.load().second == 6);
+  }
+
+  /*********************************************
+   * concurrent updates
+   */
+  {
+    int const n = 100000;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < 4; ++i)
+      threads.emplace_back(increment, n);
+    for (auto& t : threads)
+      t.join();
+    VERIFY(counters[0] == 4 * n);
+    VERIFY(counters[1] == 4 * n);
+    VERIFY(counters[2] == 8 * n);
+  }
+
+  return global_verify_flag() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,114 @@
+/* -*- coding: raw-text-unix; -*-
+ *
+ * base::depends_on: lock-free parameter updates.
+ *
+ * Reader threads read the parameters in a loop and check that every snapshot
+ * is consistent while a writer replaces them at different frequencies. The
+ * mean read cost is reported per writer period; it should stay flat because
+ * readers never wait for the writer. At the end all replaced parameter sets
+ * must have been freed.
+ */
+#include <base/chrono.h>
+#include <base/idioms.h>
+#include <base/verify.h>
+
+#include <atomic>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <time.h>
+
+std::atomic<long> g_instances {0};
+
+/** Parameter set with a heap-allocated member and an instance counter. */
+struct gains {
+  gains() : gains {0} { }
+  explicit gains(long v) : table(8, v), version {v} { ++g_instances; }
+  gains(gains const& o) : table {o.table}, version {o.version} { ++g_instances; }
+  gains& operator = (gains const&) = default;
+  ~gains() { --g_instances; }
+
+  bool consistent() const {
+    for (long x : table)
+      if (x != version)
+        return false;
+    return true;
+  }
+
+  std::vector<long> table;
+  long version;
+};
+
+struct controller : base::depends_on<gains> { };
+
+/** CPU time of the calling thread, unaffected by preemption. */
+base::nsec_t
+thread_cputime() {
+  ::timespec ts;
+  ::clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+  return base::timespec_to_nsec(ts);
+}
+
+int
+main(int argc, char *argv[])
+{
+  {
+    controller c;
+    VERIFY(c.get_parameters().version == 0);
+    c.set_parameters(gains {1});
+    VERIFY(c.get_parameters().version == 1);
+    VERIFY(c.with_parameters([](gains const& g) { return g.table.size(); }) == 8);
+
+    /* nested read sections */
+    c.with_parameters([&c](gains const& outer) {
+      VERIFY(c.get_parameters().version == outer.version);
+      return 0;
+    });
+
+    /* writer period in microseconds, 0 = no writer */
+    for (long period : {0L, 1000L, 100L, 10L, 1L}) {
+      std::atomic<bool> done {false};
+      std::atomic<long> reads {0};
+      std::atomic<base::nsec_t> elapsed {0};
+      std::vector<std::thread> readers;
+      for (int r = 0; r < 2; ++r) {
+        readers.emplace_back([&]() {
+          long n = 0, last = 0;
+          base::nsec_t const t0 = thread_cputime();
+          while (!done.load(std::memory_order_relaxed)) {
+            long const v = c.with_parameters([](gains const& g) {
+              VERIFY(g.consistent());
+              return g.version;
+            });
+            VERIFY(v >= last);
+            last = v;
+            ++n;
+          }
+          elapsed += thread_cputime() - t0;
+          reads += n;
+        });
+      }
+      base::stopwatch sw;
+      long version = c.get_parameters().version;
+      while (sw.milliseconds() < 50) {
+        if (period) {
+          c.set_parameters(gains {++version});
+          std::this_thread::sleep_for(std::chrono::microseconds {period});
+        } else {
+          std::this_thread::sleep_for(std::chrono::milliseconds {1});
+        }
+      }
+      done = true;
+      for (auto& t : readers)
+        t.join();
+      std::cerr << "writer period=" << period << "us: "
+                << double(elapsed) / reads << "ns per read ("
+                << reads << " reads)" << std::endl;
+    }
+  }
+
+  VERIFY(g_instances == 0);
+
+  return global_verify_flag() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
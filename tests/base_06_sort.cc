@@ -0,0 +1,235 @@
+/* -*- coding: raw-text-unix; -*-
+ *
+ * base/sort.h: bounded-time sorting.
+ *
+ * Sorting networks are verified with all 0/1 inputs up to 16 elements (the
+ * 0-1 principle), heapsort and introsort against std::sort on several input
+ * patterns with a bound on the number of comparisons.
+ *
+ * The benchmark sorts each pattern many times and reports the fastest and
+ * slowest run per algorithm: the spread between them is what a worst-case
+ * execution time budget has to cover.
+ */
+#include <base/chrono.h>
+#include <base/sort.h>
+#include <base/verify.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <utility>
+#include <vector>
+
+std::mt19937 rng {42};
+
+enum pattern { random_values, sorted, reverse, organ_pipe, few_unique, patterns };
+char const* pattern_names[] = {"random", "sorted", "reverse", "organ pipe", "few unique"};
+
+std::vector<int>
+make_input(pattern p, std::size_t n) {
+  std::vector<int> v(n);
+  for (std::size_t i = 0; i < n; ++i) {
+    switch (p) {
+    case random_values: v[i] = int(rng()); break;
+    case sorted:        v[i] = int(i); break;
+    case reverse:       v[i] = int(n - i); break;
+    case organ_pipe:    v[i] = int(i < n / 2 ? i : n - i); break;
+    default:            v[i] = int(rng() % 4); break;
+    }
+  }
+  return v;
+}
+
+template <std::size_t N>
+bool
+network_sorts_all_binary_inputs() {
+  for (std::uint32_t bits = 0; bits < (1u << N); ++bits) {
+    std::array<int, N> v;
+    for (std::size_t i = 0; i < N; ++i)
+      v[i] = (bits >> i) & 1;
+    base::sort_network(v);
+    if (!std::is_sorted(v.begin(), v.end()))
+      return false;
+  }
+  return true;
+}
+
+template <std::size_t... N>
+void
+check_networks(std::index_sequence<N...>) {
+  bool const ok[] = {network_sorts_all_binary_inputs<N>()...};
+  for (bool b : ok)
+    VERIFY(b);
+}
+
+template <typename T, std::size_t N>
+void
+check_network4() {
+  std::array<std::array<T, N>, 4> v, expected;
+  for (int r = 0; r < 100; ++r) {
+    for (auto& a : v)
+      for (auto& x : a)
+        x = T(int(rng() % 1000) - 500);
+    expected = v;
+    for (auto& a : expected)
+      std::sort(a.begin(), a.end());
+    base::sort_network4(v);
+    VERIFY(v == expected);
+  }
+}
+
+struct stats {
+  base::nsec_t best = INT64_MAX, worst = 0;
+  void add(base::nsec_t ns) { best = std::min(best, ns); worst = std::max(worst, ns); }
+};
+
+template <typename Sort>
+stats
+measure(char const* name, std::size_t n, Sort sort) {
+  stats total;
+  std::cerr << name << " n=" << n << ":";
+  for (int p = 0; p < patterns; ++p) {
+    std::vector<int> const input = make_input(pattern(p), n);
+    stats s;
+    for (int r = 0; r < 50; ++r) {
+      std::vector<int> v = input;
+      base::stopwatch sw;
+      sort(v.begin(), v.end());
+      s.add(sw.nanoseconds());
+      VERIFY(std::is_sorted(v.begin(), v.end()));
+    }
+    std::cerr << " " << pattern_names[p] << "=" << s.best / 1000.0 << "us";
+    total.add(s.best);
+    total.add(s.worst);
+  }
+  std::cerr << " | best=" << total.best / 1000.0 << "us worst=" << total.worst / 1000.0
+            << "us" << std::endl;
+  return total;
+}
+
+int
+main(int argc, char *argv[])
+{
+  /*********************************************
+   * sorting networks
+   */
+  {
+    static_assert(base::network_size(0) == 0 && base::network_size(1) == 0, "trivial");
+    static_assert(base::network_size(2) == 1, "one comparator");
+    static_assert(base::network_size(4) == 5, "optimal for 4");
+    static_assert(base::network_size(8) == 19, "Batcher 8");
+    static_assert(base::network_size(16) == 63, "Batcher 16");
+
+    check_networks(std::make_index_sequence<17> {});
+
+    std::array<double, 40> d;
+    for (auto& x : d)
+      x = std::uniform_real_distribution<double> {-1, 1}(rng);
+    base::sort_network(d);
+    VERIFY(std::is_sorted(d.begin(), d.end()));
+
+    check_network4<int, 1>();
+    check_network4<int, 13>();
+    check_network4<int, 32>();
+    check_network4<float, 16>();
+    check_network4<float, 33>();
+  }
+
+  /*********************************************
+   * heapsort, introsort, insertion sort
+   */
+  for (std::size_t n : {0, 1, 2, 3, 16, 17, 100, 1000, 10000}) {
+    for (int p = 0; p < patterns; ++p) {
+      std::vector<int> const input = make_input(pattern(p), n);
+      std::vector<int> expected = input;
+      std::sort(expected.begin(), expected.end(), std::greater<int> {});
+
+      long comparisons = 0;
+      auto counting = [&comparisons](int a, int b) { ++comparisons; return a > b; };
+      double const nlogn = n * std::log2(n + 1.0);
+
+      std::vector<int> v = input;
+      base::heap_sort(v.begin(), v.end(), counting);
+      VERIFY(v == expected);
+      VERIFY(comparisons <= 2 * nlogn + n);
+
+      v = input;
+      comparisons = 0;
+      base::intro_sort(v.begin(), v.end(), counting);
+      VERIFY(v == expected);
+      VERIFY(comparisons <= 4 * nlogn + 16 * n);
+
+      if (n <= 1000) {
+        v = input;
+        base::insertion_sort(v.begin(), v.end(), std::greater<int> {});
+        VERIFY(v == expected);
+      }
+    }
+  }
+
+  /* default comparator, plain array */
+  {
+    int a[] = {3, 1, 2};
+    base::intro_sort(std::begin(a), std::end(a));
+    VERIFY(a[0] == 1 && a[1] == 2 && a[2] == 3);
+  }
+
+  /*********************************************
+   * best and worst case against std::sort
+   */
+  {
+    using it = std::vector<int>::iterator;
+    for (std::size_t n : {100, 10000}) {
+      measure("std::sort ", n, [](it f, it l) { std::sort(f, l); });
+      measure("intro_sort", n, [](it f, it l) { base::intro_sort(f, l); });
+      measure("heap_sort ", n, [](it f, it l) { base::heap_sort(f, l); });
+    }
+
+    /* 16 ints: network against std::sort, 1000 arrays per measurement */
+    std::vector<std::array<int, 16>> inputs(1000);
+    stats net, std_sort;
+    for (int r = 0; r < 20; ++r) {
+      for (auto& a : inputs) {
+        pattern const p = pattern(rng() % patterns);
+        std::vector<int> const v = make_input(p, 16);
+        std::copy(v.begin(), v.end(), a.begin());
+      }
+      std::vector<std::array<int, 16>> work = inputs;
+      base::stopwatch sw;
+      for (auto& a : work)
+        base::sort_network(a);
+      net.add(sw.nanoseconds());
+      for (auto& a : work)
+        VERIFY(std::is_sorted(a.begin(), a.end()));
+      work = inputs;
+      sw.stop();
+      for (auto& a : work)
+        std::sort(a.begin(), a.end());
+      std_sort.add(sw.nanoseconds());
+    }
+    /* four arrays per SIMD network */
+    base::nsec_t simd = 0;
+    for (int r = 0; r < 20; ++r) {
+      std::vector<std::array<std::array<int, 16>, 4>> batches(inputs.size() / 4);
+      for (std::size_t i = 0; i < inputs.size(); ++i)
+        batches[i / 4][i % 4] = inputs[i];
+      base::stopwatch sw;
+      for (auto& b : batches)
+        base::sort_network4(b);
+      simd += sw.nanoseconds();
+      for (auto& b : batches)
+        for (auto& a : b)
+          VERIFY(std::is_sorted(a.begin(), a.end()));
+    }
+    std::cerr << "16 ints: sort_network4=" << simd / 20 / 1000.0 << "ns per array" << std::endl;
+    std::cerr << "16 ints: sort_network=" << net.best / 1000.0 << ".." << net.worst / 1000.0
+              << "ns std::sort=" << std_sort.best / 1000.0 << ".." << std_sort.worst / 1000.0
+              << "ns" << std::endl;
+  }
+
+  return global_verify_flag() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,210 @@
+/* -*- coding: raw-text-unix; -*-
+ *
+ * base/random.h: generators and workloads.
+ *
+ * The generators are checked against reference outputs, the SSE2 bulk fill
+ * against the scalar generator and the workloads for reproducibility. The
+ * adversarial workload must drive base::intro_sort's quicksort phase into
+ * many more comparisons than random input, but not beyond its O(n log n)
+ * bound. Finally the cost per number is compared to rand()
+ * and std::mt19937_64.
+ */
+#include <base/chrono.h>
+#include <base/random.h>
+#include <base/sort.h>
+#include <base/verify.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <thread>
+#include <vector>
+
+template <typename F>
+void
+benchmark(char const* name, F f) {
+  int const n = 1000000;
+  std::uint64_t sum = 0;
+  base::stopwatch sw;
+  for (int i = 0; i < n; ++i)
+    sum += f();
+  double const ns = double(sw.nanoseconds()) / n;
+  std::cerr << name << ": " << ns << "ns per number (" << (sum & 1) << ")" << std::endl;
+}
+
+template <typename Sort>
+long
+comparisons(std::vector<int> v, Sort sort) {
+  long count = 0;
+  sort(v.begin(), v.end(), [&count](int a, int b) { ++count; return a < b; });
+  VERIFY(std::is_sorted(v.begin(), v.end()));
+  return count;
+}
+
+int
+main(int argc, char *argv[])
+{
+  /*********************************************
+   * reference outputs
+   */
+  {
+    base::splitmix64 sm {0};
+    VERIFY(sm() == 0xe220a8397b1dcdafull);
+    VERIFY(sm() == 0x6e789e6aa1b965f4ull);
+
+    base::pcg32 pcg {42, 54};           // pcg32-demo of the reference library
+    VERIFY(pcg() == 0xa15c02b7);
+    VERIFY(pcg() == 0x7b47f409);
+    VERIFY(pcg() == 0xba1d3330);
+
+    base::xoshiro256ss a {7}, b {7}, c {8};
+    VERIFY(a() == b() && a() != c());
+  }
+
+  /*********************************************
+   * bulk fill interleaves four jumped generators
+   */
+  for (std::size_t n : {0, 1, 5, 8, 1001}) {
+    base::xoshiro256ss_x4 bulk {3};
+    std::vector<std::uint64_t> out(n);
+    bulk.fill(out.data(), n);
+    base::xoshiro256ss lanes[4] = {base::xoshiro256ss {3}, base::xoshiro256ss {3},
+                                   base::xoshiro256ss {3}, base::xoshiro256ss {3}};
+    for (int k = 1; k < 4; ++k)
+      for (int j = k; j < 4; ++j)
+        lanes[j].jump();
+    for (std::size_t i = 0; i < n; ++i)
+      VERIFY(out[i] == lanes[i % 4]());
+    /* the rest of a partial group is skipped */
+    for (std::size_t i = n; i % 4; ++i)
+      lanes[i % 4]();
+    std::uint64_t next[4];
+    bulk.fill(next, 4);
+    for (int k = 0; k < 4; ++k)
+      VERIFY(next[k] == lanes[k]());
+  }
+
+  /*********************************************
+   * distributions
+   */
+  {
+    base::xoshiro256ss rng {1};
+    int histogram[10] {};
+    for (int i = 0; i < 100000; ++i) {
+      std::uint32_t const x = base::uniform(rng, 10);
+      VERIFY(x < 10);
+      ++histogram[x];
+      double const d = base::uniform_real(rng);
+      VERIFY(d >= 0 && d < 1);
+    }
+    for (int h : histogram)
+      VERIFY(std::abs(h - 10000) < 1000);
+
+    base::pcg32 p;
+    VERIFY(base::uniform(p, 1) == 0);
+    std::uniform_int_distribution<int> dice {1, 6};     // works with <random>
+    int const roll = dice(rng);
+    VERIFY(roll >= 1 && roll <= 6);
+  }
+
+  /*********************************************
+   * per-thread generators
+   */
+  {
+    std::uint64_t first[2];
+    std::thread t0 {[&]() { first[0] = base::thread_rng()(); }};
+    t0.join();
+    std::thread t1 {[&]() { first[1] = base::thread_rng()(); }};
+    t1.join();
+    VERIFY(first[0] != first[1]);
+
+    base::seed_thread_rng(99);
+    std::uint64_t const x = base::thread_rng()();
+    base::seed_thread_rng(99);
+    VERIFY(base::thread_rng()() == x);
+  }
+
+  /*********************************************
+   * workloads
+   */
+  {
+    std::vector<int> v(100), w(100);
+    for (auto wl : {base::workload::random, base::workload::few_unique}) {
+      base::generate_workload(v.begin(), v.end(), wl, 5);
+      base::generate_workload(w.begin(), w.end(), wl, 5);
+      VERIFY(v == w);
+      base::generate_workload(w.begin(), w.end(), wl, 6);
+      VERIFY(v != w);
+    }
+    base::generate_workload(v.begin(), v.end(), base::workload::sorted);
+    VERIFY(std::is_sorted(v.begin(), v.end()));
+    base::generate_workload(v.begin(), v.end(), base::workload::reverse);
+    VERIFY(std::is_sorted(v.rbegin(), v.rend()));
+    base::generate_workload(v.begin(), v.end(), base::workload::few_unique);
+    VERIFY(*std::max_element(v.begin(), v.end()) <= 3);
+    base::generate_workload(v.begin(), v.end(), base::workload::sawtooth);
+    VERIFY(*std::max_element(v.begin(), v.end()) == 9);
+    VERIFY(std::string {base::to_string(base::workload::organ_pipe)} == "organ pipe");
+
+    /* adversary against the median-of-three quicksort of intro_sort */
+    std::size_t const n = 10000;
+    auto const quicksort = [](std::vector<int>::iterator f, std::vector<int>::iterator l,
+                              std::function<bool(int, int)> c) {
+      base::intro_sort(f, l, c);
+    };
+    std::vector<int> const killer = base::adversarial_workload(n, quicksort);
+    VERIFY(killer.size() == n);
+    std::vector<int> random(n);
+    base::generate_workload(random.begin(), random.end(), base::workload::random);
+    long const on_random = comparisons(random, quicksort);
+    long const on_killer = comparisons(killer, quicksort);
+    long const heap = comparisons(killer, [](std::vector<int>::iterator f,
+                                             std::vector<int>::iterator l,
+                                             std::function<bool(int, int)> c) {
+      base::heap_sort(f, l, c);
+    });
+    double const nlogn = n * std::log2(double(n));
+    std::cerr << "intro_sort comparisons: random=" << on_random << " adversarial=" << on_killer
+              << " heap_sort adversarial=" << heap << std::endl;
+    VERIFY(on_killer > on_random);
+    VERIFY(on_killer <= 4 * nlogn + 16 * n);
+  }
+
+  /*********************************************
+   * cost per number
+   */
+  {
+    std::srand(1);
+    benchmark("rand()           ", []() { return std::uint64_t(std::rand()); });
+    std::mt19937_64 mt {1};
+    benchmark("std::mt19937_64  ", [&mt]() { return mt(); });
+    base::xoshiro256ss x {1};
+    benchmark("xoshiro256**     ", [&x]() { return x(); });
+    base::pcg32 p {1};
+    benchmark("pcg32            ", [&p]() { return std::uint64_t(p()); });
+    auto& t = base::thread_rng();
+    benchmark("thread_rng()     ", [&t]() { return t(); });
+
+    /* into memory: scalar loop against bulk fill, 8KiB stays in L1 */
+    base::xoshiro256ss_x4 x4 {1};
+    std::vector<std::uint64_t> buffer(1024);
+    base::nsec_t scalar = 0, bulk = 0;
+    for (int r = 0; r < 1000; ++r) {
+      base::stopwatch sw;
+      for (auto& b : buffer)
+        b = x();
+      scalar += sw.nanoseconds();
+      sw.stop();
+      x4.fill(buffer.data(), buffer.size());
+      bulk += sw.nanoseconds();
+    }
+    std::cerr << "xoshiro256** store: " << double(scalar) / (1000 * buffer.size())
+              << "ns per number, fill: " << double(bulk) / (1000 * buffer.size())
+              << "ns per number" << std::endl;
+  }
+
+  return global_verify_flag() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,143 @@
+/* -*- coding: raw-text-unix; -*-
+ *
+ * base/string.h: formatting and tokenizing without allocation.
+ *
+ * Checks static_string, format_to() and tokenizer as well as the fixed join()
+ * and split(). A replaced global operator new counts allocations: the new
+ * functions must not allocate at all. The benchmark compares them with
+ * base::sprintf() and base::split().
+ */
+#include <base/chrono.h>
+#include <base/string.h>
+#include <base/verify.h>
+
+#include <atomic>
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <string>
+#include <vector>
+
+std::atomic<long> g_allocations {0};
+
+void*
+operator new(std::size_t size) {
+  ++g_allocations;
+  if (void* p = std::malloc(size ? size : 1))
+    return p;
+  throw std::bad_alloc {};
+}
+
+void
+operator delete(void* p) noexcept {
+  std::free(p);
+}
+
+void
+operator delete(void* p, std::size_t) noexcept {
+  std::free(p);
+}
+
+int
+main(int argc, char *argv[])
+{
+  /*********************************************
+   * fixed functions
+   */
+  {
+    VERIFY(base::join({"a", "b", "c"}) == "a b c");
+    VERIFY(base::join({"a", "b"}, ',') == "a,b");
+    VERIFY(base::join({}).empty());
+
+    auto v = base::split(" a  b c ");
+    VERIFY(v.size() == 3 && v[0] == "a" && v[2] == "c");
+    VERIFY(base::split("").empty());
+
+    std::string s = base::sprintf("%d-%s", 42, "x");
+    VERIFY(s == "42-x" && s.size() == 4);       // no trailing '\0'
+    std::string long_s = base::sprintf("%300d", 1);
+    VERIFY(long_s.size() == 300 && long_s.back() == '1');
+  }
+
+  /*********************************************
+   * no allocations
+   */
+  {
+    long const before = g_allocations;
+
+    base::static_string<16> s {"abc"};
+    VERIFY(s.size() == 3 && !s.truncated() && s.capacity() == 16);
+    s += '-';
+    s += base::string_view {"def"};
+    VERIFY(base::string_view {s} == "abc-def");
+    VERIFY(base::format_to(s, "%d", 12345) == 5);
+    VERIFY(base::string_view {s} == "abc-def12345");
+    VERIFY(base::format_to(s, "%s", "too long") == 4 && s.truncated());
+    VERIFY(base::string_view {s.c_str()} == "abc-def12345too ");
+    s.clear();
+    VERIFY(s.empty() && !s.truncated() && s.c_str()[0] == '\0');
+
+    char buffer[8];
+    VERIFY(base::format_to(buffer, sizeof buffer, "%d", 42) == 2);
+    VERIFY(base::format_to(buffer, sizeof buffer, "%d", 123456789) == 7);
+    VERIFY(base::string_view {buffer} == "1234567");
+
+    base::string_view tokens[4];
+    int n = 0;
+    for (base::string_view t : base::tokenizer {",0-3,,8,12-15,", ','})
+      tokens[n++] = t;
+    VERIFY(n == 3 && tokens[0] == "0-3" && tokens[1] == "8" && tokens[2] == "12-15");
+    base::tokenizer empty {"   "};
+    VERIFY(empty.begin() == empty.end());
+
+    VERIFY(g_allocations == before);
+  }
+
+  /*********************************************
+   * against the allocating functions
+   */
+  {
+    int const n = 100000;
+    std::string const line = "cpu0 1234 56 7890 12 0 3 0 0 0";
+    std::size_t sum = 0;
+
+    long a0 = g_allocations;
+    base::stopwatch sw;
+    for (int i = 0; i < n; ++i)
+      sum += base::sprintf("deadline=%ldus used=%ldus", 1000L, long(i)).size();
+    double const sprintf_ns = double(sw.nanoseconds()) / n;
+    long const sprintf_allocs = g_allocations - a0;
+
+    a0 = g_allocations;
+    sw.stop();
+    for (int i = 0; i < n; ++i) {
+      base::static_string<64> s;
+      sum += base::format_to(s, "deadline=%ldus used=%ldus", 1000L, long(i));
+    }
+    double const format_ns = double(sw.nanoseconds()) / n;
+    VERIFY(g_allocations == a0);
+
+    a0 = g_allocations;
+    sw.stop();
+    for (int i = 0; i < n; ++i)
+      sum += base::split(line).size();
+    double const split_ns = double(sw.nanoseconds()) / n;
+    long const split_allocs = g_allocations - a0;
+
+    a0 = g_allocations;
+    sw.stop();
+    for (int i = 0; i < n; ++i)
+      for (base::string_view t : base::tokenizer {line})
+        sum += t.size();
+    double const tokenizer_ns = double(sw.nanoseconds()) / n;
+    VERIFY(g_allocations == a0);
+
+    std::cerr << "sprintf: " << sprintf_ns << "ns, " << double(sprintf_allocs) / n
+              << " allocations; format_to: " << format_ns << "ns" << std::endl;
+    std::cerr << "split: " << split_ns << "ns, " << double(split_allocs) / n
+              << " allocations; tokenizer: " << tokenizer_ns << "ns (" << sum % 10 << ")"
+              << std::endl;
+  }
+
+  return global_verify_flag() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -47,7 +47,7 @@ int main(int argc, char *argv[])
     if (handle[i]) {
       handle[i].join();
     } else {
-      std::cerr << handle[i].last_error << std::endl;
+      std::cerr << handle[i].last_error() << std::endl;
       return EXIT_FAILURE;
     }
   }
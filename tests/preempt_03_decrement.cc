@@ -79,7 +79,7 @@ run(int (&priority_table)[N])
     if (context[i].joinable) {
       continue;
     } else {
-      std::cerr << context[i].last_error << std::endl;
+      std::cerr << context[i].last_error() << std::endl;
       exit(EXIT_FAILURE);
     }
     VERIFY(context[i]);
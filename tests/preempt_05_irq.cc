@@ -0,0 +1,105 @@
+/*
+ * Steer IRQs away from real-time CPUs
+ *
+ * Builds a fake procfs tree with a few IRQs, moves them off CPUs 2 and 3 and
+ * restores the original affinities. IRQ 9 has a smp_affinity_list that cannot
+ * be accessed and must be reported instead of silently skipped.
+ */
+#include <preempt/irq.h>
+
+#include <base/verify.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include <ftw.h>
+
+std::string root;
+
+std::string
+affinity_path(int irq) {
+  return root + "/irq/" + std::to_string(irq) + "/smp_affinity_list";
+}
+
+void
+make_irq(int irq, char const* cpus) {
+  ::mkdir((root + "/irq/" + std::to_string(irq)).c_str(), 0755);
+  std::ofstream {affinity_path(irq)} << cpus;
+}
+
+std::string
+read_affinity(int irq) {
+  std::string s;
+  VERIFY(base::read_text_file(affinity_path(irq), s));
+  return s;
+}
+
+int
+main(int argc, char *argv[])
+{
+  /*********************************************
+   * base::parse_cpu_list and base::format_cpu_list
+   */
+  {
+    std::vector<int> cpus;
+    VERIFY(base::parse_cpu_list("0-3,8,10-11\n", cpus));
+    VERIFY((cpus == std::vector<int> {0, 1, 2, 3, 8, 10, 11}));
+    VERIFY(base::format_cpu_list(cpus) == "0-3,8,10-11");
+    VERIFY(base::format_cpu_list({5, 4, 4, 1}) == "1,4-5");
+    VERIFY(!base::parse_cpu_list("1-x", cpus));
+    VERIFY(!base::parse_cpu_list("3-1", cpus));
+  }
+
+  /*********************************************
+   * fake /proc/irq tree
+   */
+  char tmpl[] = "/tmp/libpreempt-irq-XXXXXX";
+  VERIFY(::mkdtemp(tmpl));
+  root = tmpl;
+  ::mkdir((root + "/irq").c_str(), 0755);
+  std::ofstream {root + "/irq/default_smp_affinity"} << "f\n";
+
+  struct { int irq; char const* cpus; } const tree[] {
+    {0, "0-3\n"},               // spans RT and housekeeping CPUs
+    {1, "2\n"},                 // only an RT CPU
+    {7, "0-1\n"},               // already off the RT CPUs
+    {8, "3\n"},
+  };
+  for (auto const& t : tree)
+    make_irq(t.irq, t.cpus);
+  /* not writable even for root */
+  ::mkdir((root + "/irq/9").c_str(), 0755);
+  ::mkdir(affinity_path(9).c_str(), 0755);
+
+  preempt::irq_steering irqs {root};
+  irqs.set_housekeeping_cpus({0, 1});
+
+  VERIFY((irqs.irqs() == std::vector<int> {0, 1, 7, 8, 9}));
+
+  VERIFY(irqs.steer_away({2, 3}) == false);
+  VERIFY(irqs.failures().size() == 1 && irqs.failures()[0].irq == 9);
+  VERIFY(irqs.saved().size() == 3);
+
+  VERIFY(read_affinity(0) == "0-1\n");
+  VERIFY(read_affinity(1) == "0-1\n");
+  VERIFY(read_affinity(7) == "0-1\n");
+  VERIFY(read_affinity(8) == "0-1\n");
+
+  /* steering twice keeps the original affinity */
+  irqs.steer_away({1, 2, 3});
+  VERIFY(read_affinity(0) == "0\n");
+  VERIFY(irqs.saved().size() == 4);
+
+  VERIFY(irqs.restore());
+  VERIFY(irqs.saved().empty());
+  for (auto const& t : tree)
+    VERIFY(read_affinity(t.irq) == t.cpus);
+
+  ::nftw(tmpl, [](char const* path, struct stat const*, int, struct FTW*) {
+    return ::remove(path);
+  }, 8, FTW_DEPTH | FTW_PHYS);
+
+  return global_verify_flag() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
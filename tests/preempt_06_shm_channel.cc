@@ -0,0 +1,179 @@
+/*
+ * Lock-free shared memory channel between processes
+ *
+ * The parent process is the (real-time) producer, a forked child process the
+ * consumer. The child reports latency and throughput of the channel and fails
+ * unless all messages arrive in order. A second child attaches and dies without
+ * detaching; the parent must notice the crashed peer.
+ */
+#include <preempt/process.h>
+#include <preempt/shm_channel.h>
+
+#include <base/chrono.h>
+#include <base/verify.h>
+
+#include <algorithm>
+#include <iostream>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#include <sys/wait.h>
+#include <time.h>
+
+using preempt::shm_channel;
+
+struct message {
+  std::uint64_t seq;
+  base::nsec_t sent;
+};
+
+base::nsec_t
+now() {
+  ::timespec ts;
+  ::clock_gettime(CLOCK_MONOTONIC, &ts);
+  return base::timespec_to_nsec(ts);
+}
+
+std::string
+channel_name(char const* tag) {
+  return std::string {"/libpreempt-"} + tag + "-" + std::to_string(::getpid());
+}
+
+int
+consume(std::string const& name, std::uint64_t count, char const* label) {
+  shm_channel ch {name, shm_channel::consumer};
+  if (!ch) {
+    std::cerr << ch.last_error() << std::endl;
+    return EXIT_FAILURE;
+  }
+  base::nsec_t min = 1e9, max = 0, sum = 0, first = 0;
+  for (std::uint64_t i = 0; i < count; ) {
+    message m;
+    if (!ch.try_pop(&m, sizeof m)) {
+      if (!ch.wait(100000) && !ch.peer_alive())
+        return EXIT_FAILURE;
+      continue;
+    }
+    base::nsec_t const dt = now() - m.sent;
+    if (m.seq != i)
+      return EXIT_FAILURE;
+    if (i == 0)
+      first = m.sent;
+    min = std::min(min, dt);
+    max = std::max(max, dt);
+    sum += dt;
+    ++i;
+  }
+  double const seconds = base::nsec_to_sec(now() - first);
+  std::cerr << label << " latency: min=" << base::nsec_to_usec(min) << "us"
+            << " mean=" << base::nsec_to_usec(sum / count) << "us"
+            << " max=" << base::nsec_to_usec(max) << "us" << std::endl;
+  std::cerr << label << " throughput: " << count / seconds << " messages/s" << std::endl;
+  return EXIT_SUCCESS;
+}
+
+int
+main(int argc, char *argv[])
+{
+  /*********************************************
+   * one process: ring semantics
+   */
+  {
+    auto const name = channel_name("ring");
+    shm_channel p {name, shm_channel::producer, sizeof(int), 3};
+    VERIFY(p);
+    VERIFY(p.capacity() == 4);
+    shm_channel c {name, shm_channel::consumer};
+    VERIFY(c);
+    VERIFY(c.peer_alive() && p.peer_alive());
+
+    /* a second consumer is refused while the first one lives */
+    shm_channel c2 {name, shm_channel::consumer};
+    VERIFY(!c2);
+
+    for (int round = 0; round < 3; ++round) {
+      for (int i = 0; i < 4; ++i)
+        VERIFY(p.try_push(&i, sizeof i));
+      VERIFY(!p.try_push(&round, sizeof round));
+      VERIFY(c.size() == 4);
+      for (int i = 0; i < 4; ++i) {
+        int x = -1;
+        std::size_t n = 0;
+        VERIFY(c.try_pop(&x, sizeof x, &n) && x == i && n == sizeof x);
+      }
+      VERIFY(c.peek() == nullptr);
+      VERIFY(!c.wait(0));
+    }
+    VERIFY(p.overruns() == 3);
+
+    /* zero-copy slots hold any type */
+    void* slot = p.reserve();
+    VERIFY(reinterpret_cast<std::uintptr_t>(slot) % alignof(std::max_align_t) == 0);
+    p.commit(0);
+    VERIFY(reinterpret_cast<std::uintptr_t>(c.peek()) % alignof(std::max_align_t) == 0);
+    c.release();
+  }
+
+  /* the slot size has to fit the channel's 32-bit header fields */
+  {
+    shm_channel p {channel_name("huge"), shm_channel::producer, std::size_t(1) << 32, 1};
+    VERIFY(!p && !p.last_error().empty());
+  }
+
+  /*********************************************
+   * crashed consumer
+   */
+  {
+    auto const name = channel_name("crash");
+    shm_channel p {name, shm_channel::producer, 16, 16};
+    VERIFY(p);
+    VERIFY(!p.peer_alive());
+    pid_t child = ::fork();
+    if (child == 0) {
+      new shm_channel {name, shm_channel::consumer}; // never detaches
+      ::_exit(EXIT_SUCCESS);
+    }
+    ::waitpid(child, nullptr, 0);
+    VERIFY(!p.peer_alive());
+    shm_channel c {name, shm_channel::consumer}; // takes over
+    VERIFY(c);
+    VERIFY(p.peer_alive());
+  }
+
+  /*********************************************
+   * benchmark: producer in this process, consumer in a child
+   */
+  for (auto wakeup : {shm_channel::wakeup::futex, shm_channel::wakeup::eventfd}) {
+    std::uint64_t const count = 20000;
+    auto const name = channel_name("bench");
+    shm_channel p {name, shm_channel::producer, sizeof(message), 256, wakeup};
+    if (!p) {
+      std::cerr << p.last_error() << std::endl;
+      return EXIT_FAILURE;
+    }
+    pid_t child = ::fork();
+    if (child == 0)
+      ::_exit(consume(name, count, wakeup == shm_channel::wakeup::futex ? "futex" : "eventfd"));
+
+    preempt::this_process::begin_realtime();
+    for (std::uint64_t i = 0; i < count; ) {
+      if (void* slot = p.reserve()) {
+        message m {i++, now()};
+        std::memcpy(slot, &m, sizeof m);
+        p.commit(sizeof m);
+        p.notify();
+      } else {
+        base::yield();
+      }
+    }
+    preempt::this_process::end_realtime();
+
+    int status = -1;
+    ::waitpid(child, &status, 0);
+    VERIFY(WIFEXITED(status) && WEXITSTATUS(status) == EXIT_SUCCESS);
+  }
+
+  return global_verify_flag() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,139 @@
+/* -*- coding: raw-text-unix; -*-
+ *
+ * preempt::tracing: binary tracepoints.
+ *
+ * Three threads record events into a trace file which is decoded as text
+ * and as Chrome trace JSON; the decoded events must be complete and ordered
+ * by time. Then the cost per tracepoint is measured with recording stopped
+ * and running. The trace_marker mirror is only exercised if ftrace is
+ * accessible.
+ */
+#include <preempt/tracepoint.h>
+#include <base/chrono.h>
+#include <base/verify.h>
+
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+namespace tracing = preempt::tracing;
+
+enum { EV_BEGIN = 1, EV_END, EV_BENCH };
+
+int
+main(int argc, char *argv[])
+{
+  char path[] = "/tmp/preempt_07_tracepoint.XXXXXX";
+  int fd = ::mkstemp(path);
+  VERIFY(fd != -1);
+  ::close(fd);
+
+  tracing::define(EV_BEGIN, "begin");
+  tracing::define(EV_END, "end");
+  tracing::define(EV_BENCH, "bench \"quoted\"");
+
+  /*********************************************
+   * record and decode
+   */
+  {
+    PREEMPT_TRACEPOINT(EV_BEGIN, 0);    // not recording: ignored
+    VERIFY(!tracing::active());
+    VERIFY(tracing::start(path, 1));
+    VERIFY(tracing::active());
+    VERIFY(!tracing::start(path));
+    VERIFY(!tracing::last_error().empty());
+
+    auto const work = [](int n) {
+      tracing::register_thread();
+      for (int i = 0; i < n; ++i) {
+        PREEMPT_TRACEPOINT(EV_BEGIN, i);
+        PREEMPT_TRACEPOINT(EV_END, i);
+      }
+    };
+    std::thread t1 {work, 500}, t2 {work, 500};
+    work(1000);
+    t1.join();
+    t2.join();
+    PREEMPT_TRACEPOINT(999, 42);        // id without a name
+    tracing::stop();
+    VERIFY(!tracing::active());
+    VERIFY(tracing::dropped() == 0);
+
+    std::ostringstream text;
+    VERIFY(tracing::decode(path, text) == 4001);
+    std::istringstream lines {text.str()};
+    std::string line;
+    std::getline(lines, line);
+    VERIFY(line.find("# 4001 events, 0 dropped") == 0);
+    int begins = 0, ends = 0, unnamed = 0;
+    double last = 0;
+    while (std::getline(lines, line)) {
+      double const t = std::stod(line);
+      VERIFY(t >= last);
+      last = t;
+      begins += line.find(" begin ") != std::string::npos;
+      ends += line.find(" end ") != std::string::npos;
+      unnamed += line.find(" event999 payload=42") != std::string::npos;
+    }
+    VERIFY(begins == 2000 && ends == 2000 && unnamed == 1);
+
+    std::ostringstream json;
+    VERIFY(tracing::decode(path, json, tracing::format::chrome) == 4001);
+    std::string const s = json.str();
+    VERIFY(s.find("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[") == 0);
+    VERIFY(std::count(s.begin(), s.end(), '\n') == 4003);
+
+    std::ostringstream none;
+    VERIFY(tracing::decode("/nonexistent", none) == -1);
+  }
+
+  /*********************************************
+   * cost per tracepoint
+   */
+  {
+    int const n = 4000;           // fits into a ring, nothing is dropped
+    int const rounds = 50;
+    base::nsec_t off = 0, on = 0;
+    for (int r = 0; r < rounds; ++r) {
+      base::stopwatch sw;
+      for (int i = 0; i < n; ++i)
+        PREEMPT_TRACEPOINT(EV_BENCH, i);
+      off += sw.nanoseconds();
+    }
+    VERIFY(tracing::start(path, 1000));
+    for (int r = 0; r < rounds; ++r) {
+      base::stopwatch sw;
+      for (int i = 0; i < n; ++i)
+        PREEMPT_TRACEPOINT(EV_BENCH, i);
+      on += sw.nanoseconds();
+      tracing::flush();
+    }
+    tracing::stop();
+    VERIFY(tracing::dropped() == 0);
+    std::ostringstream text;
+    VERIFY(tracing::decode(path, text) == n * rounds);
+    std::cerr << "tracepoint: stopped=" << double(off) / (n * rounds)
+              << "ns recording=" << double(on) / (n * rounds) << "ns" << std::endl;
+  }
+
+  /*********************************************
+   * ftrace trace_marker
+   */
+  if (tracing::start(path, 10, true)) {
+    PREEMPT_TRACEPOINT(EV_BEGIN, 1);
+    tracing::stop();
+    std::ostringstream text;
+    VERIFY(tracing::decode(path, text) == 1);
+  } else {
+    std::cerr << "trace_marker: " << tracing::last_error() << std::endl;
+  }
+
+  ::unlink(path);
+
+  return global_verify_flag() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
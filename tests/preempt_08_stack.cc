@@ -0,0 +1,164 @@
+/*
+ * Right-sized thread stacks
+ *
+ * Threads get a stack of 64KiB instead of the default 8MiB. The peak usage of
+ * a thread that uses about 16KiB is measured with the watermark and must be
+ * found in the report with a smaller suggested size. A prefaulted stack takes
+ * no page faults when the thread uses it. preempt::thread must still take
+ * member functions and move-only arguments like std::thread.
+ */
+#include <preempt/thread.h>
+#include <preempt/task.h>
+
+#include <base/threading.h>
+#include <base/verify.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+
+#include <sys/resource.h>
+
+std::size_t const stack_size = 64 * 1024;
+
+struct attributes {
+  std::size_t size = 0;
+  std::size_t guard = 0;
+};
+
+attributes
+current_attributes() {
+  attributes a;
+  pthread_attr_t attr;
+  if (pthread_getattr_np(pthread_self(), &attr) == 0) {
+    pthread_attr_getstacksize(&attr, &a.size);
+    pthread_attr_getguardsize(&attr, &a.guard);
+    pthread_attr_destroy(&attr);
+  }
+  return a;
+}
+
+__attribute__((noinline))
+int
+use_stack(std::size_t bytes) {
+  volatile char buffer[1024];
+  std::memset(const_cast<char*>(buffer), int(bytes), sizeof buffer);
+  return bytes > sizeof buffer ? use_stack(bytes - sizeof buffer) + buffer[7] : buffer[3];
+}
+
+long
+minor_faults() {
+  struct rusage ru;
+  getrusage(RUSAGE_THREAD, &ru);
+  return ru.ru_minflt;
+}
+
+void*
+base_thread_function(void* argp) {
+  *static_cast<attributes*>(argp) = current_attributes();
+  return nullptr;
+}
+
+struct worker {
+  int calls = 0;
+  void run(std::unique_ptr<int> p, int n) { calls = *p + n; }
+};
+
+struct measured_task : preempt::critical_task<1000000> {
+  void run() override { use_stack(8 * 1024); }
+};
+
+int
+main(int argc, char *argv[])
+{
+  /*********************************************
+   * size, guard and peak usage
+   */
+  {
+    base::stack_options stack;
+    stack.size = stack_size;
+    stack.guard = 2 * 4096;
+    stack.watermark = true;
+    attributes a;
+    preempt::thread thr {stack, [&a]() {
+      pthread_setname_np(pthread_self(), "use16k");
+      a = current_attributes();
+      use_stack(16 * 1024);
+    }};
+    VERIFY(thr.get_id() != preempt::thread::id {});
+    thr.join();
+    VERIFY(thr.get_id() == preempt::thread::id {});
+    VERIFY(a.size == stack_size);
+    VERIFY(a.guard == stack.guard);
+    std::size_t const peak = thr.stack_high_water_mark();
+    std::cerr << "peak: " << peak << " bytes" << std::endl;
+    VERIFY(peak >= 16 * 1024 && peak < stack_size);
+
+    bool found = false;
+    for (auto const& u : preempt::stack_usages()) {
+      if (std::strcmp(u.name, "use16k") == 0) {
+        found = true;
+        VERIFY(u.peak == peak && u.size == stack_size);
+        VERIFY(u.suggested_size() >= 2 * peak && u.suggested_size() < u.size);
+      }
+    }
+    VERIFY(found);
+  }
+
+  /*********************************************
+   * prefaulted stack takes no page faults
+   */
+  {
+    long faults[2];
+    for (int prefault = 0; prefault < 2; ++prefault) {
+      base::stack_options stack;
+      stack.size = 256 * 1024;
+      stack.prefault = prefault;
+      preempt::thread thr {stack, [&faults, prefault]() {
+        long const before = minor_faults();
+        use_stack(128 * 1024);
+        faults[prefault] = minor_faults() - before;
+      }};
+      thr.join();
+      VERIFY(thr.stack_high_water_mark() == 0);
+    }
+    std::cerr << "page faults using 128KiB of stack: " << faults[0] << ", prefaulted: "
+              << faults[1] << std::endl;
+    VERIFY(faults[1] < faults[0]);
+  }
+
+  /*********************************************
+   * base::thread and tasks
+   */
+  {
+    base::stack_options stack;
+    stack.size = stack_size;
+    attributes a;
+    base::thread thr {SCHED_OTHER, 0, stack, base_thread_function, &a};
+    VERIFY(thr);
+    thr.join();
+    VERIFY(a.size == stack_size);
+
+    stack.watermark = true;
+    measured_task task;
+    task.start(1, stack);
+    task.join();
+  }
+
+  /*********************************************
+   * std::thread semantics
+   */
+  {
+    worker w;
+    preempt::thread thr {&worker::run, &w, std::unique_ptr<int> {new int {40}}, 2};
+    preempt::thread other {std::move(thr)};
+    VERIFY(!thr.joinable() && other.joinable());
+    other.join();
+    VERIFY(w.calls == 42);
+  }
+
+  preempt::report_stack_usage(std::cerr);
+
+  return global_verify_flag() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,115 @@
+/*
+ * Selective memory locking
+ *
+ * A large buffer that is mapped but never touched must not become resident
+ * under lock_mode::on_fault, but does under lock_mode::all. Regions, objects
+ * and the text segment locked explicitly show up in VmLck, and a thread that
+ * locks its stack takes no page faults on it.
+ */
+#include <preempt/process.h>
+#include <preempt/thread.h>
+
+#include <base/verify.h>
+
+#include <cstdlib>
+#include <iostream>
+
+#include <sys/mman.h>
+#include <sys/resource.h>
+
+std::size_t const buffer_size = 32 * 1024 * 1024;
+
+char g_object[1024 * 1024];
+
+long
+minor_faults() {
+  struct rusage ru;
+  getrusage(RUSAGE_THREAD, &ru);
+  return ru.ru_minflt;
+}
+
+__attribute__((noinline))
+int
+use_stack(int depth) {
+  volatile char buffer[1024];
+  buffer[0] = char(depth);
+  return depth ? use_stack(depth - 1) + buffer[0] : 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+  using namespace preempt::this_process;
+  using preempt::this_process::lock_mode;
+
+  unlimit_lock_pages();         // may fail without CAP_SYS_RESOURCE
+  void* const buffer = ::mmap(nullptr, buffer_size, PROT_READ | PROT_WRITE,
+                              MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+  VERIFY(buffer != MAP_FAILED);
+
+  /*********************************************
+   * explicit regions
+   */
+  {
+    auto const before = get_memory_usage();
+    VERIFY(before.locked_kib == 0 && before.resident_kib > 0);
+
+    VERIFY(lock_region(buffer, 4 * 1024 * 1024));
+    auto const locked = get_memory_usage();
+    VERIFY(locked.locked_kib == 4096);
+    VERIFY(locked.resident_kib >= before.resident_kib + 4000);
+    std::cerr << "lock_region(4MiB):  ";
+    report_memory_usage(std::cerr, before);
+    VERIFY(unlock_region(buffer, 4 * 1024 * 1024));
+    VERIFY(get_memory_usage().locked_kib == 0);
+    ::madvise(buffer, buffer_size, MADV_DONTNEED);
+
+    VERIFY(lock_object(g_object));
+    VERIFY(get_memory_usage().locked_kib >= 1024);
+    VERIFY(lock_mapping(reinterpret_cast<void const*>(&use_stack)));   // text segment
+    std::cerr << "object and text:    ";
+    report_memory_usage(std::cerr, before);
+    VERIFY(!lock_mapping(nullptr));
+    VERIFY(unlock_all_pages());
+  }
+
+  /*********************************************
+   * on fault against all
+   */
+  {
+    auto const before = get_memory_usage();
+    VERIFY(lock_pages(lock_mode::on_fault));
+    auto const on_fault = get_memory_usage();
+    std::cerr << "lock_mode::on_fault: ";
+    report_memory_usage(std::cerr, before);
+
+    /* a thread that locks its own stack */
+    long faults = -1;
+    base::stack_options stack;
+    stack.size = 256 * 1024;
+    stack.lock = true;
+    preempt::thread thr {stack, [&faults]() {
+      long const start = minor_faults();
+      use_stack(64);
+      faults = minor_faults() - start;
+    }};
+    thr.join();
+    VERIFY(faults == 0);
+    VERIFY(unlock_all_pages());
+
+    VERIFY(lock_pages(lock_mode::all));
+    auto const all = get_memory_usage();
+    std::cerr << "lock_mode::all:      ";
+    report_memory_usage(std::cerr, before);
+    VERIFY(unlock_all_pages());
+
+    /* the untouched buffer only becomes resident under lock_mode::all */
+    VERIFY(on_fault.resident_kib < before.resident_kib + 8 * 1024);
+    VERIFY(all.resident_kib >= before.resident_kib + 32 * 1024);
+    VERIFY(lock_pages(lock_mode::regions) && get_memory_usage().locked_kib == 0);
+  }
+
+  ::munmap(buffer, buffer_size);
+
+  return global_verify_flag() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,153 @@
+/*
+ * Working sets on huge pages
+ *
+ * Regions come from the MAP_HUGETLB pool if it has pages, else from
+ * transparent huge pages. Either way they must be populated, usable as arena
+ * and as thread stack, and report the huge pages they actually got.
+ *
+ * The benchmark walks a 64MiB table in random order, one dependent load after
+ * the other, so that nearly every access misses the dTLB on 4KiB pages. It
+ * compares normal pages with the huge page region.
+ */
+#include <preempt/hugepage.h>
+#include <preempt/thread.h>
+
+#include <base/chrono.h>
+#include <base/random.h>
+#include <base/verify.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/mman.h>
+
+char const*
+to_string(preempt::huge_region::backing b) {
+  switch (b) {
+  case preempt::huge_region::backing::none:        return "none";
+  case preempt::huge_region::backing::hugetlb:     return "hugetlb";
+  case preempt::huge_region::backing::transparent: return "transparent";
+  case preempt::huge_region::backing::normal:      return "normal";
+  }
+  return "?";
+}
+
+/** Link the table into one random cycle and follow it. */
+double
+walk(std::uint32_t* table, std::size_t n) {
+  for (std::size_t i = 0; i < n; ++i)
+    table[i] = std::uint32_t(i);
+  base::xoshiro256ss rng {1};
+  for (std::size_t i = n - 1; i > 0; --i)        // Sattolo: a single cycle
+    std::swap(table[i], table[base::uniform(rng, std::uint32_t(i))]);
+  std::size_t const steps = 2000000;
+  std::uint32_t j = 0;
+  base::stopwatch sw;
+  for (std::size_t s = 0; s < steps; ++s)
+    j = table[j];
+  double const ns = double(sw.nanoseconds()) / steps;
+  VERIFY(j < n);
+  return ns;
+}
+
+int
+main(int argc, char *argv[])
+{
+  std::size_t const huge = preempt::huge_page_size();
+  VERIFY(huge >= 2 * 1024 * 1024);
+
+  /* use the pool if we may grow it, restore it at the end */
+  std::string pool;
+  base::read_text_file("/proc/sys/vm/nr_hugepages", pool);
+  bool const reserved = preempt::reserve_huge_pages(40) && preempt::free_huge_pages() >= 34;
+
+  /*********************************************
+   * regions
+   */
+  {
+    preempt::huge_region none;
+    VERIFY(!none && none.huge_pages() == 0);
+
+    preempt::huge_region r {3 * 1024 * 1024};
+    VERIFY(r);
+    VERIFY(r.size() == 2 * huge && reinterpret_cast<std::uintptr_t>(r.data()) % huge == 0);
+    std::cerr << "region: " << to_string(r.kind()) << ", " << r.huge_pages() << " huge pages"
+              << (r.locked() ? ", locked" : "") << std::endl;
+    if (reserved)
+      VERIFY(r.kind() == preempt::huge_region::backing::hugetlb && r.huge_pages() == 2);
+    VERIFY(r.huge_pages() <= 2);
+    unsigned char* bytes = static_cast<unsigned char*>(r.data());
+    VERIFY(bytes[0] == 0 && bytes[r.size() - 1] == 0);
+
+    /* no page faults left: mincore() reports every page resident */
+    std::vector<unsigned char> resident(r.size() / 4096);
+    VERIFY(::mincore(r.data(), r.size(), resident.data()) == 0);
+    for (unsigned char c : resident)
+      VERIFY(c & 1);
+
+    preempt::huge_region moved {std::move(r)};
+    VERIFY(!r && moved && moved.data() == bytes);
+  }
+
+  /*********************************************
+   * arena, allocator and stack
+   */
+  {
+    preempt::huge_arena arena {1};
+    VERIFY(arena && arena.capacity() == huge);
+    double* d = arena.create<double>(1.5);
+    VERIFY(d && *d == 1.5 && reinterpret_cast<std::uintptr_t>(d) % alignof(double) == 0);
+    VERIFY(arena.allocate(huge) == nullptr);
+    VERIFY(arena.allocate(100, 64) != nullptr);
+
+    std::vector<int, preempt::arena_allocator<int>> v {preempt::arena_allocator<int> {arena}};
+    v.reserve(1000);
+    for (int i = 0; i < 1000; ++i)
+      v.push_back(i);
+    VERIFY(v[999] == 999);
+    VERIFY(static_cast<void*>(v.data()) > arena.region().data());
+    arena.reset();
+    VERIFY(arena.used() == 0);
+
+    preempt::huge_region stack_region {huge};
+    base::stack_options stack = stack_region.stack();
+    stack.watermark = true;
+    char* address = nullptr;
+    preempt::thread thr {stack, [&address]() { char c; address = &c; }};
+    thr.join();
+    char* const low = static_cast<char*>(stack_region.data());
+    VERIFY(address > low && address < low + stack_region.size());
+    VERIFY(thr.stack_high_water_mark() > 0);
+  }
+
+  /*********************************************
+   * table walk: normal pages against huge pages
+   */
+  {
+    std::size_t const bytes = 64 * 1024 * 1024;
+    std::size_t const n = bytes / sizeof(std::uint32_t);
+
+    void* normal = ::mmap(nullptr, bytes, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                          -1, 0);
+    VERIFY(normal != MAP_FAILED);
+#ifdef MADV_NOHUGEPAGE
+    ::madvise(normal, bytes, MADV_NOHUGEPAGE);
+#endif
+    double const normal_ns = walk(static_cast<std::uint32_t*>(normal), n);
+    ::munmap(normal, bytes);
+
+    preempt::huge_region table {bytes};
+    VERIFY(table);
+    double const huge_ns = walk(static_cast<std::uint32_t*>(table.data()), n);
+    std::cerr << "table walk 64MiB: 4KiB pages " << normal_ns << "ns, " << to_string(table.kind())
+              << " (" << table.huge_pages() << " huge pages) " << huge_ns << "ns per access"
+              << std::endl;
+  }
+
+  if (!pool.empty())
+    base::write_text_file("/proc/sys/vm/nr_hugepages", pool);
+
+  return global_verify_flag() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
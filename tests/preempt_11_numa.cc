@@ -0,0 +1,110 @@
+/*
+ * NUMA placement of real-time task memory
+ *
+ * The topology is read from a fake sysfs tree with two nodes. On this machine
+ * memory is bound to the node of CPU 0, a task is pinned there, and the
+ * registered regions must not have remote pages. On a single-node machine
+ * binding and moving are no-ops, so the test runs everywhere.
+ */
+#include <preempt/hugepage.h>
+#include <preempt/numa.h>
+#include <preempt/task.h>
+
+#include <base/verify.h>
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <ftw.h>
+#include <sys/mman.h>
+
+struct pinned_task : preempt::critical_task<1000000> {
+  int cpu = -1;
+  int node = -2;
+  void run() override {
+    cpu = ::sched_getcpu();
+    node = preempt::current_numa_node();
+  }
+};
+
+int
+main(int argc, char *argv[])
+{
+  /*********************************************
+   * fake /sys/devices/system/node tree
+   */
+  {
+    char tmpl[] = "/tmp/libpreempt-numa-XXXXXX";
+    VERIFY(::mkdtemp(tmpl));
+    std::string const root = tmpl;
+    std::string dir = root;
+    for (char const* d : {"/devices", "/system", "/node", "/node0"}) {
+      dir += d;
+      ::mkdir(dir.c_str(), 0755);
+    }
+    ::mkdir((root + "/devices/system/node/node1").c_str(), 0755);
+    std::ofstream {root + "/devices/system/node/online"} << "0-1\n";
+    std::ofstream {root + "/devices/system/node/node0/cpulist"} << "0-3,8-11\n";
+    std::ofstream {root + "/devices/system/node/node1/cpulist"} << "4-7,12-15\n";
+
+    preempt::numa_topology numa {root};
+    VERIFY((numa.nodes() == std::vector<int> {0, 1}));
+    VERIFY(!numa.single_node());
+    VERIFY(numa.node_of_cpu(2) == 0 && numa.node_of_cpu(9) == 0);
+    VERIFY(numa.node_of_cpu(5) == 1 && numa.node_of_cpu(15) == 1);
+    VERIFY(numa.node_of_cpu(16) == -1);
+    VERIFY((numa.cpus_of_node(1) == std::vector<int> {4, 5, 6, 7, 12, 13, 14, 15}));
+    VERIFY(numa.cpus_of_node(2).empty());
+
+    /* no node directory: one node with all CPUs */
+    preempt::numa_topology none {root + "/nonexistent"};
+    VERIFY(none.single_node() && none.nodes() == std::vector<int> {0});
+    VERIFY(none.node_of_cpu(0) == 0);
+
+    ::nftw(tmpl, [](char const* path, struct stat const*, int, struct FTW*) {
+      return ::remove(path);
+    }, 16, FTW_DEPTH | FTW_PHYS);
+  }
+
+  /*********************************************
+   * this machine
+   */
+  {
+    auto const& numa = preempt::system_numa_topology();
+    int const node = numa.node_of_cpu(0);
+    std::cerr << "nodes: " << numa.nodes().size() << ", CPU 0 on node " << node << std::endl;
+    VERIFY(node >= 0);
+    VERIFY(preempt::current_numa_node() >= 0);
+
+    std::size_t const size = 4 * 1024 * 1024;
+    void* buffer = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                          -1, 0);
+    VERIFY(buffer != MAP_FAILED);
+    VERIFY(preempt::bind_memory(buffer, size, node));
+    VERIFY(!preempt::bind_memory(buffer, size, 4096));
+    std::fill_n(static_cast<char*>(buffer), size, 1);
+    VERIFY(preempt::remote_pages(buffer, size, node) == 0);
+    preempt::register_numa_region("buffer", buffer, size, node);
+
+    preempt::huge_arena arena {1 << 20, true, node};
+    VERIFY(arena);
+    preempt::register_numa_region("arena", arena.region().data(), arena.capacity(), node);
+
+    VERIFY(preempt::prefer_memory_node(node));
+    VERIFY(preempt::prefer_memory_node(-1));
+
+    pinned_task task;
+    task.pin(0);
+    task.start();
+    task.join();
+    VERIFY(task.cpu == 0 && task.node == node);
+
+    VERIFY(preempt::report_remote_pages(std::cerr) == 0);
+    ::munmap(buffer, size);
+  }
+
+  return global_verify_flag() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
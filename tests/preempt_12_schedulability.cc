@@ -0,0 +1,85 @@
+/*
+ * Offline schedulability analysis
+ *
+ * Text book task sets with known results: a set above the Liu-Layland bound
+ * that response time analysis still accepts, a set that only EDF can
+ * schedule, and constrained deadlines that no scheduler can meet although the
+ * utilization is low. With deadlines beyond the period a later job of the
+ * busy period responds last. Finally a parsed set gets deadline-monotonic priorities
+ * and passes the startup check.
+ */
+#include <preempt/schedulability.h>
+
+#include <base/verify.h>
+
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace analysis = preempt::analysis;
+
+int
+main() {
+  /* Buttazzo, Hard Real-Time Computing Systems: R = 3, 6, 20 */
+  analysis::task_set rm {{"t1", 7, 0, 3}, {"t2", 12, 0, 3}, {"t3", 20, 0, 5}};
+  analysis::assign_rate_monotonic(rm);
+  VERIFY(rm[0].priority > rm[1].priority && rm[1].priority > rm[2].priority);
+  VERIFY(rm[0].priority == base::get_max_priority<SCHED_FIFO>());
+  VERIFY(!analysis::liu_layland_test(rm));
+  auto r = analysis::response_times(rm);
+  VERIFY(r.size() == 3 && r[0] == 3 && r[1] == 6 && r[2] == 20);
+  VERIFY(analysis::response_time_test(rm));
+  VERIFY(analysis::edf_test(rm));
+  analysis::report(rm, std::cerr);
+
+  /* U = 0.97: EDF yes, rate-monotonic no (R2 = 8 > 7) */
+  analysis::task_set edf {{"a", 5, 0, 2}, {"b", 7, 0, 4}};
+  analysis::assign_rate_monotonic(edf);
+  VERIFY(analysis::edf_test(edf));
+  VERIFY(!analysis::response_time_test(edf));
+  VERIFY(analysis::response_times(edf)[1] == -1);
+
+  /* Lehoczky: deadlines beyond the period, the fifth job responds last (118) */
+  analysis::task_set arbitrary {{"h", 70, 0, 26, 2}, {"l", 100, 120, 62, 1}};
+  r = analysis::response_times(arbitrary);
+  VERIFY(r[0] == 26 && r[1] == 118);
+  arbitrary[1].deadline_us = 115;           // the first job alone responds in 114
+  VERIFY(!analysis::response_time_test(arbitrary));
+
+  /* demand 4 in the first 3us */
+  analysis::task_set tight {{"x", 10, 3, 2}, {"y", 10, 3, 2}};
+  VERIFY(analysis::utilization(tight) < analysis::liu_layland_bound(2));
+  VERIFY(!analysis::edf_test(tight));
+  analysis::task_set overload {{"x", 10, 0, 6}, {"y", 10, 0, 6}};
+  VERIFY(!analysis::edf_test(overload));
+
+  /* more tasks than priority levels share levels */
+  analysis::task_set many(200, analysis::task_spec {"m", 100000, 0, 1});
+  analysis::assign_rate_monotonic(many, 1, 99);
+  bool in_range = true;
+  for (auto const& t : many)
+    in_range = in_range && t.priority >= 1 && t.priority <= 99;
+  VERIFY(in_range);
+
+  std::istringstream text {
+    "# name   period deadline wcet\n"
+    "logger   10000  0        1500\n"
+    "\n"
+    "control  1000   500      200   # tighter than its period\n"
+    "sensor   400    0        100\n"};
+  analysis::task_set parsed;
+  std::string error;
+  VERIFY(analysis::parse_task_set(text, parsed, &error));
+  VERIFY(parsed.size() == 3 && parsed[1].name == "control" && parsed[1].deadline() == 500);
+  analysis::assign_deadline_monotonic(parsed);
+  VERIFY(parsed[2].priority > parsed[1].priority && parsed[1].priority > parsed[0].priority);
+  VERIFY(analysis::report(parsed, std::cerr));
+  analysis::require_schedulable(parsed);
+
+  std::istringstream bad {"control 1000 x 200\n"};
+  VERIFY(!analysis::parse_task_set(bad, parsed, &error));
+  VERIFY(error.find("line 1") == 0);
+
+  return global_verify_flag() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,104 @@
+/*
+ * User-space earliest deadline first
+ *
+ * A worker that is held up by a gate job collects jobs in random deadline
+ * order and must run them by deadline once released. A long job yields to a
+ * job with an earlier deadline that arrives while it runs, a job past its
+ * deadline counts as late, and the dispatch overhead per job is measured with
+ * empty jobs.
+ */
+#include <preempt/edf.h>
+#include <preempt/process.h>
+
+#include <base/verify.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+using namespace std::chrono;
+
+void
+wait_for(std::atomic<bool> const& flag) {
+  while (!flag.load())
+    std::this_thread::sleep_for(microseconds {100});  // let the main thread run
+}
+
+int
+main() {
+  using preempt::edf_dispatcher;
+  preempt::this_process::begin_realtime();
+  {
+    edf_dispatcher edf {{0}, 1};
+    VERIFY(edf.size() == 1);
+    VERIFY(edf_dispatcher::yield() == 0);
+    VERIFY(edf_dispatcher::current_deadline() == edf_dispatcher::clock::time_point::max());
+
+    /* deadline order */
+    std::atomic<bool> gate {false};
+    edf.submit(seconds {0}, [&gate] { wait_for(gate); });
+    auto const base = edf_dispatcher::clock::now() + seconds {10};
+    std::vector<int> order;
+    int const deadlines[] = {7, 3, 9, 1, 5, 2, 8, 6, 4, 0};
+    for (int d : deadlines)
+      edf.submit(0, base + milliseconds {d}, [&order, d] { order.push_back(d); });
+    gate = true;
+    edf.wait_idle();
+    VERIFY(order.size() == 10 && std::is_sorted(order.begin(), order.end()));
+    VERIFY(edf.stats(0).jobs == 11 && edf.stats(0).late == 1);
+
+    /* cooperative preemption */
+    std::atomic<bool> running {false}, submitted {false};
+    std::vector<char> trace;
+    int yielded = -1;
+    edf.submit(seconds {10}, [&] {
+      running = true;
+      wait_for(submitted);
+      yielded = edf_dispatcher::yield();
+      trace.push_back('a');
+    });
+    while (!running)
+      std::this_thread::sleep_for(microseconds {100});
+    edf.submit(seconds {5}, [&trace] {
+      trace.push_back('b');
+      VERIFY(edf_dispatcher::current_deadline() < edf_dispatcher::clock::now() + seconds {6});
+    });
+    submitted = true;
+    edf.wait_idle();
+    VERIFY(yielded == 1);
+    VERIFY(trace.size() == 2 && trace[0] == 'b' && trace[1] == 'a');
+    VERIFY(edf.stats(0).preemptions == 1);
+
+    /* lateness */
+    auto const before = edf.stats(0);
+    edf.submit(0, edf_dispatcher::clock::now() - milliseconds {1}, [] { });
+    edf.wait_idle();
+    auto const after = edf.stats(0);
+    VERIFY(after.late == before.late + 1);
+    VERIFY(after.max_lateness_ns >= 1000000);
+
+    /* dispatch overhead */
+    constexpr int n = 100000;
+    long count = 0;
+    auto const start = steady_clock::now();
+    for (int i = 0; i < n; ++i)
+      edf.submit(seconds {1}, [&count] { ++count; });
+    edf.wait_idle();
+    auto const ns = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+    VERIFY(count == n);
+    std::cerr << "edf dispatch: " << ns / n << "ns per job, late "
+              << edf.stats(0).late - after.late << " of " << n << std::endl;
+
+    /* explicit join, then the destructor's */
+    edf.submit(milliseconds {1}, [&count] { ++count; });
+    edf.join();
+    VERIFY(count == n + 1 && !edf.joinable());
+  }
+  preempt::this_process::end_realtime();
+
+  return global_verify_flag() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
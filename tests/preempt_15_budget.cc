@@ -0,0 +1,96 @@
+/*
+ * CPU-time budgets of critical tasks
+ *
+ * Runaway SCHED_FIFO tasks with a 20ms time slice spin for up to two
+ * seconds. With a flag budget the task sees the flag, with a demote budget it
+ * finds itself at SCHED_OTHER and with a cancel budget the loop ends at a
+ * cancellation point. Each must be caught well before its two seconds are
+ * up. A task within its budget is left alone.
+ */
+#include <preempt/budget.h>
+#include <preempt/process.h>
+#include <preempt/task.h>
+
+#include <base/verify.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+
+#include <sched.h>
+
+using namespace std::chrono;
+
+constexpr long budget_us = 20000;
+
+struct runaway : preempt::critical_task<budget_us> {
+  preempt::overrun_action action;
+  bool finished = false;
+  int policy = -1;
+
+  explicit runaway(preempt::overrun_action a) : action {a} {
+    enforce_budget(a);
+  }
+
+  void run() override {
+    auto const give_up = steady_clock::now() + seconds {2};
+    while (steady_clock::now() < give_up) {
+      if (action == preempt::overrun_action::flag && overrun())
+        break;
+      if (action == preempt::overrun_action::demote && ::sched_getscheduler(0) == SCHED_OTHER)
+        break;
+      cancellation_point();
+    }
+    policy = ::sched_getscheduler(0);
+    finished = true;
+  }
+};
+
+struct modest : preempt::critical_task<budget_us> {
+  void run() override { }
+};
+
+int
+main() {
+  using preempt::overrun_action;
+  preempt::this_process::begin_realtime();
+  {
+    runaway flagged {overrun_action::flag};
+    flagged.start(1);
+    flagged.join();
+    VERIFY(flagged.overrun() && flagged.finished);
+    VERIFY(flagged.policy == SCHED_FIFO);
+    VERIFY(flagged.runtime() < 500000);
+    std::cerr << "flag after " << flagged.runtime() << "us" << std::endl;
+
+    runaway demoted {overrun_action::demote};
+    demoted.start(1);
+    demoted.join();
+    VERIFY(demoted.overrun() && demoted.finished);
+    VERIFY(demoted.policy == SCHED_OTHER);
+    VERIFY(demoted.runtime() < 500000);
+    std::cerr << "demote after " << demoted.runtime() << "us" << std::endl;
+
+    runaway cancelled {overrun_action::cancel};
+    cancelled.start(1);
+    cancelled.join();
+    VERIFY(cancelled.overrun() && !cancelled.finished);
+    VERIFY(cancelled.runtime() < 500000);
+    std::cerr << "cancel after " << cancelled.runtime() << "us" << std::endl;
+
+    modest m;
+    m.enforce_budget(overrun_action::cancel);
+    m.start(1);
+    m.join();
+    VERIFY(!m.overrun());
+  }
+  preempt::this_process::end_realtime();
+
+  preempt::cpu_budget budget;
+  VERIFY(budget.arm(1000000, overrun_action::cancel));
+  preempt::cpu_budget::cancellation_point();
+  budget.disarm();
+  VERIFY(budget && !budget.expired());
+
+  return global_verify_flag() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
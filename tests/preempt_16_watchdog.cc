@@ -0,0 +1,69 @@
+/*
+ * Watchdog for stuck real-time threads
+ *
+ * Two SCHED_FIFO threads share the CPU with a 1ms watchdog at the highest
+ * priority. One beats while it sleeps and must be left alone, the other
+ * spins without a heartbeat and must be demoted to SCHED_OTHER shortly after
+ * its 10ms window, long before it would give up by itself.
+ */
+#include <preempt/process.h>
+#include <preempt/thread.h>
+#include <preempt/watchdog.h>
+
+#include <base/verify.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+
+#include <sched.h>
+
+using namespace std::chrono;
+
+int
+main() {
+  preempt::this_process::begin_realtime();
+  {
+    preempt::watchdog wd {1000};
+    wd.start();
+
+    long alive_missed = -1;
+    preempt::thread alive {SCHED_FIFO, 1, [&wd, &alive_missed] {
+      auto hb = wd.watch("alive", 10000);
+      for (int i = 0; i < 50; ++i) {
+        hb.beat();
+        std::this_thread::sleep_for(milliseconds {1});
+      }
+      alive_missed = hb.missed();
+      wd.unwatch(hb);
+    }};
+    alive.join();
+    VERIFY(alive_missed == 0);
+
+    long stuck_missed = -1;
+    long stuck_ms = -1;
+    int policy = -1;
+    preempt::thread stuck {SCHED_FIFO, 1, [&] {
+      auto hb = wd.watch("stuck", 10000);
+      VERIFY(bool(hb));
+      hb.beat();
+      auto const start = steady_clock::now();
+      while (steady_clock::now() < start + seconds {2} && ::sched_getscheduler(0) == SCHED_FIFO) {
+      }
+      stuck_ms = duration_cast<milliseconds>(steady_clock::now() - start).count();
+      policy = ::sched_getscheduler(0);
+      stuck_missed = hb.missed();
+      wd.unwatch(hb);
+    }};
+    stuck.join();
+    VERIFY(policy == SCHED_OTHER);
+    VERIFY(stuck_missed == 1 && wd.misses() == 1);
+    VERIFY(stuck_ms >= 10 && stuck_ms < 500);
+    std::cerr << "stuck thread demoted after " << stuck_ms << "ms" << std::endl;
+    wd.stop();
+  }
+  preempt::this_process::end_realtime();
+
+  return global_verify_flag() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
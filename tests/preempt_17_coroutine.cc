@@ -0,0 +1,181 @@
+/*
+ * Coroutine tasks on one real-time thread
+ *
+ * A hundred periodic coroutines share one SCHED_FIFO thread with a 1ms tick,
+ * next to a sleeper and a producer/consumer pair on a channel. The frame pool
+ * must refuse tasks beyond its capacity. Finally a coroutine switch is
+ * compared with a switch between two mono_task threads, and the frame size
+ * with a thread stack.
+ *
+ * Coroutines need C++20; with older standards the test only says so.
+ */
+#include <preempt/coroutine.h>
+#include <preempt/process.h>
+#include <preempt/task.h>
+
+#include <base/verify.h>
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+
+#ifdef PREEMPT_HAS_COROUTINES
+
+using namespace std::chrono;
+using preempt::co_task;
+using preempt::coroutine_scheduler;
+
+constexpr int periodic_tasks = 100;
+constexpr int periods = 10;
+int periodic_runs[periodic_tasks];
+
+co_task
+periodic(coroutine_scheduler&, int i) {
+  for (int n = 0; n < periods; ++n) {
+    ++periodic_runs[i];
+    co_await preempt::next_tick();
+  }
+}
+
+co_task
+sleeper(coroutine_scheduler&, coroutine_scheduler::clock::time_point t,
+        coroutine_scheduler::clock::time_point* woken) {
+  co_await preempt::sleep_until(t);
+  *woken = coroutine_scheduler::clock::now();
+}
+
+using channel = preempt::co_channel<int, 4>;
+
+co_task
+producer(coroutine_scheduler&, channel& ch, int n) {
+  for (int i = 1; i <= n; ++i) {
+    while (!ch.write(i))
+      co_await preempt::next_tick();
+    if (i % 3 == 0)
+      co_await preempt::next_tick();
+  }
+}
+
+co_task
+consumer(coroutine_scheduler&, channel& ch, int n, long* sum) {
+  for (int i = 0; i < n; ++i)
+    *sum += co_await ch;
+}
+
+co_task
+ping(coroutine_scheduler&, channel& out, channel& in, int n) {
+  for (int i = 0; i < n; ++i) {
+    out.write(i);
+    co_await in;
+  }
+}
+
+co_task
+pong(coroutine_scheduler&, channel& in, channel& out, int n) {
+  for (int i = 0; i < n; ++i)
+    out.write(co_await in);
+}
+
+/* the same ping-pong with two threads */
+struct thread_pingpong {
+  std::mutex mutex;
+  std::condition_variable cv;
+  int turn = 0;
+
+  struct player : preempt::mono_task<> {
+    void play(thread_pingpong& p, int me, int n) {
+      spawn([&p, me, n] {
+        for (int i = 0; i < n; ++i) {
+          std::unique_lock<std::mutex> lock {p.mutex};
+          p.cv.wait(lock, [&p, me] { return p.turn == me; });
+          p.turn = 1 - me;
+          p.cv.notify_one();
+        }
+      });
+    }
+  } a, b;
+};
+
+std::size_t
+default_stack_size() {
+  pthread_attr_t attr;
+  std::size_t size = 0;
+  pthread_attr_init(&attr);
+  pthread_attr_getstacksize(&attr, &size);
+  pthread_attr_destroy(&attr);
+  return size;
+}
+
+int
+main() {
+  preempt::this_process::begin_realtime();
+  {
+    coroutine_scheduler s {1000, 128};
+    for (int i = 0; i < periodic_tasks; ++i)
+      VERIFY(s.spawn(periodic(s, i)));
+    auto const wake = coroutine_scheduler::clock::now() + milliseconds {5};
+    coroutine_scheduler::clock::time_point woken {};
+    VERIFY(s.spawn(sleeper(s, wake, &woken)));
+    channel ch;
+    long sum = 0;
+    VERIFY(s.spawn(consumer(s, ch, 10, &sum)));
+    VERIFY(s.spawn(producer(s, ch, 10)));
+    VERIFY(s.tasks() == periodic_tasks + 3);
+    s.start(1);
+    s.join();                   // run() returns when all tasks are done
+    VERIFY(s.tasks() == 0 && s.pool().in_use() == 0);
+    VERIFY(s.ticks() >= periods - 1);
+    bool all = true;
+    for (int runs : periodic_runs)
+      all = all && runs == periods;
+    VERIFY(all);
+    VERIFY(woken >= wake);
+    VERIFY(sum == 55);
+
+    coroutine_scheduler small {1000, 2};
+    VERIFY(small.spawn(periodic(small, 0)));
+    VERIFY(small.spawn(periodic(small, 1)));
+    co_task third = periodic(small, 2);
+    VERIFY(!third);
+    VERIFY(!small.spawn(std::move(third)));
+  }
+  {
+    constexpr int n = 100000;
+    coroutine_scheduler s {1000, 2};
+    channel there, back;
+    s.spawn(ping(s, there, back, n));
+    s.spawn(pong(s, there, back, n));
+    auto start = steady_clock::now();
+    s.run();
+    auto const coroutine_ns = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+
+    thread_pingpong p;
+    start = steady_clock::now();
+    p.a.play(p, 0, n);
+    p.b.play(p, 1, n);
+    p.a.join();
+    p.b.join();
+    auto const thread_ns = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+
+    std::cerr << "switch: coroutine " << coroutine_ns / (2 * n) << "ns, mono_task "
+              << thread_ns / (2 * n) << "ns" << std::endl;
+    std::cerr << "memory per task: coroutine frame " << s.pool().largest_request()
+              << " bytes, mono_task stack " << PTHREAD_STACK_MIN / 1024 << "KiB minimum, "
+              << default_stack_size() / 1024 << "KiB default" << std::endl;
+  }
+  preempt::this_process::end_realtime();
+
+  return global_verify_flag() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#else
+
+int
+main() {
+  std::cerr << "coroutine tasks need C++20" << std::endl;
+  return global_verify_flag() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+#endif
@@ -0,0 +1,84 @@
+/*
+ * Deferred work from a real-time thread
+ *
+ * A SCHED_FIFO thread posts closures and releases buffers that a SCHED_OTHER
+ * worker runs and frees. An executor without workers shows how a full queue
+ * drops closures and how the owner runs what is pending. The worst-case and
+ * average cost of post() are printed.
+ */
+#include <preempt/deferred.h>
+#include <preempt/process.h>
+#include <preempt/thread.h>
+
+#include <base/verify.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <thread>
+
+struct buffer {
+  static std::atomic<int> freed;
+  static std::thread::id freed_by;
+  char bytes[1 << 20];
+  ~buffer() {
+    freed_by = std::this_thread::get_id();
+    ++freed;
+  }
+};
+
+std::atomic<int> buffer::freed {0};
+std::thread::id buffer::freed_by;
+
+int
+main() {
+  using namespace std::chrono;
+  preempt::this_process::begin_realtime();
+  {
+    preempt::deferred_executor deferred {256};
+    std::atomic<long> sum {0};
+    std::thread::id rt_id;
+    long rt_ns = 0;
+    constexpr int n = 10000;
+    std::unique_ptr<buffer> big {new buffer};
+    preempt::thread rt {SCHED_FIFO, 1, [&] {
+      rt_id = std::this_thread::get_id();
+      VERIFY(deferred.release(std::move(big)));
+      VERIFY(!big);
+      for (int i = 1; i <= n; ++i) {
+        auto const start = steady_clock::now();
+        VERIFY(deferred.post([&sum, i] { sum += i; }));
+        rt_ns += duration_cast<nanoseconds>(steady_clock::now() - start).count();
+        if (i % 100 == 0)
+          std::this_thread::sleep_for(milliseconds {1});   // the worker's turn on one CPU
+      }
+    }};
+    rt.join();
+    deferred.drain();
+    VERIFY(sum == long(n) * (n + 1) / 2);
+    VERIFY(buffer::freed == 1 && buffer::freed_by != rt_id);
+    auto const s = deferred.stats();
+    VERIFY(s.executed == n + 1 && s.depth == 0 && s.dropped == 0 && s.max_depth <= 256);
+    std::cerr << "post: " << rt_ns / n << "ns average, " << s.max_post_ns << "ns worst, depth "
+              << s.max_depth << " max, " << s.dropped << " dropped" << std::endl;
+  }
+  {
+    preempt::deferred_executor owner {8, 0};
+    int runs = 0;
+    for (int i = 0; i < 10; ++i)
+      owner.post([&runs] { ++runs; });
+    auto s = owner.stats();
+    VERIFY(s.posted == 8 && s.dropped == 2 && s.depth == 8 && s.max_depth == 8);
+    std::unique_ptr<buffer> kept {new buffer};
+    VERIFY(!owner.release(std::move(kept)) && kept);
+    VERIFY(owner.run_pending() == 8 && runs == 8);
+    VERIFY(owner.release(std::move(kept)) && !kept);
+    VERIFY(owner.stats().depth == 1);
+  }                             // runs the release
+  VERIFY(buffer::freed == 2);
+  preempt::this_process::end_realtime();
+
+  return global_verify_flag() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
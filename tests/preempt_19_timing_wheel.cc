@@ -0,0 +1,175 @@
+/*
+ * Hierarchical timing wheel
+ *
+ * Timers spread over all four wheels must fire exactly at their tick when
+ * the wheel is advanced by hand, cancelled ones never, and a callback may arm
+ * its timer again. Arm and cancel throughput and the expiry accuracy of the
+ * tick thread are compared with a std::priority_queue, which cannot cancel
+ * and marks cancelled entries instead.
+ */
+#include <preempt/process.h>
+#include <preempt/timing_wheel.h>
+
+#include <base/chrono.h>
+#include <base/verify.h>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <queue>
+#include <random>
+#include <thread>
+#include <vector>
+
+using preempt::timing_wheel;
+
+struct probe {
+  std::uint64_t due = 0;
+  std::uint64_t fired = 0;
+  int count = 0;
+};
+
+int
+main() {
+  using namespace std::chrono;
+  std::mt19937_64 random {42};
+  {
+    /* exact expiry over all wheels */
+    timing_wheel wheel {1000};
+    constexpr int n = 5000;
+    std::vector<probe> probes(n);
+    std::vector<std::unique_ptr<timing_wheel::timer>> timers;
+    static timing_wheel* current;
+    current = &wheel;
+    auto const fire = [](timing_wheel::timer& t) {
+      auto& p = *static_cast<probe*>(t.context());
+      p.fired = current->ticks();
+      ++p.count;
+    };
+    for (int i = 0; i < n; ++i) {
+      std::uint64_t const delay = 1 + random() % (std::uint64_t(1) << (i % 4 == 0 ? 21 : 10));
+      probes[i].due = delay;
+      timers.emplace_back(new timing_wheel::timer {fire, &probes[i]});
+      wheel.arm_ticks(*timers.back(), delay);
+    }
+    for (int i = 0; i < n; i += 3)
+      wheel.cancel(*timers[i]);
+    VERIFY(wheel.size() == std::size_t(n - (n + 2) / 3));
+    std::size_t const fired = wheel.advance(std::uint64_t(1) << 21);
+    VERIFY(fired == std::size_t(n - (n + 2) / 3) && wheel.size() == 0);
+    bool exact = true;
+    for (int i = 0; i < n; ++i)
+      exact = exact && (i % 3 == 0 ? probes[i].count == 0
+                                   : probes[i].count == 1 && probes[i].fired == probes[i].due);
+    VERIFY(exact);
+
+    /* beyond the range of the wheels */
+    probe far {};
+    timing_wheel::timer t {fire, &far};
+    std::uint64_t const start = wheel.ticks();
+    wheel.arm_ticks(t, (std::uint64_t(1) << 26) + 300);
+    wheel.advance((std::uint64_t(1) << 26) + 299);
+    VERIFY(far.count == 0 && t.armed());
+    wheel.advance(1);
+    VERIFY(far.count == 1 && far.fired == start + (std::uint64_t(1) << 26) + 300);
+  }
+  {
+    /* periodic */
+    timing_wheel wheel {1000};
+    static timing_wheel* current;
+    static int periods;
+    current = &wheel;
+    periods = 0;
+    timing_wheel::timer t {[](timing_wheel::timer& self) {
+      if (++periods < 10)
+        current->arm_ticks(self, 7);
+    }};
+    wheel.arm_ticks(t, 7);
+    wheel.advance(100);
+    VERIFY(periods == 10 && !t.armed());
+  }
+  {
+    /* arm and cancel throughput */
+    constexpr int n = 200000;
+    timing_wheel wheel {1000};
+    std::deque<timing_wheel::timer> timers;
+    for (int i = 0; i < n; ++i)
+      timers.emplace_back([](timing_wheel::timer&) { });
+    std::vector<std::uint64_t> delays(n);
+    for (auto& d : delays)
+      d = 1 + random() % 60000;
+    auto start = steady_clock::now();
+    for (int i = 0; i < n; ++i)
+      wheel.arm_ticks(timers[i], delays[i]);
+    for (int i = 0; i < n; ++i)
+      wheel.cancel(timers[i]);
+    auto const wheel_ns = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+
+    struct entry {
+      std::uint64_t expires;
+      int id;
+      bool operator > (entry const& other) const { return expires > other.expires; }
+    };
+    std::priority_queue<entry, std::vector<entry>, std::greater<entry>> queue;
+    std::vector<char> cancelled(n);
+    start = steady_clock::now();
+    for (int i = 0; i < n; ++i)
+      queue.push(entry {delays[i], i});
+    for (int i = 0; i < n; ++i)
+      cancelled[i] = 1;
+    while (!queue.empty())      // cancelled entries still have to be popped
+      queue.pop();
+    auto const queue_ns = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+    std::cerr << "arm+cancel: timing wheel " << wheel_ns / n << "ns, priority_queue "
+              << queue_ns / n << "ns" << std::endl;
+  }
+  preempt::this_process::begin_realtime();
+  {
+    /* expiry accuracy: 1ms tick thread versus sleeping until each deadline */
+    constexpr int n = 50;
+    using clock = steady_clock;
+    static clock::time_point fired[n];
+    timing_wheel wheel {1000};
+    std::deque<timing_wheel::timer> timers;
+    for (int i = 0; i < n; ++i)
+      timers.emplace_back([](timing_wheel::timer& t) {
+        fired[reinterpret_cast<std::intptr_t>(t.context())] = clock::now();
+      }, reinterpret_cast<void*>(std::intptr_t(i)));
+    wheel.start(1);
+    auto const armed = clock::now();
+    for (int i = 0; i < n; ++i)
+      wheel.arm(timers[i], (i + 1) * 1000);
+    while (wheel.size() > 0)
+      std::this_thread::sleep_for(milliseconds {5});
+    wheel.stop();
+    long wheel_max = 0, wheel_sum = 0;
+    for (int i = 0; i < n; ++i) {
+      long const late = duration_cast<microseconds>(
+        fired[i] - (armed + milliseconds {i + 1})).count();
+      wheel_max = std::max(wheel_max, late);
+      wheel_sum += late;
+    }
+    VERIFY(wheel_max < 20000);
+
+    long queue_max = 0, queue_sum = 0;
+    auto const begin = clock::now();
+    for (int i = 0; i < n; ++i) {
+      auto const due = begin + milliseconds {i + 1};
+      base::sleep_until(duration_cast<nanoseconds>(due.time_since_epoch()).count());
+      long const late = duration_cast<microseconds>(clock::now() - due).count();
+      queue_max = std::max(queue_max, late);
+      queue_sum += late;
+    }
+    std::cerr << "lateness: timing wheel " << wheel_sum / n << "us average, " << wheel_max
+              << "us max; exact sleep " << queue_sum / n << "us average, " << queue_max
+              << "us max" << std::endl;
+  }
+  preempt::this_process::end_realtime();
+
+  return global_verify_flag() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,148 @@
+/*
+ * Event loop for the non-real-time side
+ *
+ * A reactor dispatches a periodic and a one-shot timer, a pipe and wakeups
+ * from a SCHED_FIFO thread; a burst of notify() calls arrives as fewer
+ * callbacks that add up to the burst. Ten periodic concerns as ten sleeping
+ * threads are compared with ten timerfds on one loop by their voluntary
+ * context switches, and the loop's timer latency is printed.
+ */
+#include <preempt/process.h>
+#include <preempt/reactor.h>
+#include <preempt/thread.h>
+
+#include <base/verify.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <unistd.h>
+
+namespace {
+long
+voluntary_switches() {
+  ::rusage usage;
+  ::getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_nvcsw;
+}
+} // namespace
+
+int
+main() {
+  using namespace std::chrono;
+  {
+    /* timers and a pipe, dispatched by hand */
+    preempt::reactor loop;
+    VERIFY(loop);
+    int periods = 0, once = 0;
+    std::uint64_t read_events = 0;
+    VERIFY(loop.every(2000, [&](std::uint64_t n) { periods += int(n); }) >= 0);
+    VERIFY(loop.after(5000, [&](std::uint64_t n) { once += int(n); }) >= 0);
+    int fds[2];
+    VERIFY(::pipe(fds) == 0);
+    int const id = loop.watch(fds[0], EPOLLIN, [&](std::uint64_t events) {
+      char c;
+      VERIFY(::read(fds[0], &c, 1) == 1 && c == 'x');
+      read_events = events;
+    });
+    VERIFY(id == fds[0]);
+    VERIFY(::write(fds[1], "x", 1) == 1);
+    auto const end = steady_clock::now() + milliseconds {30};
+    while (steady_clock::now() < end)
+      VERIFY(loop.run_once(5) >= 0);
+    VERIFY(read_events & EPOLLIN);
+    VERIFY(once == 1);
+    VERIFY(periods >= 10 && periods <= 16);
+    VERIFY(loop.remove(id) && !loop.remove(id));
+    ::close(fds[0]);
+    ::close(fds[1]);
+  }
+  preempt::this_process::begin_realtime();
+  {
+    /* a burst of wakeups from a real-time thread */
+    preempt::reactor loop;
+    constexpr int n = 1000;
+    std::atomic<long> sum {0};
+    std::atomic<int> calls {0};
+    auto const wake = loop.wakeup([&](std::uint64_t count) {
+      sum += long(count);
+      ++calls;
+    });
+    VERIFY(wake);
+    loop.start();
+    long rt_ns = 0;
+    preempt::thread rt {SCHED_FIFO, 1, [&] {
+      for (int i = 1; i <= n; ++i) {
+        auto const start = steady_clock::now();
+        wake.notify();
+        rt_ns += duration_cast<nanoseconds>(steady_clock::now() - start).count();
+        if (i % 100 == 0)
+          std::this_thread::sleep_for(milliseconds {1});   // the loop's turn on one CPU
+      }
+    }};
+    rt.join();
+    for (int i = 0; i < 1000 && sum < n; ++i)
+      std::this_thread::sleep_for(milliseconds {1});
+    loop.stop();
+    VERIFY(sum == n);
+    VERIFY(calls < n);
+    auto const s = loop.stats();
+    std::cerr << "wakeups: " << n << " notify() in " << calls << " callbacks, " << s.passes
+              << " passes, notify() " << rt_ns / n << "ns average" << std::endl;
+  }
+  preempt::this_process::end_realtime();
+  {
+    /* ten periodic concerns: threads versus one loop */
+    constexpr int concerns = 10;
+    constexpr int periods = 20;
+    auto const period = milliseconds {10};
+
+    long const before_threads = voluntary_switches();
+    std::vector<std::thread> threads;
+    std::atomic<int> thread_ticks {0};
+    for (int i = 0; i < concerns; ++i)
+      threads.emplace_back([&] {
+        auto next = steady_clock::now();
+        for (int p = 0; p < periods; ++p) {
+          next += period;
+          std::this_thread::sleep_until(next);
+          ++thread_ticks;
+        }
+      });
+    for (auto& t : threads)
+      t.join();
+    long const thread_switches = voluntary_switches() - before_threads;
+
+    preempt::reactor loop;
+    std::atomic<int> loop_ticks {0};
+    for (int i = 0; i < concerns; ++i)
+      VERIFY(loop.every(duration_cast<microseconds>(period).count(),
+                        [&](std::uint64_t n) { loop_ticks += int(n); }) >= 0);
+    long const before_loop = voluntary_switches();
+    loop.start();
+    while (loop_ticks < concerns * periods)
+      std::this_thread::sleep_for(period);
+    loop.stop();
+    long const loop_switches = voluntary_switches() - before_loop;
+
+    VERIFY(thread_ticks == concerns * periods);
+    VERIFY(loop_switches < thread_switches);
+    auto const s = loop.stats();
+    VERIFY(s.timer_expirations >= concerns * periods);
+    std::cerr << "context switches: " << concerns << " threads " << thread_switches
+              << ", one reactor " << loop_switches << " (" << s.passes << " passes, "
+              << s.max_batch << " events max)" << std::endl;
+    std::cerr << "timer latency: " << s.avg_latency_ns / 1000 << "us average, "
+              << s.max_latency_ns / 1000 << "us max, longest pass " << s.max_pass_ns / 1000
+              << "us" << std::endl;
+  }
+
+  return global_verify_flag() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,147 @@
+/*
+ * Many producers, one consumer
+ *
+ * A producer whose pool is exhausted drops values until the consumer gives
+ * nodes back. Real-time producers then push numbered values concurrently,
+ * and the consumer must see each producer's values complete and in order.
+ * Throughput from 1 to N producers pinned to CPUs is printed, with the
+ * average and worst cost of push().
+ */
+#include <preempt/mpsc_queue.h>
+#include <preempt/numa.h>
+#include <preempt/process.h>
+#include <preempt/thread.h>
+
+#include <base/verify.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+struct event {
+  int producer;
+  long sequence;
+};
+
+int
+main() {
+  using namespace std::chrono;
+  {
+    /* pools, dropping and giving back */
+    preempt::mpsc_queue<event> queue {2, 4};
+    VERIFY(queue.empty() && queue.producers() == 2);
+    for (long i = 0; i < 6; ++i)
+      queue.push(0, event {0, i});
+    VERIFY(queue.dropped(0) == 2 && queue.dropped(1) == 0);
+    VERIFY(queue.push(1, event {1, 0}));
+    event e {};
+    VERIFY(queue.try_pop(e) && e.producer == 0 && e.sequence == 0);
+    VERIFY(queue.push(0, event {0, 4}));
+    std::vector<event> seen;
+    VERIFY(queue.consume([&](event& v) { seen.push_back(v); }, 2) == 2);
+    VERIFY(queue.consume([&](event& v) { seen.push_back(v); }) == 3);
+    VERIFY(queue.empty() && !queue.try_pop(e));
+    long const expected[][2] = {{0, 1}, {0, 2}, {0, 3}, {1, 0}, {0, 4}};
+    bool ordered = seen.size() == 5;
+    for (std::size_t i = 0; ordered && i < seen.size(); ++i)
+      ordered = seen[i].producer == expected[i][0] && seen[i].sequence == expected[i][1];
+    VERIFY(ordered);
+
+    /* values that own memory are destroyed with the queue */
+    preempt::mpsc_queue<std::unique_ptr<int>> owning {1, 2};
+    std::unique_ptr<int> p;
+    VERIFY(owning.push(0, std::unique_ptr<int> {new int {1}}));
+    VERIFY(owning.push(0, std::unique_ptr<int> {new int {2}}));
+    VERIFY(owning.try_pop(p) && *p == 1);
+  }
+  preempt::this_process::begin_realtime();
+  {
+    /* real-time producers, order per producer */
+    constexpr int producers = 4;
+    constexpr long n = 20000;
+    preempt::mpsc_queue<event> queue {producers, 64};
+    std::vector<std::unique_ptr<preempt::thread>> threads;
+    std::atomic<int> done {0};
+    for (int i = 0; i < producers; ++i)
+      threads.emplace_back(new preempt::thread {SCHED_FIFO, 1, [&queue, &done, i] {
+        for (long s = 0; s < n; ++s)
+          while (!queue.push(i, event {i, s}))
+            std::this_thread::sleep_for(microseconds {100});     // the consumer's turn
+        ++done;
+      }});
+    std::vector<long> next(producers);
+    bool ordered = true;
+    long received = 0;
+    auto const check = [&](event& e) {
+      ordered = ordered && e.sequence == next[e.producer];
+      next[e.producer] = e.sequence + 1;
+      ++received;
+    };
+    while (done < producers || !queue.empty())
+      if (!queue.consume(check))
+        std::this_thread::yield();
+    for (auto& t : threads)
+      t->join();
+    queue.consume(check);
+    VERIFY(ordered);
+    VERIFY(received == producers * n);
+  }
+  preempt::this_process::end_realtime();
+  {
+    /* scaling from 1 to N producers, pinned round-robin */
+    int const cpus = int(::sysconf(_SC_NPROCESSORS_ONLN));
+    int const max_producers = std::max(4, std::min(cpus, 16));
+    constexpr long n = 200000;
+    for (int producers = 1; producers <= max_producers; producers *= 2) {
+      preempt::mpsc_queue<event> queue {producers, 1024};
+      std::atomic<int> done {0};
+      std::vector<long> push_ns(producers), worst_ns(producers);
+      std::vector<std::thread> threads;
+      long received = 0;
+      auto const start = steady_clock::now();
+      for (int i = 0; i < producers; ++i)
+        threads.emplace_back([&, i] {
+          preempt::run_on_cpu(i % cpus);
+          for (long s = 0; s < n;) {
+            auto const begin = steady_clock::now();
+            bool const pushed = queue.push(i, event {i, s});
+            long const ns = duration_cast<nanoseconds>(steady_clock::now() - begin).count();
+            if (!pushed) {
+              std::this_thread::yield();
+              continue;
+            }
+            push_ns[i] += ns;
+            worst_ns[i] = std::max(worst_ns[i], ns);
+            ++s;
+          }
+          ++done;
+        });
+      while (done < producers || !queue.empty())
+        received += queue.consume([](event&) { });
+      auto const elapsed = duration_cast<nanoseconds>(steady_clock::now() - start).count();
+      for (auto& t : threads)
+        t.join();
+      received += queue.consume([](event&) { });
+      VERIFY(received == producers * n);
+      long dropped = 0, sum = 0, worst = 0;
+      for (int i = 0; i < producers; ++i) {
+        dropped += queue.dropped(i);
+        sum += push_ns[i];
+        worst = std::max(worst, worst_ns[i]);
+      }
+      std::cerr << producers << " producers: " << received * 1000000 / elapsed
+                << "k values/s, push " << sum / (producers * n) << "ns average, " << worst
+                << "ns worst, " << dropped << " pool exhausted" << std::endl;
+    }
+  }
+
+  return global_verify_flag() ? EXIT_SUCCESS : EXIT_FAILURE;
+}
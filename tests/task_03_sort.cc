@@ -2,14 +2,20 @@
  *
  * Find out execution time of realtime threads.
  *
- * In each thread generate and sort a random integer vector within a
- * given number of milliseconds or fail.
+ * In each thread sort a random integer array within a given number of
+ * milliseconds or fail. The input is generated with a fixed seed before the
+ * thread starts, so only the sort is measured.
+ *
+ * Where perf_event_open() provides hardware counters, IPC, cache misses and
+ * branch misses are printed per algorithm as well.
  */
 #include <array>
 #include <chrono>
 #include <iostream>
 
 #include <base/algorithm.h>
+#include <base/random.h>
+#include <base/sort.h>
 #include <base/verify.h>
 #include <base/utility.h>
 #include <base/string.h>
@@ -18,29 +24,56 @@
 
 #define PRINT(t) \
   if ((1)) { \
-    std::cerr << #t << ": runtime = " << t.runtime() << " usec" << std::endl; \
+    auto const& c = t.counters(); \
+    std::cerr << #t << ": runtime = " << t.runtime() << " usec"; \
+    if (c.cycles != -1) \
+      std::cerr << ", GHz = " << c.ghz() << ", IPC = " << c.ipc() \
+                << ", cache misses = " << c.cache_misses \
+                << ", branch misses = " << c.branch_misses; \
+    std::cerr << std::endl; \
   } else
 
 using namespace std;
 
-template <long Us, int Size>
-struct DefaultSort : preempt::critical_task<Us> {
+/** Same random input on every run, generated outside the measured run(). */
+template <int Size>
+struct Input {
   array<int, Size> data;
+  Input() { base::generate_workload(data.begin(), data.end(), base::workload::random, Size); }
+};
+
+template <long Us, int Size>
+struct DefaultSort : preempt::critical_task<Us>, Input<Size> {
   void run() override {
-    srand(time(nullptr));
-    // for (auto& i : data) { i = rand(); }
-    generate(data.begin(), data.end(), [this]()->int { return rand(); });
-    sort(data.begin(), data.end());
+    sort(this->data.begin(), this->data.end());
   }
 };
 
 template <long Us, int Size>
-struct BubbleSort : preempt::critical_task<Us> {
-  array<int, Size> data;
+struct BubbleSort : preempt::critical_task<Us>, Input<Size> {
   void run() override {
-    srand(time(nullptr));
-    generate(data.begin(), data.end(), [this]()->int { return rand(); });
-    base::bubble_sort(data);
+    base::bubble_sort(this->data);
+  }
+};
+
+template <long Us, int Size>
+struct HeapSort : preempt::critical_task<Us>, Input<Size> {
+  void run() override {
+    base::heap_sort(this->data.begin(), this->data.end());
+  }
+};
+
+template <long Us, int Size>
+struct IntroSort : preempt::critical_task<Us>, Input<Size> {
+  void run() override {
+    base::intro_sort(this->data.begin(), this->data.end());
+  }
+};
+
+template <long Us, int Size>
+struct NetworkSort : preempt::critical_task<Us>, Input<Size> {
+  void run() override {
+    base::sort_network(this->data);
   }
 };
 
@@ -49,12 +82,38 @@ main(int argc, char *argv[])
 {
   DefaultSort<3000, 1000> t;    // sort within 3ms or fail
   BubbleSort< 3000,  100> u;    // dt. but using bubble sort
+  HeapSort<   3000, 1000> h;    // O(n log n) in the worst case
+  IntroSort<  3000, 1000> i;
+  NetworkSort<3000,   32> n;    // same comparisons for every input
 
+  t.count_events();
+  u.count_events();
+  h.count_events();
+  i.count_events();
+  n.count_events();
   t.start();
   u.start();
+  h.start();
+  i.start();
+  n.start();
 
   t.join(); PRINT(t);           // see task_03_sort.stdout
   u.join(); PRINT(u);
+  h.join(); PRINT(h);
+  i.join(); PRINT(i);
+  n.join(); PRINT(n);
+  VERIFY(is_sorted(h.data.begin(), h.data.end()));
+  VERIFY(is_sorted(i.data.begin(), i.data.end()));
+  VERIFY(is_sorted(n.data.begin(), n.data.end()));
+
+  preempt::perf_counters pc;
+  if (!pc) {
+    std::cerr << "no counters: " << pc.last_error() << std::endl;
+  } else {
+    VERIFY(t.counters().task_clock >= 0);
+    if (t.counters().cycles == -1)
+      std::cerr << "no hardware counters: " << pc.last_error() << std::endl;
+  }
 
   return global_verify_flag() ? EXIT_SUCCESS : EXIT_FAILURE;
 }
@@ -0,0 +1,53 @@
+/* -*- coding: raw-text-unix; -*-
+ *
+ * sched_check -- schedulability analysis of a periodic task set
+ *
+ *     sched_check [-r|-d] FILE
+ *
+ * FILE has one task per line: name, period, relative deadline (0: the
+ * period), worst-case execution time in microseconds and optionally the
+ * SCHED_FIFO priority, see preempt::analysis::parse_task_set(). With -r
+ * rate-monotonic, with -d deadline-monotonic priorities replace those of the
+ * file; tasks without a priority get deadline-monotonic ones. The exit status
+ * is 0 if the response time analysis finds all deadlines met.
+ */
+#include <preempt/schedulability.h>
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+int
+main(int argc, char *argv[])
+{
+  namespace analysis = preempt::analysis;
+  char assign = 0;
+  int arg = 1;
+  if (arg < argc && (std::strcmp(argv[arg], "-r") == 0 || std::strcmp(argv[arg], "-d") == 0))
+    assign = argv[arg++][1];
+  if (arg + 1 != argc) {
+    std::cerr << "usage: " << argv[0] << " [-r|-d] FILE" << std::endl;
+    return EXIT_FAILURE;
+  }
+  std::ifstream file {argv[arg]};
+  analysis::task_set set;
+  std::string error;
+  if (!file) {
+    std::cerr << argv[0] << ": " << argv[arg] << ": cannot open" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (!analysis::parse_task_set(file, set, &error)) {
+    std::cerr << argv[0] << ": " << argv[arg] << ": " << error << std::endl;
+    return EXIT_FAILURE;
+  }
+  bool const unassigned = std::any_of(set.begin(), set.end(), [](analysis::task_spec const& t) {
+    return t.priority == 0;
+  });
+  if (assign == 'r')
+    analysis::assign_rate_monotonic(set);
+  else if (assign == 'd' || unassigned)
+    analysis::assign_deadline_monotonic(set);
+  return analysis::report(set, std::cout) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
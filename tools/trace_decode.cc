@@ -0,0 +1,36 @@
+/* -*- coding: raw-text-unix; -*-
+ *
+ * trace_decode -- print a preempt::tracing trace file
+ *
+ *     trace_decode [-j] FILE
+ *
+ * Without options one event per line is printed with CLOCK_MONOTONIC
+ * timestamps, which match an ftrace recording with trace_clock=mono. With -j
+ * the Chrome trace event format is printed for chrome://tracing or Perfetto.
+ */
+#include <preempt/tracepoint.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+int
+main(int argc, char *argv[])
+{
+  namespace tracing = preempt::tracing;
+  tracing::format fmt = tracing::format::text;
+  int arg = 1;
+  if (arg < argc && std::strcmp(argv[arg], "-j") == 0) {
+    fmt = tracing::format::chrome;
+    ++arg;
+  }
+  if (arg + 1 != argc) {
+    std::cerr << "usage: " << argv[0] << " [-j] FILE" << std::endl;
+    return EXIT_FAILURE;
+  }
+  if (tracing::decode(argv[arg], std::cout, fmt) < 0) {
+    std::cerr << argv[0] << ": " << argv[arg] << ": not a trace file" << std::endl;
+    return EXIT_FAILURE;
+  }
+  return EXIT_SUCCESS;
+}